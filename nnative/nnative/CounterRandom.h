@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter-based generator: value number i of the stream is a hash of (key, i), so any value can
+// be computed on its own -- in SIMD lanes, in any order or split across threads -- and the
+// result never depends on how the work was split. Hash is the murmur3 32-bit finalizer over
+// key + i * golden ratio, plenty for the mutation noise
+class CounterRandom
+{
+	uint32_t key;
+
+public:
+	static constexpr uint32_t Increment = 0x9e3779b9u;
+	static constexpr uint32_t Mix1 = 0x85ebca6bu;
+	static constexpr uint32_t Mix2 = 0xc2b2ae35u;
+
+	explicit CounterRandom(uint32_t k) noexcept
+		: key(k)
+	{
+	}
+
+	static uint32_t Hash(uint32_t key, uint32_t counter) noexcept
+	{
+		uint32_t h = counter * Increment + key;
+		h ^= h >> 16;
+		h *= Mix1;
+		h ^= h >> 13;
+		h *= Mix2;
+		h ^= h >> 16;
+		return h;
+	}
+
+	// Uniform [0, 1), 24 bits, same conversion as the SIMD versions
+	static float ToFloat(uint32_t hash) noexcept
+	{
+		return static_cast<float>(static_cast<int32_t>(hash >> 8)) * (1.0f / 16777216.0f);
+	}
+
+	uint32_t GetKey() const noexcept
+	{
+		return key;
+	}
+
+	uint32_t Next(uint32_t counter) const noexcept
+	{
+		return Hash(key, counter);
+	}
+
+	float NextFloat(uint32_t counter) const noexcept
+	{
+		return ToFloat(Hash(key, counter));
+	}
+};
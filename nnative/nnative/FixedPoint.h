@@ -1,69 +1,102 @@
 #pragma once
 
 #include <stdint.h>
+#include <cmath>
 
+// Q8.8 fixed point, saturating: results out of range stick to the min / max value instead
+// of wrapping around. Conversions from float round to nearest
 class fp16
 {
 	int16_t value;
 
-	fp16(int16_t v, bool ignore) noexcept
+	constexpr fp16(int16_t v, bool /* raw */) noexcept
 		: value(v)
 	{
 	}
 
-public: 
+	static int16_t Saturate(int32_t v) noexcept
+	{
+		return static_cast<int16_t>(v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v));
+	}
+
+	static int16_t Saturate(double v) noexcept
+	{
+		return static_cast<int16_t>(std::nearbyint(v < INT16_MIN ? INT16_MIN : (v > INT16_MAX ? INT16_MAX : v)));
+	}
+
+public:
+	static constexpr int FractionBits = 8;
+	static constexpr int32_t One = 1 << FractionBits;
+
 	fp16() noexcept : value(0) {}
 
-	fp16(const float& f) noexcept : value(static_cast<int16_t>(f* 256.0)) {}
+	fp16(const float& f) noexcept : value(Saturate(f * 256.0)) {}
+
+	fp16(const double& f) noexcept : value(Saturate(f * 256.0)) {}
+
+	fp16(const int& i) noexcept : value(Saturate(static_cast<int32_t>(i) * 256)) {}
 
-	fp16(const double& f) noexcept : value(static_cast<int16_t>(f* 256.0)) {}
+	static constexpr fp16 FromRaw(int16_t raw) noexcept
+	{
+		return fp16{ raw, true };
+	}
 
-	fp16(const int& i) noexcept : value(static_cast<int16_t>(i * 256)) {}
+	// Compile time conversion for the constants, rounds halves away from zero
+	static constexpr fp16 FromConstant(double v) noexcept
+	{
+		return fp16{ static_cast<int16_t>(v >= 0.0 ? static_cast<int32_t>(v * One + 0.5) : -static_cast<int32_t>(-v * One + 0.5)), true };
+	}
 
+	// For the wider intermediate results, e.g. int32 dot products shifted back to Q8.8
+	static fp16 FromRawSaturated(int32_t raw) noexcept
+	{
+		return fp16{ Saturate(raw), true };
+	}
+
+	constexpr int16_t Raw() const noexcept
+	{
+		return value;
+	}
 
 	fp16 operator+(const fp16& rhs) const noexcept
 	{
-		return fp16{ value + rhs.value, true };
+		return fp16{ Saturate(value + rhs.value), true };
 	}
 
 	fp16 operator-(const fp16& rhs) const noexcept
 	{
-		return fp16{ value - rhs.value, true };
+		return fp16{ Saturate(value - rhs.value), true };
 	}
 
 	fp16 operator*(const fp16& rhs) const noexcept
 	{
-		return fp16{ (static_cast<int32_t>(value) * rhs.value) / 256, true };
+		return fp16{ Saturate((static_cast<int32_t>(value) * rhs.value + One / 2) >> FractionBits), true };
 	}
 
 	fp16 operator/(const fp16& rhs) const noexcept
 	{
-		return fp16{ (static_cast<int32_t>(value) * 256 / rhs.value), true };
+		return fp16{ Saturate(static_cast<int32_t>(value) * 256 / rhs.value), true };
 	}
 
 
 	fp16& operator+=(const fp16& rhs) noexcept
 	{
-		value += rhs.value;
-		return *this;
+		return *this = *this + rhs;
 	}
 
 	fp16& operator-=(const fp16& rhs) noexcept
 	{
-		value -= rhs.value;
-		return *this;
+		return *this = *this - rhs;
 	}
 
 	fp16& operator*=(const fp16& rhs) noexcept
 	{
-		value = (static_cast<int32_t>(value) * rhs.value) / 256;
-		return *this;
+		return *this = *this * rhs;
 	}
 
 	fp16& operator/=(const fp16& rhs) noexcept
 	{
-		value = (static_cast<int32_t>(value) * 256 / rhs.value);
-		return *this;
+		return *this = *this / rhs;
 	}
 
 	bool operator<(const fp16& rhs) const noexcept
@@ -97,3 +130,4 @@ public:
 	}
 };
 
+static_assert(sizeof(fp16) == sizeof(int16_t), "fp16 has to be packed same as int16_t");
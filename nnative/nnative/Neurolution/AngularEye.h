@@ -0,0 +1,163 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <cmath>
+#include <array>
+#include <vector>
+
+#include "../Utils.h"
+
+#include "NeuronNetwork.h"
+
+namespace Neurolution
+{
+	// pow(cos(angle), width) for angle in [0, pi/2], sampled at Size + 1 points and linearly
+	// interpolated. With width < 1 the response gets steep right before pi/2, where the
+	// interpolation would be off, the last ExactBins bins are computed with std::pow
+	class EyeResponseTable
+	{
+	public:
+		static constexpr int Size = 4096;
+		static constexpr int ExactBins = 4;
+		static constexpr float MaxAngle = static_cast<float>(M_PI / 2.0);
+
+	private:
+		float _width;
+		std::vector<float> _values;
+
+	public:
+		explicit EyeResponseTable(float width)
+			: _width(width)
+			, _values(Size + 1)
+		{
+			for (int i = 0; i <= Size; ++i)
+			{
+				// float pi/2 is a bit past the real one, keep the cosine from going negative
+				double cosine = std::cos(static_cast<double>(MaxAngle) * i / Size);
+				_values[i] = static_cast<float>(std::pow(cosine > 0.0 ? cosine : 0.0, static_cast<double>(width)));
+			}
+		}
+
+		float GetWidth() const noexcept
+		{
+			return _width;
+		}
+
+		// angle in [0, pi/2)
+		float Lookup(float angle) const noexcept
+		{
+			float x = angle * (Size / MaxAngle);
+			int i = static_cast<int>(x);
+			if (i >= Size - ExactBins)
+			{
+				float cosine = std::cos(angle);
+				return cosine > 0.0f ? std::pow(cosine, _width) : 0.0f;
+			}
+
+			float f = x - i;
+			return _values[i] + f * (_values[i + 1] - _values[i]);
+		}
+	};
+
+	// One response table per distinct LightSensor::Width. Widths are only set on network
+	// construction and load, so the tables are all added up front (serially), lookups are
+	// read only and safe from any worker
+	class EyeResponseTables
+	{
+		std::vector<EyeResponseTable> _tables;
+
+	public:
+		void Prepare(float width)
+		{
+			if (Find(width) == nullptr)
+				_tables.emplace_back(width);
+		}
+
+		template <typename TEye>
+		void Prepare(const TEye& eye)
+		{
+			for (auto& sensor : eye)
+				Prepare(sensor.Width);
+		}
+
+		const EyeResponseTable* Find(float width) const noexcept
+		{
+			for (auto& table : _tables)
+			{
+				if (table.GetWidth() == width)
+					return &table;
+			}
+			return nullptr;
+		}
+	};
+
+	// Eye evaluation one object at a time: bearing and brightness of each object are computed
+	// once, then added to the tripods within 90 degrees of the bearing (the ones with
+	// cos > 0, same cut-off as the per-tripod loop) through the response tables, instead of a
+	// dot product, Q_rsqrt and std::pow per tripod and object. Tripods are expected to be
+	// EyeCellDirectionStep apart, starting at 0 (see NeuronNetwork), the exact angle check is
+	// still done against each tripod's own Direction
+	template <typename WorldProp>
+	class AngularEye
+	{
+		static constexpr int NumTripods = WorldProp::EyeSizeNumTripods;
+		static constexpr float HalfPi = static_cast<float>(M_PI / 2.0);
+		static constexpr float TwoPi = static_cast<float>(M_PI * 2.0);
+		static constexpr float Step = WorldProp::EyeCellDirectionStep;
+
+		using TEye = std::vector<LightSensor, cache_aligned<LightSensor>>;
+
+	public:
+		using TValues = std::array<float, NumTripods>;
+
+		// Adds the light of all the objects (DirectionX / DirectionY / DistanceSquare / Energy,
+		// relative to the cell) to values (TValues or any other NumTripods floats), for the 
+		// color-th sensor of each tripod
+		template <typename TDirections, typename TOut = TValues>
+		static void Scatter(
+			const EyeResponseTables& tables,
+			const TEye& eye,
+			int color,
+			float rotation,
+			const TDirections& directions,
+			TOut& values) noexcept
+		{
+			std::array<const EyeResponseTable*, NumTripods> response;
+			for (int t = 0; t < NumTripods; ++t)
+				response[t] = tables.Find(eye[3 * t + color].Width);
+
+			for (auto& item : directions)
+			{
+				float invSqrRoot = Q_rsqrt(item.DistanceSquare);
+				float brightness = item.Energy * invSqrRoot * invSqrRoot;
+
+				float bearing = std::atan2(item.DirectionY, item.DirectionX) - rotation;
+				while (bearing < -static_cast<float>(M_PI))
+					bearing += TwoPi;
+
+				// the tripods only cover a part of the circle, but in general the bearing can
+				// reach them from either side of the +-pi seam
+				for (float b = bearing - TwoPi; b < bearing + TwoPi + 1.0f; b += TwoPi)
+				{
+					int from = static_cast<int>(std::floor((b - HalfPi) / Step));
+					int to = static_cast<int>(std::ceil((b + HalfPi) / Step));
+					if (to < 0 || from >= NumTripods)
+						continue;
+
+					from = from < 0 ? 0 : from;
+					to = to >= NumTripods ? NumTripods - 1 : to;
+
+					for (int t = from; t <= to; ++t)
+					{
+						float angle = std::abs(b - eye[3 * t].Direction);
+						if (angle >= HalfPi)
+							continue;
+
+						values[t] += brightness * response[t]->Lookup(angle);
+					}
+				}
+			}
+		}
+	};
+}
@@ -7,6 +7,19 @@
 
 namespace Neurolution
 {
+	enum class NetworkEvaluationBackend
+	{
+		PerCell,	// each cell computes its own weighted inputs inside Cell::IterateNetwork
+		Batched		// whole population evaluated in one pass by NetworkBatchEvaluator
+	};
+
+	enum class WeightStorage
+	{
+		Float32,	// weights used as they are
+		BFloat16,	// bf16 copy of the weights, 2 bytes per weight
+		Int8		// int8 copy of the weights with per-row scale, 1 byte per weight
+	};
+
     class AppProperties0
     {
     public:
@@ -21,6 +34,109 @@ namespace Neurolution
 
 		static constexpr bool ManualLoopUnroll = true;
 
+		// Compute neuron weighted inputs once per world step and re-use them for all the 
+		// network sub-steps, the inputs are not changing in between (bit-identical results)
+		static constexpr bool MemoizeWeightedInput = true;
+
+		// Batched requires MemoizeWeightedInput, as it fills the same per-neuron cache
+		static constexpr NetworkEvaluationBackend NetworkBackend = NetworkEvaluationBackend::PerCell;
+
+		// Batched backend splits each network across all the workers (fixed block of rows per 
+		// worker) once NetworkSize >= ratio x number of networks, e.g. 2048 neurons x 38 cells
+		static constexpr int IntraNetworkParallelRatio = 8;
+
+		// Format the network evaluation reads the weights from. Mutations, save and load always 
+		// work on the fp32 master copy, reduced precision copy is re-built from it
+		static constexpr WeightStorage NetworkWeightStorage = WeightStorage::Float32;
+
+		// Q8.8 integer weights, inputs and charges (FixedPoint.h), bit-exact on any machine and 
+		// thread count. Requires MemoizeWeightedInput and Float32 NetworkWeightStorage
+		static constexpr bool FixedPointNetwork = false;
+
+		// Keep a transposed copy of the weights and, when few enough inputs are non-zero 
+		// (share of the input vector below SparseActivityThreshold), compute the weighted inputs 
+		// column by column from the non-zero inputs only. Float32 weights only
+		static constexpr bool SparseInputEvaluation = false;
+		static constexpr float SparseActivityThreshold = 0.5f;
+
+		// Sensing and collisions look up nearby objects in uniform grids (SpatialGrid.h) instead 
+		// of scanning everything, same results. Pays off for large sparse worlds
+		static constexpr bool UseSpatialGrid = false;
+		static constexpr float SpatialGridCellSize = 128.0f;
+
+		// Distances go the short way across the world borders (the world is a torus for the 
+		// movement, see LoopValue). Changes the behaviour, off by default
+		static constexpr bool WrapAroundDistances = false;
+
+		// Eye computed one object at a time: bearing and distance once per object, added to the 
+		// tripods through a pow(cos, Width) table (AngularEye.h) instead of a std::pow per 
+		// tripod and object. Table interpolation changes the sensor values slightly
+		static constexpr bool AngularBinningEye = false;
+
+		// Eye, body sensors and movement computed with the SIMD kernels (SimulationKernels.h) 
+		// and the VectorMath approximations of pow / sin / cos / sqrt instead of libm, results 
+		// differ from the default path in the last bits. The eye part is not used together 
+		// with AngularBinningEye
+		static constexpr bool VectorizedSimulation = false;
+
+		// Eye computed by tiles of cells x objects (SensingTiles.h), all the pairs with the 
+		// visibility checks on SIMD masks, instead of building the sight tables. Same values as 
+		// the VectorizedSimulation eye, needs it. For up to a few thousand objects, where 
+		// UseSpatialGrid does not pay off yet (the grid is then only used by the collisions)
+		static constexpr bool BlockedSensing = false;
+
+		// Sight and contact tables built from Verlet lists: the pairs within the radius plus this 
+		// skin, kept until something has moved more than half of it. Same results, fewer pairs 
+		// to check when things move little per step (RealPhysics). 0 turns them off
+		static constexpr float NeighborListSkin = 0.0f;
+
+		// Eye from Barnes-Hut quadtrees (FarFieldTree.h) instead of the sight tables: groups of 
+		// objects seen under an angle below this one (node size / distance) count as one object 
+		// at their centroid, same total energy, nothing added or lost at the visibility edge. 
+		// Accuracy / speed knob, 0 turns it off (exact sight tables). In the FarFieldSensing 
+		// benchmark (clustered objects) the eye stays within 4% of its strongest tripod at 0.25, 
+		// 6% at 0.5 and 15% at 1.0, about 1/4 of that on average. Not with BlockedSensing
+		static constexpr float FarFieldOpeningAngle = 0.0f;
+
+		// Eye values kept from step to step (SensorCache.h), only the objects whose displacement 
+		// or energy changed by more than this share, that went over a tripod's edge, or came 
+		// into sight / left it go through the eye again. Everything again when the cell turns 
+		// and every SensorCacheRefreshSteps steps. In the SensorCacheDrift benchmark (200 seeds, 
+		// largest error over each run) the eye stays within 1.6% of its strongest tripod at 0.005, 
+		// 3.7% at 0.01 and 8% at 0.02 in the median run, 19%, 22% and 33% in the worst one: an 
+		// object at the 90 degree edge of a tripod, in an eye that sees little else. -bench runs 
+		// 8 seeds and fails above 20%, 25% and 35%. Needs the sight tables, 0 turns it off
+		static constexpr float SensorCacheTolerance = 0.0f;
+		static constexpr int SensorCacheRefreshSteps = 16;
+
+		// Cells out of energy are left out of the sensing, thinking and moving: each step only 
+		// the ones with energy go through them, spread over the workers by their number. The 
+		// dormant ones keep aging (so they are still replaced once old) and stay where they are 
+		// instead of coasting, until eating brings them back
+		static constexpr bool SkipDormantCells = false;
+
+		// Each World::Iterate runs as one ThreadGrid::Region: the workers are handed the step 
+		// once, its phases are separated by barriers instead of each waking them up again, 
+		// and the serial parts run on worker 0, which does its share of the phases too
+		static constexpr bool PersistentStepRegion = false;
+
+		// The step (all of it but the births) as a TaskGraph of tasks with the entity classes 
+		// and tables they read and write (World::BuildStepGraph), the independent ones run at 
+		// the same time: e.g. the prey's and the predators' sensing, then their thinking. The 
+		// grid and table builds have all the workers to themselves. The collisions go through 
+		// _random in another order, so the runs differ from the phase by phase ones. Needs the 
+		// sight tables
+		static constexpr bool TaskGraphStep = false;
+
+		// Each worker pinned to a processor, the workers split over the NUMA nodes in blocks
+		static constexpr bool PinWorkerThreads = false;
+
+		// Each cell has a home node (Cell::HomeNode): its network is re-allocated by a worker 
+		// of that node, so its memory is there, and its sensing, thinking and network 
+		// evaluation go to that node's workers (ThreadGrid::ParallelForNodes). Pins the 
+		// workers. Not with TaskGraphStep, whose tasks go to any worker
+		static constexpr bool NumaAwarePlacement = false;
+
         static constexpr int EyeSizeNumTripods = 32; // each covering 11.25 deg
         static constexpr int EyeSize = EyeSizeNumTripods * 3; // total number of light-sensing cells 
 
@@ -0,0 +1,1501 @@
+#pragma once
+
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <limits>
+
+#include "../Random.h"
+#include "../ThreadGrid.h"
+
+#include "AppProperties.h"
+#include "Cell.h"
+#include "World.h"
+#include "NetworkBatchEvaluator.h"
+#include "NetworkCloner.h"
+#include "SimulationKernels.h"
+#include "SensingTiles.h"
+#include "PairTable.h"
+#include "FarFieldTree.h"
+#include "SensorCache.h"
+#include "../VectorMath.h"
+
+// Synthetic benchmarks of the simulation hot spots, started with "-bench" on the command line.
+// Results are printed as plain text, one line per case
+namespace Neurolution
+{
+	namespace Benchmarks
+	{
+		template <typename TFn>
+		double MeasureSeconds(TFn&& fn)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			fn();
+			auto end = std::chrono::high_resolution_clock::now();
+			return std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+		}
+
+		// The worlds of the step time benchmarks: small networks, so the step is dominated by 
+		// sensing and collisions
+		template <typename BaseProp>
+		struct StepBenchProps : public BaseProp
+		{
+			static constexpr int NetworkSize = 48;
+		};
+
+		// numPrey prey with half as many foods (at most one new food per step) and an eighth as 
+		// many predators, or in a sparse world a quarter and a sixteenth
+		template <typename TProp>
+		std::unique_ptr<World<TProp>> MakeStepWorld(int numThreads, int numPrey, bool sparse = false, 
+			int width = TProp::WorldWidth, int height = TProp::WorldHeight)
+		{
+			int numFoods = std::min(numPrey / (sparse ? 4 : 2), TProp::StepsPerGeneration);
+			int numPredators = numPrey / (sparse ? 16 : 8);
+
+			return std::make_unique<World<TProp>>(std::string(""), numThreads, numPrey, numFoods, numPredators, width, height);
+		}
+
+		// Seconds per World::Iterate over numSteps steps, after numWarmUpSteps (the first one 
+		// initializes the world) and warmedUp(), which can set the world up or reset its stats
+		template <typename TWorld, typename TFn>
+		double StepSeconds(TWorld& world, int numSteps, TFn&& warmedUp, int numWarmUpSteps = 1)
+		{
+			long step = 0;
+			for (; step < numWarmUpSteps; ++step)
+				world.Iterate(step);
+
+			warmedUp();
+
+			return MeasureSeconds([&]()
+			{
+				for (long i = 0; i < numSteps; ++i, ++step)
+					world.Iterate(step);
+			}) / numSteps;
+		}
+
+		template <typename TWorld>
+		double StepSeconds(TWorld& world, int numSteps)
+		{
+			return StepSeconds(world, numSteps, []() {});
+		}
+
+		template <typename TProp>
+		double StepSeconds(int numThreads, int numPrey, int numSteps)
+		{
+			return StepSeconds(*MakeStepWorld<TProp>(numThreads, numPrey), numSteps);
+		}
+
+		template <typename BaseProp, int Size, NetworkEvaluationBackend Backend>
+		struct NetworkBenchProps : public BaseProp
+		{
+			static constexpr int NetworkSize = Size;
+			static constexpr NetworkEvaluationBackend NetworkBackend = Backend;
+		};
+
+		// Cells with random (severely mutated) weights, so the neurons do actually fire
+		template <typename WorldProp>
+		std::vector<std::shared_ptr<Cell<WorldProp>>> MakeRandomCells(Random& rnd, int numCells)
+		{
+			using TCell = Cell<WorldProp>;
+
+			std::vector<std::shared_ptr<TCell>> cells(numCells);
+
+			typename TCell::TNetwork zero(WorldProp::NetworkSize);
+
+			for (auto& cell : cells)
+			{
+				cell = std::make_shared<TCell>(rnd);
+				cell->Network->CloneFrom(zero, rnd, true, 1.0f);
+				cell->Network->CleanOutputs();
+			}
+
+			return cells;
+		}
+
+		template <typename WorldProp>
+		void FillRandomSensors(Random& rnd, std::shared_ptr<Cell<WorldProp>>& cell)
+		{
+			auto& input = cell->Network->InputVector;
+			for (int i = 0; i < WorldProp::SensorPackSize; ++i)
+				input[i] = rnd.NextFloat();
+		}
+
+		// Network part of World::Iterate only: PrepareIteration + (batched evaluation) +
+		// 4 x Cell::IterateNetwork, reported as neuron sub-step updates per second
+		template <typename WorldProp>
+		double NetworkUpdatesPerSecond(ThreadGrid& grid, int numCells, int numSteps, 
+			BatchPartition partition = BatchPartition::Automatic)
+		{
+			Random rnd;
+			auto cells = MakeRandomCells<WorldProp>(rnd, numCells);
+
+			NetworkBatchEvaluator<WorldProp> batchEvaluator;
+			batchEvaluator.SetPartition(partition);
+
+			double seconds = MeasureSeconds([&]()
+			{
+				for (long step = 0; step < numSteps; ++step)
+				{
+					for (auto& cell : cells)
+					{
+						cell->PrepareIteration();
+						FillRandomSensors<WorldProp>(rnd, cell);
+					}
+
+					if constexpr (WorldProp::NetworkBackend == NetworkEvaluationBackend::Batched)
+					{
+						batchEvaluator.Add(cells);
+						grid.GridRun([&](int idx, int n) { batchEvaluator.Run(idx, n); });
+						batchEvaluator.Finish();
+					}
+
+					grid.GridRun([&](int idx, int n)
+					{
+						for (int cellIdx = idx; cellIdx < numCells; cellIdx += n)
+						{
+							for (int nIter = 0; nIter < 4; ++nIter)
+								cells[cellIdx]->IterateNetwork(step * 4 + nIter);
+						}
+					});
+				}
+			});
+
+			double updates = static_cast<double>(numCells) * WorldProp::NetworkSize *
+				WorldProp::NetworkStepsPerIteration * 4.0 * numSteps;
+
+			return updates / seconds;
+		}
+
+		template <typename BaseProp, int Size>
+		void NetworkBackends(std::ostream& out, ThreadGrid& grid, int numCells, int numSteps)
+		{
+			using TPerCell = NetworkBenchProps<BaseProp, Size, NetworkEvaluationBackend::PerCell>;
+			using TBatched = NetworkBenchProps<BaseProp, Size, NetworkEvaluationBackend::Batched>;
+
+			double perCell = NetworkUpdatesPerSecond<TPerCell>(grid, numCells, numSteps);
+			double batched = NetworkUpdatesPerSecond<TBatched>(grid, numCells, numSteps);
+
+			out << "network backends, NetworkSize " << std::setw(5) << Size
+				<< ", cells " << numCells
+				<< ": per-cell " << std::setprecision(4) << perCell / 1e6 << " M upd/s"
+				<< ", batched " << batched / 1e6 << " M upd/s"
+				<< " (x" << batched / perCell << ")" << std::endl;
+		}
+
+		template <typename BaseProp, WeightStorage Storage>
+		struct WeightStorageBenchProps : public BaseProp
+		{
+			static constexpr WeightStorage NetworkWeightStorage = Storage;
+		};
+
+		// Reduced precision weight storage against fp32: throughput, and how far the behaviour 
+		// drifts away -- the same networks (copied through SaveTo / LoadFrom) fed with the same 
+		// sensor values, compared by the first step weighted inputs and by the share of neuron 
+		// outputs that differ after 1 and after numSteps world steps
+		template <typename BaseProp, WeightStorage Storage>
+		void WeightStorageCompare(std::ostream& out, ThreadGrid& grid, const char* name, int numCells, int numSteps)
+		{
+			using TReference = WeightStorageBenchProps<BaseProp, WeightStorage::Float32>;
+			using TCompact = WeightStorageBenchProps<BaseProp, Storage>;
+
+			double reference = NetworkUpdatesPerSecond<TReference>(grid, numCells, numSteps);
+			double compact = NetworkUpdatesPerSecond<TCompact>(grid, numCells, numSteps);
+
+			Random rnd;
+			auto cells = MakeRandomCells<TReference>(rnd, numCells);
+
+			std::vector<std::unique_ptr<NeuronNetwork<TCompact>>> compactNetworks;
+			for (auto& cell : cells)
+			{
+				std::stringstream stream;
+				cell->Network->SaveTo(stream);
+				compactNetworks.push_back(std::make_unique<NeuronNetwork<TCompact>>(TCompact::NetworkSize));
+				compactNetworks.back()->LoadFrom(stream);
+			}
+
+			double errorSum = 0.0;
+			double magnitudeSum = 0.0;
+			double firstStepDiffering = 0.0;
+			double lastStepDiffering = 0.0;
+
+			for (int step = 0; step < numSteps; ++step)
+			{
+				long differing = 0;
+
+				for (size_t idx = 0; idx < cells.size(); ++idx)
+				{
+					auto& fp32 = *cells[idx]->Network;
+					auto& other = *compactNetworks[idx];
+
+					fp32.PrepareIteration();
+					other.PrepareIteration();
+
+					for (int i = 0; i < BaseProp::SensorPackSize; ++i)
+						fp32.InputVector[i] = other.InputVector[i] = rnd.NextFloat();
+
+					for (int nIter = 0; nIter < 4; ++nIter)
+					{
+						fp32.IterateNetwork(rnd);
+						other.IterateNetwork(rnd);
+					}
+
+					if (step == 0)
+					{
+						for (size_t j = 0; j < fp32.GetNetworkSize(); ++j)
+						{
+							errorSum += std::abs(fp32.WeightedInputs[j] - other.WeightedInputs[j]);
+							magnitudeSum += std::abs(fp32.WeightedInputs[j]);
+						}
+					}
+
+					for (size_t j = 0; j < fp32.GetNetworkSize(); ++j)
+					{
+						if (fp32.OutputVector[j] != other.OutputVector[j])
+							++differing;
+					}
+				}
+
+				double share = static_cast<double>(differing) / (static_cast<double>(numCells) * BaseProp::NetworkSize);
+				if (step == 0)
+					firstStepDiffering = share;
+				lastStepDiffering = share;
+			}
+
+			out << "weight storage " << name << ", NetworkSize " << BaseProp::NetworkSize
+				<< ": " << std::setprecision(4) << compact / 1e6 << " M upd/s"
+				<< " (x" << compact / reference << " vs fp32)"
+				<< ", weighted input rel. error " << errorSum / magnitudeSum
+				<< ", outputs differing " << firstStepDiffering * 100.0 << "% after 1 step, "
+				<< lastStepDiffering * 100.0 << "% after " << numSteps << " steps" << std::endl;
+		}
+
+		template <typename BaseProp, bool Fixed>
+		struct FixedPointBenchProps : public BaseProp
+		{
+			static constexpr bool FixedPointNetwork = Fixed;
+		};
+
+		// Fixed point network mode against the float one: raw dot kernels (multiply-adds per 
+		// second on a single row, cache resident) and the whole network evaluation
+		template <typename BaseProp>
+		void FixedPointCompare(std::ostream& out, ThreadGrid& grid, int numCells, int numSteps)
+		{
+			using TFloat = FixedPointBenchProps<BaseProp, false>;
+			using TFixed = FixedPointBenchProps<BaseProp, true>;
+
+			constexpr int rowSize = BaseProp::NetworkSize + BaseProp::SensorPackSize;
+			constexpr int numDots = 200000;
+
+			Random rnd;
+			std::vector<float, cache_aligned<float>> w(rowSize), x(rowSize);
+			std::vector<int16_t, cache_aligned<int16_t>> wFixed(rowSize), xFixed(rowSize);
+			for (int i = 0; i < rowSize; ++i)
+			{
+				w[i] = 2.0f * rnd.NextFloat() - 1.0f;
+				x[i] = rnd.NextFloat();
+				wFixed[i] = NeuronKernelImpl::ToFixedScalar(w[i]);
+				xFixed[i] = NeuronKernelImpl::ToFixedScalar(x[i]);
+			}
+
+			auto& kernels = NeuronKernels<BaseProp>::Get();
+
+			volatile float floatSink = 0.0f;
+			double floatDot = MeasureSeconds([&]()
+			{
+				for (int i = 0; i < numDots; ++i)
+				{
+					x[i % rowSize] += 1.0f; // keep the calls from being hoisted
+					floatSink = floatSink + kernels.Dot(w.data(), x.data(), rowSize);
+				}
+			});
+
+			volatile int64_t fixedSink = 0;
+			double fixedDot = MeasureSeconds([&]()
+			{
+				for (int i = 0; i < numDots; ++i)
+				{
+					xFixed[i % rowSize] += 1;
+					fixedSink = fixedSink + kernels.DotFixed(wFixed.data(), xFixed.data(), rowSize);
+				}
+			});
+
+			double floatNetwork = NetworkUpdatesPerSecond<TFloat>(grid, numCells, numSteps);
+			double fixedNetwork = NetworkUpdatesPerSecond<TFixed>(grid, numCells, numSteps);
+
+			double macs = static_cast<double>(numDots) * rowSize;
+
+			out << "fixed point, NetworkSize " << BaseProp::NetworkSize
+				<< ": dot float " << std::setprecision(4) << macs / floatDot / 1e9 << " GMAC/s"
+				<< ", int16 " << macs / fixedDot / 1e9 << " GMAC/s (x" << floatDot / fixedDot << ")"
+				<< "; network float " << floatNetwork / 1e6 << " M upd/s"
+				<< ", fixed " << fixedNetwork / 1e6 << " M upd/s (x" << fixedNetwork / floatNetwork << ")" << std::endl;
+		}
+
+		// Share of the network evaluation spent in the neuron state machine, scalar against the 
+		// selected ISA kernel: weighted inputs once per step, then the state update for every 
+		// network sub-step, timed separately
+		template <typename WorldProp>
+		void StateUpdateShare(std::ostream& out, int numCells, int numSteps)
+		{
+			auto measure = [&](typename NeuronKernels<WorldProp>::TUpdateStatesFn updateStates, double& weighted, double& update)
+			{
+				Random rnd;
+				auto cells = MakeRandomCells<WorldProp>(rnd, numCells);
+
+				weighted = 0.0;
+				update = 0.0;
+
+				for (int step = 0; step < numSteps; ++step)
+				{
+					weighted += MeasureSeconds([&]()
+					{
+						for (auto& cell : cells)
+						{
+							auto& network = *cell->Network;
+							network.PrepareIteration();
+							FillRandomSensors<WorldProp>(rnd, cell);
+
+							for (unsigned int j = 0; j < network.GetNetworkSize(); ++j)
+								network.WeightedInputs[j] = network.ComputeWeightedInput(j, network.InputVector);
+						}
+					});
+
+					update += MeasureSeconds([&]()
+					{
+						for (auto& cell : cells)
+						{
+							auto& network = *cell->Network;
+							for (int subStep = 0; subStep < WorldProp::NetworkStepsPerIteration * 4; ++subStep)
+							{
+								updateStates(network.States.data(), network.Charges.data(), network.WeightedInputs.data(),
+									network.OutputVector.data(), network.GetNetworkSize());
+							}
+						}
+					});
+				}
+			};
+
+			double scalarWeighted, scalarUpdate, simdWeighted, simdUpdate;
+			measure(NeuronKernels<WorldProp>::For(KernelIsa::Scalar).UpdateStates, scalarWeighted, scalarUpdate);
+			measure(NeuronKernels<WorldProp>::Get().UpdateStates, simdWeighted, simdUpdate);
+
+			out << "state update, NetworkSize " << WorldProp::NetworkSize
+				<< ": scalar " << std::setprecision(4) << scalarUpdate * 1000.0 / numSteps << " ms/step"
+				<< " (" << 100.0 * scalarUpdate / (scalarUpdate + scalarWeighted) << "% of network time)"
+				<< ", " << KernelIsaName(KernelDispatch::Selected()) << " " << simdUpdate * 1000.0 / numSteps << " ms/step"
+				<< " (" << 100.0 * simdUpdate / (simdUpdate + simdWeighted) << "%)" << std::endl;
+		}
+
+		template <typename BaseProp, bool Sparse>
+		struct SparseBenchProps : public BaseProp
+		{
+			static constexpr bool SparseInputEvaluation = Sparse;
+		};
+
+		// Dense against sparse weighted input evaluation of one network as a function of the 
+		// share of non-zero inputs (where the crossover for SparseActivityThreshold is), then 
+		// the network throughput with the automatic switching on
+		template <typename BaseProp>
+		void SparseInputs(std::ostream& out, ThreadGrid& grid, int numCells, int numSteps)
+		{
+			using TDense = SparseBenchProps<BaseProp, false>;
+			using TSparse = SparseBenchProps<BaseProp, true>;
+
+			constexpr int numEvaluations = 200;
+
+			Random rnd;
+			auto cells = MakeRandomCells<TSparse>(rnd, 1);
+			auto& network = *cells[0]->Network;
+
+			out << "sparse inputs, NetworkSize " << BaseProp::NetworkSize << ", dense / sparse time at active share:";
+
+			for (float activity : { 0.02f, 0.05f, 0.1f, 0.2f, 0.3f, 0.5f, 0.7f, 0.9f })
+			{
+				for (auto& input : network.InputVector)
+					input = rnd.NextFloat() < activity ? rnd.NextFloat() : 0.0f;
+
+				double dense = MeasureSeconds([&]()
+				{
+					for (int i = 0; i < numEvaluations; ++i)
+					{
+						for (unsigned int j = 0; j < network.GetNetworkSize(); ++j)
+							network.WeightedInputs[j] = network.ComputeWeightedInput(j, network.InputVector);
+					}
+				});
+
+				double sparse = MeasureSeconds([&]()
+				{
+					for (int i = 0; i < numEvaluations; ++i)
+					{
+						network.PrepareWeightedInputs();
+						network.EvaluateWeightedInputsSparse(0, static_cast<unsigned int>(network.GetNetworkSize()));
+					}
+				});
+
+				out << " " << std::setprecision(3) << activity * 100.0f << "%: x" << dense / sparse;
+			}
+
+			out << std::endl;
+
+			double dense = NetworkUpdatesPerSecond<TDense>(grid, numCells, numSteps);
+			double sparse = NetworkUpdatesPerSecond<TSparse>(grid, numCells, numSteps);
+
+			out << "sparse inputs, NetworkSize " << BaseProp::NetworkSize
+				<< ", cells " << numCells
+				<< ": dense " << std::setprecision(4) << dense / 1e6 << " M upd/s"
+				<< ", automatic " << sparse / 1e6 << " M upd/s (x" << sparse / dense << ")" << std::endl;
+		}
+
+		// Few large networks on 1..maxThreads workers: round robin row items against the fixed 
+		// per-worker row blocks (intra-network partitioning)
+		template <typename BaseProp>
+		void IntraNetworkScaling(std::ostream& out, int maxThreads, int numCells, int numSteps)
+		{
+			using TProp = NetworkBenchProps<BaseProp, 2048, NetworkEvaluationBackend::Batched>;
+
+			for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+			{
+				ThreadGrid grid(numThreads);
+
+				double items = NetworkUpdatesPerSecond<TProp>(grid, numCells, numSteps, BatchPartition::Items);
+				double rows = NetworkUpdatesPerSecond<TProp>(grid, numCells, numSteps, BatchPartition::Rows);
+
+				out << "intra-network, NetworkSize 2048, cells " << numCells
+					<< ", threads " << std::setw(2) << numThreads
+					<< ": items " << std::setprecision(4) << items / 1e6 << " M upd/s"
+					<< ", row blocks " << rows / 1e6 << " M upd/s (x" << rows / items << ")" << std::endl;
+			}
+		}
+
+		// Construction of a full default-sized world and its steady-state step time
+		template <typename WorldProp>
+		void WorldStep(std::ostream& out, int numThreads, int numSteps)
+		{
+			using TWorld = World<WorldProp>;
+
+			std::unique_ptr<TWorld> world;
+
+			double construction = MeasureSeconds([&]()
+			{
+				world = std::make_unique<TWorld>(
+					std::string(""),
+					numThreads,
+					WorldProp::WorldSize,
+					WorldProp::FoodCountPerIteration,
+					WorldProp::PredatorCountPerIteration,
+					WorldProp::WorldWidth,
+					WorldProp::WorldHeight);
+			});
+
+			long step = 0;
+			for (; step < 16; ++step)
+				world->Iterate(step);
+
+			double stepping = MeasureSeconds([&]()
+			{
+				for (long i = 0; i < numSteps; ++i, ++step)
+					world->Iterate(step);
+			});
+
+			out << "world " << WorldProp::WorldSize << " prey + " << WorldProp::PredatorCountPerIteration << " predators"
+				<< ": construction " << std::setprecision(4) << construction * 1000.0 << " ms"
+				<< ", step " << stepping * 1000.0 / numSteps << " ms" << std::endl;
+		}
+
+		template <typename BaseProp, bool Grid>
+		struct SpatialGridBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool UseSpatialGrid = Grid;
+		};
+
+		// Step time of a large sparse world (default visibility distance), objects scanned 
+		// brute force vs looked up in the spatial grids
+		template <typename BaseProp>
+		void SpatialGridWorld(std::ostream& out, int numThreads, int numPrey, int worldSize, int numSteps)
+		{
+			auto bruteWorld = MakeStepWorld<SpatialGridBenchProps<BaseProp, false>>(numThreads, numPrey, true, worldSize, worldSize);
+			double brute = StepSeconds(*bruteWorld, numSteps, []() {}, 2);
+			double grid = StepSeconds(*MakeStepWorld<SpatialGridBenchProps<BaseProp, true>>(numThreads, numPrey, true, worldSize, worldSize), numSteps, []() {}, 2);
+
+			out << "spatial grid, " << numPrey << " prey + " << bruteWorld->GetPredators().size() << " predators, " << worldSize << "x" << worldSize
+				<< ": brute force " << std::setprecision(4) << brute * 1000.0 << " ms"
+				<< ", grid " << grid * 1000.0 << " ms per step (x" << brute / grid << ")" << std::endl;
+		}
+
+		template <typename BaseProp, int Tripods, bool Angular>
+		struct EyeBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool AngularBinningEye = Angular;
+
+			// everything derived from the eye size
+			static constexpr int EyeSizeNumTripods = Tripods;
+			static constexpr int EyeSize = EyeSizeNumTripods * 3;
+			static constexpr float EyeCellDirectionStep = (float)(M_PI / EyeSize);
+
+			static constexpr int CurrentEnergyLevelSensor = EyeSize + 0;
+			static constexpr int OrientationXSensor = EyeSize + 1;
+			static constexpr int OrientationYSensor = EyeSize + 2;
+			static constexpr int AbsoluteVelocitySensor = EyeSize + 3;
+			static constexpr int SensorPackSize = EyeSize + 16;
+
+			static constexpr int NetworkMoveForceGentleLeft = SensorPackSize + 0;
+			static constexpr int NetworkMoveForceGentleRight = SensorPackSize + 1;
+			static constexpr int NetworkMoveForceNormalLeft = SensorPackSize + 2;
+			static constexpr int NetworkMoveForceNormalRight = SensorPackSize + 3;
+			static constexpr int NetworkMoveForceStrongLeft = SensorPackSize + 4;
+			static constexpr int NetworkMoveForceStrongRight = SensorPackSize + 5;
+		};
+
+		// World step time with the per-tripod eye vs AngularEye (small networks, so the sensing 
+		// dominates), and the largest relative difference of AngularEye's tripod values from the 
+		// exact per-tripod formula (no Q_rsqrt), for random objects around a cell
+		template <typename BaseProp, int Tripods>
+		void EyeModels(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			using TExact = EyeBenchProps<BaseProp, Tripods, false>;
+			using TAngular = EyeBenchProps<BaseProp, Tripods, true>;
+
+			double exactStep = StepSeconds<TExact>(numThreads, numPrey, numSteps);
+			double angularStep = StepSeconds<TAngular>(numThreads, numPrey, numSteps);
+
+			Random rnd;
+			NeuronNetwork<TAngular> network(TAngular::NetworkSize);
+			EyeResponseTables tables;
+			tables.Prepare(network.Eye);
+
+			double maxDifference = 0.0;
+			std::vector<DirectionWithDistanceSquare> objects(64);
+
+			for (int sample = 0; sample < 256; ++sample)
+			{
+				for (auto& item : objects)
+					item.Set(rnd.NextFloat() * 1600.0f - 800.0f, rnd.NextFloat() * 1600.0f - 800.0f, 1.0f);
+
+				float rotation = rnd.NextFloat() * static_cast<float>(M_PI * 2.0);
+
+				typename AngularEye<TAngular>::TValues values{};
+				AngularEye<TAngular>::Scatter(tables, network.Eye, 0, rotation, objects, values);
+
+				for (int t = 0; t < Tripods; ++t)
+				{
+					auto& sensor = network.Eye[3 * t];
+					float viewX = std::cos(rotation + sensor.Direction);
+					float viewY = std::sin(rotation + sensor.Direction);
+
+					double reference = 0.0;
+					for (auto& item : objects)
+					{
+						double distance = std::sqrt(item.DistanceSquare);
+						double cosine = (viewX * item.DirectionX + viewY * item.DirectionY) / distance;
+						if (cosine > 0.0)
+							reference += item.Energy * std::pow(cosine, sensor.Width) / item.DistanceSquare;
+					}
+
+					if (reference > 0.0)
+						maxDifference = std::max(maxDifference, std::abs(values[t] - reference) / reference);
+				}
+			}
+
+			out << "eye, " << Tripods << " tripods, " << numPrey << " prey"
+				<< ": per tripod " << std::setprecision(4) << exactStep * 1000.0 << " ms"
+				<< ", angular " << angularStep * 1000.0 << " ms per step (x" << exactStep / angularStep << ")"
+				<< ", max difference " << maxDifference * 100.0 << "%" << std::endl;
+		}
+
+		// Largest errors of the VectorMath functions against libm in double precision, over the 
+		// ranges of the bounds documented in VectorMath.h, then the same for the SinCos and 
+		// EyeSignals kernels on each instruction set the CPU has (EyeSignals against the exact 
+		// per-tripod formula, relative to the tripod total). False if any error exceeds its bound
+		template <typename WorldProp>
+		bool VectorMathAccuracy(std::ostream& out)
+		{
+			Random rnd;
+			constexpr int numSamples = 1 << 16;
+
+			bool withinBounds = true;
+			auto report = [&](const char* name, double error, double bound)
+			{
+				withinBounds = withinBounds && error <= bound;
+				out << " " << name << " " << std::setprecision(3) << error << (error <= bound ? "" : " (exceeds bound)") << ",";
+			};
+
+			double exp2Error = 0.0, log2Error = 0.0, powError = 0.0, sinCosError = 0.0, sqrtError = 0.0, rsqrtError = 0.0;
+
+			for (int i = 0; i < numSamples; ++i)
+			{
+				float x = rnd.NextFloat() * 252.0f - 126.0f;
+				exp2Error = std::max(exp2Error, std::abs(VectorMath::Exp2(x) / std::exp2(static_cast<double>(x)) - 1.0));
+
+				float positive = static_cast<float>(std::exp2(rnd.NextDouble() * 200.0 - 100.0));
+				double log2Reference = std::log2(static_cast<double>(positive));
+				log2Error = std::max(log2Error, std::abs(VectorMath::Log2(positive) - log2Reference) / std::max(1.0, std::abs(log2Reference)));
+
+				float cosine = rnd.NextFloat();
+				float width = rnd.NextFloat() * 10.0f + 0.1f;
+				if (cosine > 0.0f)
+				{
+					double reference = std::pow(static_cast<double>(cosine), static_cast<double>(width));
+					double scale = 1.0 + std::abs(width * std::log2(static_cast<double>(cosine)));
+					if (reference > 1e-30)
+						powError = std::max(powError, std::abs(VectorMath::Pow(cosine, width) / reference - 1.0) / scale);
+				}
+
+				float angle = rnd.NextFloat() * 2000.0f - 1000.0f;
+				float sine, cosineOut;
+				VectorMath::SinCos(angle, sine, cosineOut);
+				sinCosError = std::max(sinCosError, std::abs(sine - std::sin(static_cast<double>(angle))));
+				sinCosError = std::max(sinCosError, std::abs(cosineOut - std::cos(static_cast<double>(angle))));
+
+				sqrtError = std::max(sqrtError, std::abs(static_cast<double>(VectorMath::Sqrt(positive)) - std::sqrt(static_cast<double>(positive))) /
+					std::sqrt(static_cast<double>(positive)));
+				rsqrtError = std::max(rsqrtError, std::abs(VectorMath::RSqrt(positive) * std::sqrt(static_cast<double>(positive)) - 1.0));
+			}
+
+			out << "vector math:";
+			report("exp2", exp2Error, 3e-7);
+			report("log2", log2Error, 3e-7);
+			report("pow", powError, 3e-7);
+			report("sincos", sinCosError, 2e-7);
+			report("sqrt", sqrtError, 6e-8);
+			report("rsqrt", rsqrtError, 5e-7);
+			out << std::endl;
+
+			constexpr int numTripods = 32;
+			alignas(64) float angles[numTripods], sine[numTripods], cosine[numTripods], widths[numTripods], values[numTripods];
+			std::vector<DirectionWithDistanceSquare> objects(64);
+
+			for (auto isa : { KernelIsa::Scalar, KernelIsa::Avx2, KernelIsa::Avx512 })
+			{
+				if (isa != KernelIsa::Scalar && !CpuFeatures::Get().Supports(isa))
+					continue;
+
+				auto kernels = SimulationKernels<WorldProp>::For(isa);
+
+				double kernelSinCosError = 0.0, eyeError = 0.0;
+
+				for (int sample = 0; sample < 256; ++sample)
+				{
+					for (int t = 0; t < numTripods; ++t)
+					{
+						angles[t] = rnd.NextFloat() * 4.0f * static_cast<float>(M_PI);
+						widths[t] = rnd.NextFloat() * 4.0f + 0.25f;
+						values[t] = 0.0f;
+					}
+
+					for (auto& item : objects)
+						item.Set(rnd.NextFloat() * 1600.0f - 800.0f, rnd.NextFloat() * 1600.0f - 800.0f, 1.0f);
+
+					kernels.SinCos(angles, sine, cosine, numTripods);
+					kernels.EyeSignals(cosine, sine, widths, numTripods, objects.data(), objects.size(), values);
+
+					for (int t = 0; t < numTripods; ++t)
+					{
+						kernelSinCosError = std::max(kernelSinCosError, std::abs(sine[t] - std::sin(static_cast<double>(angles[t]))));
+						kernelSinCosError = std::max(kernelSinCosError, std::abs(cosine[t] - std::cos(static_cast<double>(angles[t]))));
+
+						double reference = 0.0;
+						for (auto& item : objects)
+						{
+							double distance = std::sqrt(static_cast<double>(item.DistanceSquare));
+							double modulo = static_cast<double>(cosine[t]) * item.DirectionX + static_cast<double>(sine[t]) * item.DirectionY;
+							if (modulo > 0.0)
+								reference += item.Energy * std::pow(modulo / distance, static_cast<double>(widths[t])) / item.DistanceSquare;
+						}
+
+						if (reference > 0.0)
+							eyeError = std::max(eyeError, std::abs(values[t] - reference) / reference);
+					}
+				}
+
+				out << "vector math kernels, " << KernelIsaName(isa) << ":";
+				report("sincos", kernelSinCosError, 2e-7);
+				out << " eye relative " << std::setprecision(3) << eyeError << std::endl;
+			}
+
+			return withinBounds;
+		}
+
+		template <typename BaseProp, bool Vectorized>
+		struct VectorizedSimulationBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool VectorizedSimulation = Vectorized;
+		};
+
+		// World step time (small networks, so sensing and movement dominate) with the libm 
+		// eye / sensors / movement vs SimulationKernels
+		template <typename BaseProp>
+		void VectorizedSimulationWorld(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			double libm = StepSeconds<VectorizedSimulationBenchProps<BaseProp, false>>(numThreads, numPrey, numSteps);
+			double vectorized = StepSeconds<VectorizedSimulationBenchProps<BaseProp, true>>(numThreads, numPrey, numSteps);
+
+			out << "vectorized simulation, " << numPrey << " prey"
+				<< ": libm " << std::setprecision(4) << libm * 1000.0 << " ms"
+				<< ", " << KernelIsaName(SimulationKernels<BaseProp>::Get().Isa) << " " << vectorized * 1000.0 << " ms per step (x" << libm / vectorized << ")" << std::endl;
+		}
+
+		template <typename BaseProp, bool Blocked>
+		struct BlockedSensingBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool VectorizedSimulation = true;
+			static constexpr bool BlockedSensing = Blocked;
+		};
+
+		// Eye throughput in observer x object pairs per second: numPrey random prey (plus foods 
+		// and predators as in the world) seeing everything through SensingTiles, vs the sight 
+		// tables plus EyeSignals per cell; then the world step times of both
+		template <typename BaseProp>
+		void BlockedSensingThroughput(std::ostream& out, int numThreads, int numPrey, int numRuns)
+		{
+			using TProp = BlockedSensingBenchProps<BaseProp, true>;
+			using TTiles = SensingTiles<TProp>;
+
+			int numFoods = std::min(numPrey / 2, BaseProp::StepsPerGeneration);
+			int numPredators = numPrey / 8;
+			int numBodies = numPrey + numPredators;
+
+			constexpr int width = BaseProp::WorldWidth;
+			constexpr int height = BaseProp::WorldHeight;
+
+			ThreadGrid grid(numThreads);
+			Random rnd;
+
+			std::vector<float> x(numBodies + numFoods), y(numBodies + numFoods), rotation(numPrey);
+			for (size_t i = 0; i < x.size(); ++i)
+			{
+				x[i] = rnd.NextFloat() * width;
+				y[i] = rnd.NextFloat() * height;
+			}
+			for (auto& r : rotation)
+				r = rnd.NextFloat() * static_cast<float>(M_PI * 2.0);
+
+			NeuronNetwork<TProp> network(TProp::NetworkSize);
+			std::vector<float> inputs(static_cast<size_t>(numPrey) * TProp::EyeSize);
+
+			// foods after the bodies in x / y
+			auto objectAt = [&](int color, int idx) { return color == 0 ? numBodies + idx : (color == 1 ? idx : numPrey + idx); };
+
+			TTiles tiles(numThreads);
+			tiles.Prepare({ numFoods, numPrey, numPredators }, width, height,
+				[&](int color, int idx, float& ox, float& oy, float& brightness)
+			{
+				ox = x[objectAt(color, idx)];
+				oy = y[objectAt(color, idx)];
+				brightness = 1.0f;
+				return true;
+			});
+
+			double blocked = MeasureSeconds([&]()
+			{
+				for (int run = 0; run < numRuns; ++run)
+				{
+					grid.GridRun([&](int idx, int n)
+					{
+						typename TTiles::Observer observers[TTiles::ObserverTile];
+						for (int from = idx * TTiles::ObserverTile; from < numPrey; from += n * TTiles::ObserverTile)
+						{
+							int count = std::min(TTiles::ObserverTile, numPrey - from);
+							for (int o = 0; o < count; ++o)
+							{
+								int i = from + o;
+								observers[o] = { x[i], y[i], rotation[i], network.Eye.data(), tiles.ObjectIndex(1, i), true,
+									inputs.data() + static_cast<size_t>(i) * TProp::EyeSize };
+							}
+							tiles.Sense(idx, observers, count);
+						}
+					});
+				}
+			}) / numRuns;
+
+			PairTable bodies, foods;
+			auto& kernels = SimulationKernels<TProp>::Get();
+			auto position = [&](int idx, float& ox, float& oy) { ox = x[idx]; oy = y[idx]; };
+			auto foodPosition = [&](int idx, float& ox, float& oy) { ox = x[numBodies + idx]; oy = y[numBodies + idx]; };
+			auto noWrap = [](float&, float&) {};
+			auto seen = [](int, float& energy) { energy = 1.0f; return true; };
+
+			double tables = MeasureSeconds([&]()
+			{
+				for (int run = 0; run < numRuns; ++run)
+				{
+					bodies.BuildSymmetric(grid, numBodies, static_cast<float>(TProp::MaxDistanceSquareVisibility), position, noWrap, seen, AllPairs{});
+					foods.BuildCross(grid, numPrey, numFoods, static_cast<float>(TProp::MaxDistanceSquareVisibility), position, foodPosition, noWrap, seen, AllPairs{});
+
+					grid.GridRun([&](int idx, int n)
+					{
+						constexpr int padded = TTiles::PaddedTripods;
+						alignas(64) float angles[padded] = {};
+						alignas(64) float viewX[padded];
+						alignas(64) float viewY[padded];
+						alignas(64) float widths[padded];
+						alignas(64) float values[padded];
+
+						for (int t = 0; t < padded; ++t)
+							widths[t] = t < TProp::EyeSizeNumTripods ? network.Eye[3 * t].Width : 1.0f;
+
+						for (int i = idx; i < numPrey; i += n)
+						{
+							for (int t = 0; t < TProp::EyeSizeNumTripods; ++t)
+								angles[t] = rotation[i] + network.Eye[3 * t].Direction;
+							kernels.SinCos(angles, viewY, viewX, padded);
+
+							for (PairRow row : { foods.Row(i), bodies.Row(i).Slice(0, numPrey), bodies.Row(i).Slice(numPrey, numBodies) })
+							{
+								std::fill(values, values + padded, 0.0f);
+								kernels.EyeSignals(viewX, viewY, widths, padded, row.data(), row.size(), values);
+								inputs[static_cast<size_t>(i) * TProp::EyeSize] += values[0];
+							}
+						}
+					});
+				}
+			}) / numRuns;
+
+			double pairs = static_cast<double>(numPrey) * (numBodies + numFoods);
+
+			double tablesStep = StepSeconds<BlockedSensingBenchProps<BaseProp, false>>(numThreads, numPrey, numRuns);
+			double blockedStep = StepSeconds<TProp>(numThreads, numPrey, numRuns);
+
+			out << "blocked sensing, " << numPrey << " prey x " << numBodies + numFoods << " objects"
+				<< ": tiles " << std::setprecision(4) << pairs / blocked / 1e6 << " M pairs/s"
+				<< ", sight tables " << pairs / tables / 1e6 << " M pairs/s (x" << tables / blocked << ")"
+				<< "; world step " << tablesStep * 1000.0 << " ms vs " << blockedStep * 1000.0 << " ms" << std::endl;
+		}
+
+		template <typename BaseProp, int Skin>
+		struct NeighborListBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool VectorizedSimulation = true;
+			static constexpr float NeighborListSkin = static_cast<float>(Skin);
+		};
+
+		// Step time of a world with the tables built brute force every step vs from neighbour 
+		// lists with the skin, how often the lists were rebuilt and the share of the brute 
+		// force pairs they handed to the table builds
+		template <typename BaseProp, int Skin>
+		void NeighborListWorld(std::ostream& out, int numThreads, int numPrey, int worldSize, int numSteps)
+		{
+			double plainStep = StepSeconds(*MakeStepWorld<NeighborListBenchProps<BaseProp, 0>>(numThreads, numPrey, true, worldSize, worldSize), numSteps);
+
+			auto listed = MakeStepWorld<NeighborListBenchProps<BaseProp, Skin>>(numThreads, numPrey, true, worldSize, worldSize);
+			double listedStep = StepSeconds(*listed, numSteps);
+
+			auto stats = listed->GetNeighborListStats();
+
+			out << "neighbour lists, skin " << Skin << ", " << numPrey << " prey, " << worldSize << "x" << worldSize
+				<< ": every step " << std::setprecision(4) << plainStep * 1000.0 << " ms"
+				<< ", lists " << listedStep * 1000.0 << " ms per step (x" << plainStep / listedStep << ")"
+				<< ", rebuilt " << stats.Rebuilds << " of " << stats.Updates << " times"
+				<< ", pairs checked " << 100.0 * stats.ListedPairs / stats.AllPairs << "% of brute force" << std::endl;
+		}
+
+		template <typename BaseProp, int ThetaPercent>
+		struct FarFieldBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool VectorizedSimulation = true;
+			static constexpr float FarFieldOpeningAngle = ThetaPercent / 100.0f;
+		};
+
+		// Eye error of FarFieldTree for a few opening angles: numObjects objects in clusters, 
+		// seen by random observers through the exact per-tripod formula (doubles, no Q_rsqrt), 
+		// from all the objects vs from what Collect gives. The error of an eye is the largest 
+		// tripod difference relative to its strongest tripod. Then the world step times with the 
+		// sight tables vs the trees at ThetaPercent / 100
+		template <typename BaseProp, int ThetaPercent>
+		void FarFieldSensing(std::ostream& out, int numThreads, int numObjects, int numPrey, int numSteps)
+		{
+			constexpr int width = BaseProp::WorldWidth;
+			constexpr int height = BaseProp::WorldHeight;
+			constexpr float radiusSquare = static_cast<float>(BaseProp::MaxDistanceSquareVisibility);
+			constexpr float noWrap = std::numeric_limits<float>::max();
+
+			Random rnd;
+			NeuronNetwork<BaseProp> network(BaseProp::NetworkSize);
+
+			std::vector<float> x(numObjects), y(numObjects);
+			for (int i = 0; i < numObjects; i += 64)
+			{
+				float centerX = rnd.NextFloat() * width;
+				float centerY = rnd.NextFloat() * height;
+				for (int j = i; j < std::min(numObjects, i + 64); ++j)
+				{
+					x[j] = std::clamp(centerX + 100.0f * (rnd.NextFloat() + rnd.NextFloat() - 1.0f), 0.0f, float(width));
+					y[j] = std::clamp(centerY + 100.0f * (rnd.NextFloat() + rnd.NextFloat() - 1.0f), 0.0f, float(height));
+				}
+			}
+
+			FarFieldTree tree;
+			tree.Build(numObjects, [&](int idx, float& ox, float& oy, float& energy)
+			{
+				ox = x[idx];
+				oy = y[idx];
+				energy = 1.0f;
+				return true;
+			});
+
+			auto signals = [&](const std::vector<DirectionWithDistanceSquare>& seen, float rotation, std::vector<double>& values)
+			{
+				for (int t = 0; t < BaseProp::EyeSizeNumTripods; ++t)
+				{
+					auto& sensor = network.Eye[3 * t];
+					double viewX = std::cos(rotation + sensor.Direction);
+					double viewY = std::sin(rotation + sensor.Direction);
+
+					values[t] = 0.0;
+					for (auto& item : seen)
+					{
+						double distance = std::sqrt(item.DistanceSquare);
+						double cosine = (viewX * item.DirectionX + viewY * item.DirectionY) / distance;
+						if (cosine > 0.0)
+							values[t] += item.Energy * std::pow(cosine, sensor.Width) / item.DistanceSquare;
+					}
+				}
+			};
+
+			std::vector<DirectionWithDistanceSquare> exact, approximate;
+			std::vector<double> exactValues(BaseProp::EyeSizeNumTripods), approximateValues(BaseProp::EyeSizeNumTripods);
+
+			constexpr int numObservers = 256;
+			std::vector<float> observers(3 * numObservers);
+			for (auto& value : observers)
+				value = rnd.NextFloat();
+
+			out << "far field, " << numObjects << " objects:";
+
+			for (float theta : { 0.25f, 0.5f, 1.0f })
+			{
+				double maxError = 0.0, sumError = 0.0, exactItems = 0.0, approximateItems = 0.0;
+
+				for (int sample = 0; sample < numObservers; ++sample)
+				{
+					float ox = observers[3 * sample] * width;
+					float oy = observers[3 * sample + 1] * height;
+					float rotation = observers[3 * sample + 2] * static_cast<float>(M_PI * 2.0);
+
+					exact.clear();
+					approximate.clear();
+					tree.Collect(ox, oy, -1, 0.0f, radiusSquare, noWrap, noWrap, [](float&, float&) {}, exact);
+					tree.Collect(ox, oy, -1, theta, radiusSquare, noWrap, noWrap, [](float&, float&) {}, approximate);
+					exactItems += exact.size();
+					approximateItems += approximate.size();
+
+					signals(exact, rotation, exactValues);
+					signals(approximate, rotation, approximateValues);
+
+					double strongest = *std::max_element(exactValues.begin(), exactValues.end());
+					double error = 0.0;
+					for (int t = 0; t < BaseProp::EyeSizeNumTripods; ++t)
+						error = std::max(error, std::abs(approximateValues[t] - exactValues[t]));
+
+					if (strongest > 0.0)
+					{
+						maxError = std::max(maxError, error / strongest);
+						sumError += error / strongest;
+					}
+				}
+
+				out << " theta " << theta << " max error " << std::setprecision(3) << maxError * 100.0 << "%"
+					<< " (mean " << sumError * 100.0 / numObservers << "%)"
+					<< ", " << static_cast<int>(approximateItems / numObservers) << " of " << static_cast<int>(exactItems / numObservers) << " entries per eye;";
+			}
+
+			double tables = StepSeconds(*MakeStepWorld<FarFieldBenchProps<BaseProp, 0>>(numThreads, numPrey, true, width, height), numSteps);
+			double trees = StepSeconds(*MakeStepWorld<FarFieldBenchProps<BaseProp, ThetaPercent>>(numThreads, numPrey, true, width, height), numSteps);
+
+			out << " " << numPrey << " prey: sight tables " << std::setprecision(4) << tables * 1000.0 << " ms"
+				<< ", theta " << ThetaPercent / 100.0f << " " << trees * 1000.0 << " ms per step (x" << tables / trees << ")" << std::endl;
+		}
+
+		template <typename BaseProp, int TolerancePermille>
+		struct SensorCacheBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr float SensorCacheTolerance = TolerancePermille / 1000.0f;
+		};
+
+		// Objects drifting by up to 1.25 per step (as the foods do) and observers drifting the 
+		// same, turning by up to 0.1 on one step in 8, seen through SensorCache at the tolerance 
+		// of WorldProp and from scratch each step. Returns the largest tripod difference over the 
+		// run relative to the strongest tripod of the eye, adds the entries the cache evaluated 
+		// and all the entries to stats
+		template <typename WorldProp>
+		double SensorCacheDrift(unsigned int seed, int numObjects, int numObservers, int numSteps, 
+			typename SensorCache<WorldProp>::Stats& stats)
+		{
+			using TCache = SensorCache<WorldProp>;
+
+			constexpr int width = WorldProp::WorldWidth;
+			constexpr int height = WorldProp::WorldHeight;
+			constexpr float radiusSquare = static_cast<float>(WorldProp::MaxDistanceSquareVisibility);
+
+			Random rnd(seed);
+			NeuronNetwork<WorldProp> network(WorldProp::NetworkSize);
+
+			struct Body
+			{
+				float X, Y, VelocityX, VelocityY, Rotation;
+			};
+
+			auto place = [&](Body& body)
+			{
+				body = { rnd.NextFloat() * width, rnd.NextFloat() * height,
+					rnd.NextFloat() * 2.5f - 1.25f, rnd.NextFloat() * 2.5f - 1.25f, rnd.NextFloat() * static_cast<float>(M_PI * 2.0) };
+			};
+
+			std::vector<Body> objects(numObjects), observers(numObservers);
+			for (auto& body : objects)
+				place(body);
+			for (auto& body : observers)
+				place(body);
+
+			auto light = [&](float rotation, const typename TCache::TRows& rows, typename TCache::TValues& values)
+			{
+				for (int t = 0; t < WorldProp::EyeSizeNumTripods; ++t)
+				{
+					auto& sensor = network.Eye[3 * t + 1];
+					float viewX = std::cos(rotation + sensor.Direction);
+					float viewY = std::sin(rotation + sensor.Direction);
+
+					for (auto& item : rows[1])
+					{
+						float modulo = viewX * item.DirectionX + viewY * item.DirectionY;
+						if (modulo > 0.0f)
+							values[1][t] += item.Energy * std::pow(modulo / std::sqrt(item.DistanceSquare), sensor.Width) / item.DistanceSquare;
+					}
+				}
+			};
+
+			TCache cache(1, numObservers);
+			std::vector<DirectionWithDistanceSquare> directions;
+			std::vector<int> indices;
+			double maxError = 0.0;
+
+			for (long step = 0; step < numSteps; ++step)
+			{
+				for (int o = 0; o < numObservers; ++o)
+				{
+					auto& observer = observers[o];
+
+					directions.clear();
+					indices.clear();
+					for (int i = 0; i < numObjects; ++i)
+					{
+						DirectionWithDistanceSquare item;
+						item.Set(objects[i].X - observer.X, objects[i].Y - observer.Y);
+						item.Energy = 1.0f;
+						if (!(item.DistanceSquare > radiusSquare))
+						{
+							directions.push_back(item);
+							indices.push_back(i);
+						}
+					}
+
+					typename TCache::TRows rows{};
+					rows[1] = { directions.data(), indices.data(), static_cast<int>(directions.size()) };
+
+					auto& cached = cache.Update(0, step, o, observer.Rotation, network.Eye.data(), rows, light);
+
+					alignas(64) typename TCache::TValues exact = {};
+					light(observer.Rotation, rows, exact);
+
+					float strongest = *std::max_element(exact[1], exact[1] + WorldProp::EyeSizeNumTripods);
+					for (int t = 0; t < WorldProp::EyeSizeNumTripods; ++t)
+					{
+						if (strongest > 0.0f)
+							maxError = std::max(maxError, static_cast<double>(std::abs(cached[1][t] - exact[1][t]) / strongest));
+					}
+				}
+
+				auto drift = [&](Body& body)
+				{
+					body.X = LoopValue(body.X + body.VelocityX, 0.0f, static_cast<float>(width));
+					body.Y = LoopValue(body.Y + body.VelocityY, 0.0f, static_cast<float>(height));
+				};
+
+				for (auto& body : objects)
+					drift(body);
+				for (auto& body : observers)
+				{
+					drift(body);
+					if (rnd.Next(8) == 0)
+						body.Rotation += rnd.NextFloat() * 0.2f - 0.1f;
+				}
+			}
+
+			stats += cache.GetStats();
+			return maxError;
+		}
+
+		// SensorCacheDrift at TolerancePermille / 1000 over seeds 1..numSeeds: largest and median 
+		// error of the runs against boundPercent, the bound documented with SensorCacheTolerance. 
+		// False if the largest one exceeds it
+		template <typename BaseProp, int TolerancePermille>
+		bool SensorCacheDriftBound(std::ostream& out, int numSeeds, double boundPercent)
+		{
+			using TProp = SensorCacheBenchProps<BaseProp, TolerancePermille>;
+
+			typename SensorCache<TProp>::Stats stats;
+			std::vector<double> errors;
+			for (int seed = 1; seed <= numSeeds; ++seed)
+				errors.push_back(100.0 * SensorCacheDrift<TProp>(static_cast<unsigned int>(seed), 1024, 64, 64, stats));
+
+			std::sort(errors.begin(), errors.end());
+			double maxError = errors.back();
+
+			out << " tolerance " << TProp::SensorCacheTolerance << " max error " << std::setprecision(3) << maxError << "%"
+				<< (maxError <= boundPercent ? "" : " (exceeds bound)")
+				<< " (median " << errors[errors.size() / 2] << "% of " << numSeeds << " runs)"
+				<< ", evaluated " << 100.0 * stats.Evaluated / stats.Entries << "% of the entries;";
+
+			return maxError <= boundPercent;
+		}
+
+		// SensorCacheDriftBound for a few tolerances, then the world step times without the cache 
+		// and with it at TolerancePermille / 1000, with the share of the entries evaluated and 
+		// of the cells x colors computed from scratch. False if a drift exceeds its bound
+		template <typename BaseProp, int TolerancePermille>
+		bool TemporalSensorCache(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			out << "sensor cache:";
+			bool withinBounds = SensorCacheDriftBound<BaseProp, 5>(out, 8, 20.0);
+			withinBounds = SensorCacheDriftBound<BaseProp, 10>(out, 8, 25.0) && withinBounds;
+			withinBounds = SensorCacheDriftBound<BaseProp, 20>(out, 8, 35.0) && withinBounds;
+
+			double plainStep = StepSeconds<SensorCacheBenchProps<BaseProp, 0>>(numThreads, numPrey, numSteps);
+
+			auto cached = MakeStepWorld<SensorCacheBenchProps<BaseProp, TolerancePermille>>(numThreads, numPrey);
+			double cachedStep = StepSeconds(*cached, numSteps);
+
+			auto stats = cached->GetSensorCacheStats();
+
+			out << " " << numPrey << " prey: from scratch " << std::setprecision(4) << plainStep * 1000.0 << " ms"
+				<< ", tolerance " << TolerancePermille / 1000.0f << " " << cachedStep * 1000.0 << " ms per step (x" << plainStep / cachedStep << ")"
+				<< ", evaluated " << 100.0 * stats.Evaluated / stats.Entries << "% of the entries"
+				<< ", " << 100.0 * stats.FullUpdates / stats.Updates << "% from scratch" << std::endl;
+
+			return withinBounds;
+		}
+
+		template <typename BaseProp, bool Skip>
+		struct DormantBenchProps : public BaseProp
+		{
+			static constexpr bool SkipDormantCells = Skip;
+		};
+
+		template <typename BaseProp>
+		struct UnmemoizedBenchProps : public BaseProp
+		{
+			static constexpr bool MemoizeWeightedInput = false;
+			static constexpr NetworkEvaluationBackend NetworkBackend = NetworkEvaluationBackend::PerCell;
+		};
+
+		// World step times with DormantPercent of the prey out of energy, going through the 
+		// network anyway and skipped by SkipDormantCells, and the share of the bodies the 
+		// latter had active on the last step (some of the starved ones eat and come back). 
+		// With MemoizeWeightedInput a dormant cell's inputs do not change, so going through 
+		// the network only costs it the state updates
+		template <typename BaseProp, int DormantPercent>
+		void DormantCells(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			auto starve = [](auto& world)
+			{
+				auto& prey = world.GetCells();
+				for (int idx = 0; idx < static_cast<int>(prey.size()); ++idx)
+				{
+					if (idx % 100 < DormantPercent)
+						prey.State.EnergyValue[idx] = 0.0f;
+				}
+			};
+
+			auto all = MakeStepWorld<DormantBenchProps<BaseProp, false>>(numThreads, numPrey);
+			auto active = MakeStepWorld<DormantBenchProps<BaseProp, true>>(numThreads, numPrey);
+
+			double allStep = StepSeconds(*all, numSteps, [&]() { starve(*all); });
+			double activeStep = StepSeconds(*active, numSteps, [&]() { starve(*active); });
+
+			out << "dormant cells" << (BaseProp::MemoizeWeightedInput ? "" : " (not memoized)") << ", " << DormantPercent << "% of " << numPrey << " prey starved: every cell "
+				<< std::setprecision(4) << allStep * 1000.0 << " ms"
+				<< ", active only " << activeStep * 1000.0 << " ms per step (x" << allStep / activeStep << ")"
+				<< ", " << 100.0 * active->GetNumActiveBodies() / (numPrey + active->GetPredators().size()) << "% active" << std::endl;
+		}
+
+		// NeuronNetwork::CloneFrom with regular / severe mutations, as done on each birth, 
+		// then a whole birth check worth of clones through NetworkCloner on all the workers
+		template <typename WorldProp>
+		void NetworkClone(std::ostream& out, ThreadGrid& grid, int numClones)
+		{
+			using TNetwork = NeuronNetwork<WorldProp>;
+
+			Random rnd;
+			TNetwork source(WorldProp::NetworkSize);
+			TNetwork destination(WorldProp::NetworkSize);
+
+			double regular = MeasureSeconds([&]()
+			{
+				for (int i = 0; i < numClones; ++i)
+					destination.CloneFrom(source, rnd, false, 0.0f);
+			});
+
+			double severe = MeasureSeconds([&]()
+			{
+				for (int i = 0; i < numClones; ++i)
+					destination.CloneFrom(source, rnd, true, 0.5f);
+			});
+
+			std::vector<std::unique_ptr<TNetwork>> destinations;
+			for (int i = 0; i < numClones; ++i)
+				destinations.push_back(std::make_unique<TNetwork>(WorldProp::NetworkSize));
+
+			NetworkCloner<WorldProp> cloner;
+
+			double batch = MeasureSeconds([&]()
+			{
+				for (auto& network : destinations)
+					cloner.Add(source, *network, rnd, true, 0.5f);
+
+				grid.GridRun([&](int idx, int n) { cloner.Run(idx, n); });
+				cloner.Finish();
+			});
+
+			double weights = static_cast<double>(source.Weights.size()) * numClones;
+
+			out << "network clone, NetworkSize " << WorldProp::NetworkSize
+				<< ": regular " << std::setprecision(4) << regular * 1000.0 / numClones << " ms"
+				<< ", severe " << severe * 1000.0 / numClones << " ms"
+				<< " (" << weights / regular / 1e6 << " M weights/s)"
+				<< "; batch of " << numClones << " on " << grid.GetNumThreads() << " threads " << batch * 1000.0 << " ms" << std::endl;
+		}
+
+		// Round trip of an empty GridRun (hand the task to the workers, wait for all of them) 
+		// for 1 to maxThreads threads, back to back as World::Iterate does them
+		inline void GridRunLatency(std::ostream& out, int maxThreads, int numRuns)
+		{
+			out << "grid run latency:";
+
+			for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+			{
+				ThreadGrid grid(numThreads);
+				auto task = [](int, int) {};
+
+				for (int run = 0; run < numRuns / 10; ++run)
+					grid.GridRun(task);
+
+				double seconds = MeasureSeconds([&]()
+				{
+					for (int run = 0; run < numRuns; ++run)
+						grid.GridRun(task);
+				});
+
+				out << " " << numThreads << " threads " << std::setprecision(3) << seconds * 1e6 / numRuns << " us" 
+					<< (numThreads * 2 <= maxThreads ? "," : "");
+			}
+
+			out << std::endl;
+		}
+
+		// How long the slowest worker of each ParallelFor phase of World::Iterate took relative 
+		// to the average one (1 = perfectly even), and how many chunks were stolen per run
+		template <typename WorldProp>
+		void PhaseImbalance(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			auto world = MakeStepWorld<WorldProp>(numThreads, numPrey);
+
+			for (long step = 0; step <= numSteps; ++step)
+				world->Iterate(step);
+
+			out << "phase imbalance, " << numPrey << " prey on " << numThreads << " threads:";
+			for (auto& phase : world->GetPhaseStats())
+			{
+				out << " " << phase.Name << " x" << std::setprecision(3) << phase.Imbalance()
+					<< " (" << static_cast<double>(phase.Steals) / phase.Runs << " steals)";
+			}
+			out << std::endl;
+		}
+
+		template <typename BaseProp, bool Region>
+		struct StepRegionBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool PersistentStepRegion = Region;
+		};
+
+		// World step times of a small world, where handing the phases to the workers is a 
+		// good part of the step: a GridRun for each phase, and the whole step in one region
+		template <typename BaseProp>
+		void StepRegion(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			double phasesStep = StepSeconds<StepRegionBenchProps<BaseProp, false>>(numThreads, numPrey, numSteps);
+			double regionStep = StepSeconds<StepRegionBenchProps<BaseProp, true>>(numThreads, numPrey, numSteps);
+
+			out << "step region, " << numPrey << " prey on " << numThreads << " threads: GridRun per phase "
+				<< std::setprecision(4) << phasesStep * 1e6 << " us"
+				<< ", one region " << regionStep * 1e6 << " us per step (x" << phasesStep / regionStep << ")" << std::endl;
+		}
+
+		template <typename BaseProp, bool Graph>
+		struct StepTaskGraphBenchProps : public StepBenchProps<BaseProp>
+		{
+			static constexpr bool BlockedSensing = false;
+			static constexpr float FarFieldOpeningAngle = 0.0f;
+			static constexpr bool TaskGraphStep = Graph;
+		};
+
+		// World step times phase by phase and as the task graph, with the graph's summed task 
+		// times against its critical path (the most the threads could make of it). The graph 
+		// goes to dotPath for Graphviz, unless empty
+		template <typename BaseProp>
+		void StepTaskGraph(std::ostream& out, int numThreads, int numPrey, int numSteps, const std::string& dotPath)
+		{
+			double phasesStep = StepSeconds<StepTaskGraphBenchProps<BaseProp, false>>(numThreads, numPrey, numSteps);
+
+			// the graph's task times without the initializing step
+			auto graph = MakeStepWorld<StepTaskGraphBenchProps<BaseProp, true>>(numThreads, numPrey);
+			double graphStep = StepSeconds(*graph, numSteps, [&]() { graph->GetStepGraph().ResetTimes(); });
+
+			const TaskGraph& tasks = graph->GetStepGraph();
+
+			out << "step task graph, " << numPrey << " prey on " << numThreads << " threads: phases "
+				<< std::setprecision(4) << phasesStep * 1e3 << " ms"
+				<< ", graph " << graphStep * 1e3 << " ms per step (x" << phasesStep / graphStep << ")"
+				<< ", tasks " << tasks.SumSeconds() * 1e3 << " ms, critical path " << tasks.CriticalPathSeconds() * 1e3 
+				<< " ms (x" << tasks.SumSeconds() / tasks.CriticalPathSeconds() << " at most)" << std::endl;
+
+			if (!dotPath.empty())
+			{
+				std::ofstream dot(dotPath);
+				graph->WriteStepGraph(dot);
+			}
+		}
+
+		template <typename BaseProp, bool Pin, bool Numa>
+		struct NumaBenchProps : public BaseProp
+		{
+			static constexpr int NetworkSize = 256;
+			static constexpr bool TaskGraphStep = false;
+			static constexpr bool PinWorkerThreads = Pin;
+			static constexpr bool NumaAwarePlacement = Numa;
+		};
+
+		// World step times with the workers floating, pinned, and pinned with the networks on 
+		// their cells' nodes. For the pinned ones, per node: how long its workers are busy 
+		// sensing and thinking, and for the placed one the weights the node has and the rate 
+		// its workers go through them (read once a step, by the batched evaluation, or else 
+		// the thinking)
+		template <typename BaseProp>
+		void NumaPlacement(std::ostream& out, int numThreads, int numPrey, int numSteps)
+		{
+			auto measure = [&](auto prop, const char* name)
+			{
+				using TProp = decltype(prop);
+				auto world = MakeStepWorld<TProp>(numThreads, numPrey);
+				double step = StepSeconds(*world, numSteps, [&]() { world->GetGrid().ResetPhaseStats(); });
+
+				out << "numa, " << numPrey << " prey on " << numThreads << " threads, " << name << ": " 
+					<< std::setprecision(4) << step * 1e3 << " ms per step" << std::endl;
+
+				if (!TProp::PinWorkerThreads && !TProp::NumaAwarePlacement)
+					return;
+
+				auto& grid = world->GetGrid();
+				std::vector<size_t> weightBytes = world->GetNodeWeightBytes();
+
+				for (int node = 0; node < grid.GetNumNodes(); ++node)
+				{
+					double busy = 0.0;
+					double thinking = 0.0;
+					double networks = 0.0;
+					for (auto& phase : grid.GetPhaseStats())
+					{
+						std::string name = phase.Name;
+						if (name == "sensing" || name == "thinking")
+							busy += phase.NodeBusySeconds[node] / numSteps;
+						if (name == "thinking")
+							thinking = phase.NodeBusySeconds[node] / numSteps;
+						if (name == "networks")
+							networks = phase.NodeBusySeconds[node] / numSteps;
+					}
+
+					out << "    node " << node << ": " << grid.GetNodeNumWorkers(node) << " workers, busy " 
+						<< busy * 1e3 << " ms per step";
+
+					if (TProp::NumaAwarePlacement)
+					{
+						double reading = networks > 0.0 ? networks : thinking;
+						out << ", " << weightBytes[node] / 1e6 << " MB of weights, " 
+							<< (reading > 0.0 ? weightBytes[node] / reading / 1e9 : 0.0) << " GB/s";
+					}
+
+					out << std::endl;
+				}
+			};
+
+			measure(NumaBenchProps<BaseProp, false, false>{}, "floating");
+			measure(NumaBenchProps<BaseProp, true, false>{}, "pinned");
+			measure(NumaBenchProps<BaseProp, true, true>{}, "pinned, networks on their nodes");
+		}
+
+		// False if a check among the benchmarks failed
+		template <typename WorldProp>
+		bool RunAll(std::ostream& out, int numThreads)
+		{
+			SetFlushDenormalsToZero();
+
+			ThreadGrid grid(numThreads);
+
+			out << "threads: " << numThreads << ", kernel: " << KernelIsaName(KernelDispatch::Selected()) << std::endl;
+
+			GridRunLatency(out, 64, 2000);
+
+			WorldStep<WorldProp>(out, numThreads, 64);
+			PhaseImbalance<WorldProp>(out, numThreads, 1024, 32);
+			StepRegion<WorldProp>(out, numThreads, 128, 256);
+			StepTaskGraph<WorldProp>(out, numThreads, 512, 64, "step_graph.dot");
+			NumaPlacement<WorldProp>(out, numThreads, 1024, 16);
+			NetworkClone<WorldProp>(out, grid, 32);
+
+			constexpr int numCells = WorldProp::WorldSize + WorldProp::PredatorCountPerIteration;
+
+			NetworkBackends<WorldProp, 384>(out, grid, numCells, 16);
+			NetworkBackends<WorldProp, 1024>(out, grid, numCells, 4);
+			NetworkBackends<WorldProp, 2048>(out, grid, numCells / 4, 4);
+
+			WeightStorageCompare<WorldProp, WeightStorage::BFloat16>(out, grid, "bf16", numCells, 16);
+			WeightStorageCompare<WorldProp, WeightStorage::Int8>(out, grid, "int8", numCells, 16);
+
+			FixedPointCompare<WorldProp>(out, grid, numCells, 16);
+
+			StateUpdateShare<WorldProp>(out, numCells, 16);
+
+			SparseInputs<WorldProp>(out, grid, numCells, 16);
+
+			IntraNetworkScaling<WorldProp>(out, 64, 16, 4);
+
+			SpatialGridWorld<WorldProp>(out, numThreads, 10240, 16384, 2);
+
+			EyeModels<WorldProp, 32>(out, numThreads, 1024, 4);
+			EyeModels<WorldProp, 128>(out, numThreads, 1024, 4);
+
+			bool passed = VectorMathAccuracy<WorldProp>(out);
+			VectorizedSimulationWorld<WorldProp>(out, numThreads, 1024, 4);
+
+			BlockedSensingThroughput<WorldProp>(out, numThreads, 512, 4);
+			BlockedSensingThroughput<WorldProp>(out, numThreads, 2048, 4);
+
+			NeighborListWorld<WorldProp, 32>(out, numThreads, 2048, 4096, 32);
+
+			FarFieldSensing<WorldProp, 50>(out, numThreads, 16384, 8192, 2);
+
+			passed = TemporalSensorCache<WorldProp, 10>(out, numThreads, 1024, 32) && passed;
+
+			DormantCells<WorldProp, 0>(out, numThreads, 1024, 16);
+			DormantCells<WorldProp, 90>(out, numThreads, 1024, 16);
+			DormantCells<UnmemoizedBenchProps<WorldProp>, 90>(out, numThreads, 1024, 16);
+
+			return passed;
+		}
+	}
+}
@@ -5,6 +5,9 @@
 #define _USE_MATH_DEFINES
 
 #include <memory>
+#include <vector>
+#include <numeric>
+#include <algorithm>
 #include <math.h>
 
 #include "../Random.h"
@@ -13,11 +16,15 @@
 #include "NeuronNetwork.h"
 
 #include "WorldUtils.h"
+#include "EntityStore.h"
+#include "Population.h"
 
 namespace Neurolution
 {
+	// Cold part of a prey / predator, the hot one (location, velocity, rotation, energy) is in 
+	// the EntityStore of its CellPopulation, see CellRef
 	template <typename WorldProp>
-    struct Cell : public MaterialPointWithEnergyValue
+    struct Cell
     {
 		using TNetwork = NeuronNetwork<WorldProp>;
         std::shared_ptr<TNetwork> Network;
@@ -45,14 +52,14 @@ namespace Neurolution
 
         bool IsPredator{ false };
 
-        Cell(Random& r, int maxX, int maxY, bool isPredator = false)
+        // NUMA node whose memory has the network (NumaAwarePlacement)
+        int HomeNode{ 0 };
+
+        Cell(Random& r, bool isPredator = false)
             : random(r)
             , Network(std::make_shared<TNetwork>(WorldProp::NetworkSize))
             , IsPredator(isPredator)
         {
-			LocationX = static_cast<float>(r.NextDouble() * maxX);
-			LocationY = static_cast<float>(r.NextDouble() * maxY);
-			Rotation = static_cast<float>(r.NextDouble() * 2.0 * M_PI);
 		}
 
         void PrepareIteration() noexcept
@@ -103,41 +110,9 @@ namespace Neurolution
             Age = 0;
         }
 
-        void RandomizeLocation(Random& rnd, int parentX, int parentY, int maxX, int maxY) noexcept
-        {
-            LocationX = parentX + static_cast<float>(rnd.NextDouble()*maxX/10 - maxX/20);
-            LocationY = parentY + static_cast<float>(rnd.NextDouble()*maxY/10 - maxY/20);
-            if (LocationX < 0)
-                LocationX = 0;
-            else if (LocationX > maxX)
-                LocationX = maxX;
-            if (LocationY < 0)
-                LocationY = 0;
-            else if (LocationY > maxY)
-                LocationY = maxY;
-            Rotation = static_cast<float>(rnd.NextDouble() * 2.0 * M_PI);
-        }
-
-        bool PredatoryEat(float& preyEnergy) noexcept
-        {
-            for (;;)
-            {
-                float valueCopy = InterlockedCompareExchange(&EnergyValue, 0.0f, 0.0f); // means just read
-                float newValue = valueCopy + preyEnergy;
-
-                if (InterlockedCompareExchange(&EnergyValue, newValue, valueCopy) == valueCopy)
-                {
-                    break;
-                }
-            }
-
-            return true;
-        }
-
+		// the hot part is saved / loaded by EntityStore, right before this
 		void SaveTo(std::ostream& stream)
 		{
-			this->MaterialPointWithEnergyValue::SaveTo(stream);
-			
 			//stream.write(reinterpret_cast<const char*>(&LocationX), sizeof(LocationX));
 			//stream.write(reinterpret_cast<const char*>(&LocationY), sizeof(LocationY));
 			//stream.write(reinterpret_cast<const char*>(&Rotation), sizeof(Rotation));
@@ -153,8 +128,6 @@ namespace Neurolution
 
 		void LoadFrom(std::istream& stream)
 		{
-			this->MaterialPointWithEnergyValue::LoadFrom(stream);
-
 			//stream.read(reinterpret_cast<char*>(&LocationX), sizeof(LocationX));
 			//stream.read(reinterpret_cast<char*>(&LocationY), sizeof(LocationY));
 			//stream.read(reinterpret_cast<char*>(&Rotation), sizeof(Rotation));
@@ -169,4 +142,110 @@ namespace Neurolution
 		}
     };
 
+	// One cell: its hot state in the store, plus the cold record through ->
+	template <typename TCell>
+	class CellRef : public EntityRef
+	{
+		TCell* _cell;
+
+	public:
+		CellRef(EntityStore& store, int index, TCell& cell) noexcept
+			: EntityRef(store, index)
+			, _cell(&cell)
+		{
+		}
+
+		TCell* operator->() const noexcept { return _cell; }
+		TCell& Cold() const noexcept { return *_cell; }
+
+		// same group and slot
+		bool operator==(const CellRef& other) const noexcept
+		{
+			return _store == other._store && _index == other._index;
+		}
+
+		void RandomizeLocation(Random& rnd, int parentX, int parentY, int maxX, int maxY) const noexcept
+		{
+			float& locationX = LocationX();
+			float& locationY = LocationY();
+
+            locationX = parentX + static_cast<float>(rnd.NextDouble()*maxX/10 - maxX/20);
+            locationY = parentY + static_cast<float>(rnd.NextDouble()*maxY/10 - maxY/20);
+            if (locationX < 0)
+                locationX = 0;
+            else if (locationX > maxX)
+                locationX = maxX;
+            if (locationY < 0)
+                locationY = 0;
+            else if (locationY > maxY)
+                locationY = maxY;
+            Rotation() = static_cast<float>(rnd.NextDouble() * 2.0 * M_PI);
+		}
+
+        bool PredatoryEat(float& preyEnergy) const noexcept
+        {
+			AddEnergy(preyEnergy);
+            return true;
+        }
+	};
+
+	// All the prey or all the predators: cold records and hot state, same order
+	template <typename TCell>
+	class CellPopulation
+	{
+		std::vector<int> _order;
+
+	public:
+		Population<std::shared_ptr<TCell>> Cells;
+		EntityStore State;
+
+		CellPopulation(size_t size)
+			: Cells(size, true)
+			, State(size, true)
+		{
+		}
+
+		size_t size() const noexcept
+		{
+			return Cells.size();
+		}
+
+		CellRef<TCell> operator[](int idx) noexcept
+		{
+			return CellRef<TCell>(State, idx, *Cells[idx]);
+		}
+
+		// Reorders both parts, highest energy first (same order as sorting the cells themselves)
+		void SortByEnergy()
+		{
+			_order.resize(size());
+			std::iota(_order.begin(), _order.end(), 0);
+			std::sort(_order.begin(), _order.end(), [&](int x, int y) {
+				return State.EnergyValue[x] > State.EnergyValue[y];
+			});
+
+			std::vector<std::shared_ptr<TCell>> cells(size());
+			for (size_t i = 0; i < _order.size(); ++i)
+				cells[i] = std::move(Cells[_order[i]]);
+			std::move(cells.begin(), cells.end(), Cells.begin());
+
+			State.Gather(_order);
+		}
+
+		void SaveTo(std::ostream& stream)
+		{
+			State.SaveTo(stream, [&](int idx, std::ostream& s) { Cells[idx]->SaveTo(s); });
+		}
+
+		void LoadFrom(std::istream& stream)
+		{
+			// Population::LoadFrom would also read the sizes, they are shared with the store
+			State.LoadFrom(stream, [&](int idx, std::istream& s)
+			{
+				if (Cells.size() != State.size())
+					Cells.resize(State.size());
+				Cells[idx]->LoadFrom(s);
+			});
+		}
+	};
 }
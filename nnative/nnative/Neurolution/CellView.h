@@ -24,32 +24,35 @@ namespace Neurolution
 	template <typename WorldProp, typename TCell>
     class CellView
     {
-        std::shared_ptr<TCell> _cell;
+        // slot in the population, the cell is looked up on each draw since births reorder them
+        CellPopulation<TCell>* _cells;
+        int _index;
 
 		Color _predatorColor{ 64, 64, 255 };
 	public:
 
-        CellView(std::shared_ptr<TCell>& c, Random& rnd)
-            : _cell(c)
+        CellView(CellPopulation<TCell>& cells, int index, Random& rnd)
+            : _cells(&cells)
+            , _index(index)
         {
         }
 
-        void DrawNonPredator()
+        void DrawNonPredator(const CellRef<TCell>& cell)
         {
-            if (_cell->EnergyValue >= 0.0001f &&
-                _cell->LocationX >= 0.0 && _cell->LocationX < WorldProp::WorldWidth
-                && _cell->LocationY >= 0.0 && _cell->LocationY < WorldProp::WorldHeight)
+            if (cell.EnergyValue() >= 0.0001f &&
+                cell.LocationX() >= 0.0 && cell.LocationX() < WorldProp::WorldWidth
+                && cell.LocationY() >= 0.0 && cell.LocationY() < WorldProp::WorldHeight)
             {
                 glPushMatrix();
 
-                glTranslatef(_cell->LocationX, _cell->LocationY, 0.0);
+                glTranslatef(cell.LocationX(), cell.LocationY(), 0.0);
                 glRotatef(
-                    static_cast<float>(_cell->Rotation / M_PI * 180.0 - 90.0),
+                    static_cast<float>(cell.Rotation() / M_PI * 180.0 - 90.0),
                     0.0f, 0.0f, 1.0f);
 
                 glBegin(GL_TRIANGLES);
 
-                float energy = _cell->EnergyValue;
+                float energy = cell.EnergyValue();
                 float factor = (energy > WorldProp::SedatedAtEnergyLevel) ? 1.0f : energy / WorldProp::SedatedAtEnergyLevel;
 
                 glColor3f(1.0f - factor, factor, 0.0f);
@@ -70,8 +73,8 @@ namespace Neurolution
 
 				glColor3f(0.5f, 0.24f, 0.24f);
 
-				auto l = fMin(_cell->TotalMoveForceLeft, 30.0f);
-				auto r = fMin(_cell->TotalMoveForceRight, 30.0f);
+				auto l = fMin(cell->TotalMoveForceLeft, 30.0f);
+				auto r = fMin(cell->TotalMoveForceRight, 30.0f);
 
 				glIndexi(10); glVertex2f(5.0f * scale, -6.0f * scale);
 				glIndexi(11); glVertex2f(8 * scale, -(7.0f + 0.5f * l) * scale);
@@ -81,8 +84,8 @@ namespace Neurolution
 				glIndexi(14); glVertex2f(-8 * scale, -(7.0f + 0.5f * r) * scale);
 				glIndexi(15); glVertex2f(-6 * scale, -(7.0f + 0.5f * r) * scale);
 
-				_cell->TotalMoveForceLeft = 0.0f;
-				_cell->TotalMoveForceRight = 0.0f;
+				cell->TotalMoveForceLeft = 0.0f;
+				cell->TotalMoveForceRight = 0.0f;
 
                 glEnd();
 
@@ -95,16 +98,16 @@ namespace Neurolution
 			return a > b ? b : a;
 		}
 
-		void DrawPredator()
+		void DrawPredator(const CellRef<TCell>& cell)
 		{
-			if (_cell->EnergyValue < 0.001f)
+			if (cell.EnergyValue() < 0.001f)
 				return;
 
 			glPushMatrix();
 
-			glTranslatef(_cell->LocationX, _cell->LocationY, 0.0);
+			glTranslatef(cell.LocationX(), cell.LocationY(), 0.0);
 			glRotatef(
-				static_cast<float>(_cell->Rotation / M_PI * 180.0 - 90.0),
+				static_cast<float>(cell.Rotation() / M_PI * 180.0 - 90.0),
 				0.0f, 0.0f, 1.0f);
 
 			_predatorColor.GlApply();
@@ -135,8 +138,8 @@ namespace Neurolution
 
 			glColor3f(0.5f, 0.24f, 0.24f);
 
-			auto l = fMin(_cell->TotalMoveForceLeft, 30.0f);
-			auto r = fMin(_cell->TotalMoveForceRight, 30.0f);
+			auto l = fMin(cell->TotalMoveForceLeft, 30.0f);
+			auto r = fMin(cell->TotalMoveForceRight, 30.0f);
 
 			glIndexi(++idx); glVertex2f(6.0f * scale, -4.0f * scale);
 			glIndexi(++idx); glVertex2f(8 * scale, -(7.0f + 0.5f * l) * scale);
@@ -146,8 +149,8 @@ namespace Neurolution
 			glIndexi(++idx); glVertex2f(-8 * scale, -(7.0f + 0.5f * r) * scale);
 			glIndexi(++idx); glVertex2f(-6 * scale, -(7.0f + 0.5f * r) * scale);
 
-			_cell->TotalMoveForceLeft = 0.0f;
-			_cell->TotalMoveForceRight = 0.0f;
+			cell->TotalMoveForceLeft = 0.0f;
+			cell->TotalMoveForceRight = 0.0f;
 
 			glEnd();
 
@@ -156,10 +159,11 @@ namespace Neurolution
 
 		void Draw()
 		{
-			if (_cell->IsPredator)
-				DrawPredator();
+			auto cell = (*_cells)[_index];
+			if (cell->IsPredator)
+				DrawPredator(cell);
 			else
-				DrawNonPredator();
+				DrawNonPredator(cell);
 		}
     };
 }
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <iostream>
+#include <utility>
+
+#include "../Allocators.h"
+#include "../Utils.h"
+
+namespace Neurolution
+{
+	// Hot state of one kind of entities (prey, predators or foods) as a structure of arrays,
+	// what sensing, collisions and physics stream over. The cold part (network, age, lineage)
+	// is kept separately in the same order, see CellPopulation. Slots [0, AliveSize()) are
+	// alive, same bookkeeping as Population
+	class EntityStore
+	{
+	public:
+		using TFloats = std::vector<float, cache_aligned<float>>;
+
+		TFloats LocationX;
+		TFloats LocationY;
+		TFloats VelocityX;
+		TFloats VelocityY;
+		TFloats Rotation;
+		TFloats Mass;
+		TFloats EnergyValue;
+		std::vector<uint8_t, cache_aligned<uint8_t>> Alive;
+
+	private:
+		int _aliveSize{ 0 };
+		TFloats _scratch;
+
+		template <typename TFn>
+		void ForEachArray(TFn&& fn)
+		{
+			fn(LocationX);
+			fn(LocationY);
+			fn(VelocityX);
+			fn(VelocityY);
+			fn(Rotation);
+			fn(Mass);
+			fn(EnergyValue);
+		}
+
+	public:
+		explicit EntityStore(size_t size = 0, bool allAlive = false)
+		{
+			Resize(size);
+			if (allAlive)
+			{
+				_aliveSize = static_cast<int>(size);
+				std::fill(Alive.begin(), Alive.end(), uint8_t{ 1 });
+			}
+		}
+
+		void Resize(size_t size)
+		{
+			ForEachArray([&](TFloats& values) { values.resize(size, &values == &Mass ? 1.0f : 0.0f); });
+			Alive.resize(size, 0);
+			if (_aliveSize > static_cast<int>(size))
+				_aliveSize = static_cast<int>(size);
+		}
+
+		size_t size() const noexcept
+		{
+			return LocationX.size();
+		}
+
+		size_t AliveSize() const noexcept
+		{
+			return _aliveSize;
+		}
+
+		size_t DeadSize() const noexcept
+		{
+			return size() - AliveSize();
+		}
+
+		void Swap(int a, int b) noexcept
+		{
+			ForEachArray([&](TFloats& values) { std::swap(values[a], values[b]); });
+			std::swap(Alive[a], Alive[b]);
+		}
+
+		// Slot order[i] goes to slot i, for all the slots
+		void Gather(const std::vector<int>& order)
+		{
+			_scratch.resize(size());
+			ForEachArray([&](TFloats& values)
+			{
+				for (size_t i = 0; i < order.size(); ++i)
+					_scratch[i] = values[order[i]];
+				values.swap(_scratch);
+			});
+
+			std::vector<uint8_t, cache_aligned<uint8_t>> alive(Alive.size());
+			for (size_t i = 0; i < order.size(); ++i)
+				alive[i] = Alive[order[i]];
+			Alive.swap(alive);
+		}
+
+		// fn(idx) says which alive slots to kill, as Population::KillAll
+		template <typename F>
+		void KillAll(F&& fn) noexcept
+		{
+			for (int idx = 0; idx < _aliveSize; ++idx)
+			{
+				if (fn(idx))
+				{
+					Swap(idx, _aliveSize - 1);
+					Alive[_aliveSize - 1] = 0;
+					--_aliveSize;
+				}
+			}
+		}
+
+		int Reanimate() noexcept
+		{
+			if (DeadSize() == 0)
+			{
+				std::cout << "No dead bodies left" << std::endl;
+				std::terminate();
+			}
+			Alive[_aliveSize] = 1;
+			return _aliveSize++;
+		}
+
+		// One entity, same layout as MaterialPointWithEnergyValue::SaveTo
+		void SaveTo(std::ostream& stream, int idx) const
+		{
+			for (const TFloats* values : { &Rotation, &LocationX, &LocationY, &VelocityX, &VelocityY, &Mass, &EnergyValue })
+				stream.write(reinterpret_cast<const char*>(&(*values)[idx]), sizeof(float));
+		}
+
+		void LoadFrom(std::istream& stream, int idx)
+		{
+			for (TFloats* values : { &Rotation, &LocationX, &LocationY, &VelocityX, &VelocityY, &Mass, &EnergyValue })
+				stream.read(reinterpret_cast<char*>(&(*values)[idx]), sizeof(float));
+		}
+
+		// Whole store, same layout as Population::SaveTo of MaterialPointWithEnergyValue items,
+		// fn(idx, stream) adds the cold part of each entity
+		template <typename TSerializeFn>
+		void SaveTo(std::ostream& stream, TSerializeFn fn) const
+		{
+			int sz = static_cast<int>(size());
+			stream.write(reinterpret_cast<const char*>(&sz), sizeof(sz));
+			stream.write(reinterpret_cast<const char*>(&_aliveSize), sizeof(_aliveSize));
+
+			for (int idx = 0; idx < _aliveSize; ++idx)
+			{
+				SaveTo(stream, idx);
+				fn(idx, stream);
+			}
+		}
+
+		// fn(idx, stream) is called after the size is known, to load the cold part
+		template <typename TSerializeFn>
+		void LoadFrom(std::istream& stream, TSerializeFn fn)
+		{
+			int sz{ 0 };
+			stream.read(reinterpret_cast<char*>(&sz), sizeof(sz));
+			Resize(sz);
+
+			stream.read(reinterpret_cast<char*>(&_aliveSize), sizeof(_aliveSize));
+			std::fill(Alive.begin(), Alive.end(), uint8_t{ 0 });
+
+			for (int idx = 0; idx < _aliveSize; ++idx)
+			{
+				Alive[idx] = 1;
+				LoadFrom(stream, idx);
+				fn(idx, stream);
+			}
+		}
+	};
+
+	// Lightweight handle to one entity in an EntityStore, to write the per-entity code as
+	// before the split. Only valid until the store is resized or reordered
+	class EntityRef
+	{
+	protected:
+		EntityStore* _store;
+		int _index;
+
+	public:
+		EntityRef(EntityStore& store, int index) noexcept
+			: _store(&store)
+			, _index(index)
+		{
+		}
+
+		EntityStore& Store() const noexcept { return *_store; }
+		int Index() const noexcept { return _index; }
+
+		bool Is(const EntityStore& store, int index) const noexcept { return _store == &store && _index == index; }
+
+		float& LocationX() const noexcept { return _store->LocationX[_index]; }
+		float& LocationY() const noexcept { return _store->LocationY[_index]; }
+		float& VelocityX() const noexcept { return _store->VelocityX[_index]; }
+		float& VelocityY() const noexcept { return _store->VelocityY[_index]; }
+		float& Rotation() const noexcept { return _store->Rotation[_index]; }
+		float& Mass() const noexcept { return _store->Mass[_index]; }
+		float& EnergyValue() const noexcept { return _store->EnergyValue[_index]; }
+		bool IsAlive() const noexcept { return _store->Alive[_index] != 0; }
+
+		void Step(int maxX, int maxY, float timeDelta) const noexcept
+		{
+			LocationX() = LoopValue(LocationX() + VelocityX() * timeDelta, 0.0f, static_cast<float>(maxX));
+			LocationY() = LoopValue(LocationY() + VelocityY() * timeDelta, 0.0f, static_cast<float>(maxY));
+		}
+
+		// adds delta to the energy, safe against concurrent updates of the same entity
+		void AddEnergy(float delta) const noexcept
+		{
+			for (;;)
+			{
+				float valueCopy = InterlockedCompareExchange(&EnergyValue(), 0.0f, 0.0f); // means just read
+				if (InterlockedCompareExchange(&EnergyValue(), valueCopy + delta, valueCopy) == valueCopy)
+					break;
+			}
+		}
+	};
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "WorldUtils.h"
+
+namespace Neurolution
+{
+	// Barnes-Hut quadtree over the objects of one color, for the eye. The light falls off as
+	// 1 / d^2, so a group of objects far enough away looks about the same as one object with
+	// their total energy at their energy weighted centroid. Collect goes down the tree from
+	// an observer and emits such aggregates for the nodes seen under an angle below theta
+	// (node size < theta x distance to the node's box), the objects themselves for the rest.
+	// Built once per step, read by all the workers
+	class FarFieldTree
+	{
+	public:
+		static constexpr int LeafSize = 8;
+		static constexpr int MaxDepth = 24; // stops splitting objects on top of each other
+
+	private:
+		struct Object
+		{
+			float X;
+			float Y;
+			float Energy;
+			int Index;
+		};
+
+		struct Node
+		{
+			float MinX;		// bounds of the objects inside
+			float MinY;
+			float MaxX;
+			float MaxY;
+			float CenterX;	// energy weighted centroid
+			float CenterY;
+			float Energy;
+			float Size;		// longer side of the bounds
+			int First;		// objects [First, First + Count)
+			int Count;
+			int Children;	// first of NumChildren consecutive nodes, none for a leaf
+			int NumChildren;
+		};
+
+		std::vector<Object> _objects;
+		std::vector<Node> _nodes;
+
+		void Split(int nodeIdx, int depth)
+		{
+			Node node = _nodes[nodeIdx];
+
+			if (node.Count <= LeafSize || depth >= MaxDepth || node.Size <= 0.0f)
+				return;
+
+			float midX = 0.5f * (node.MinX + node.MaxX);
+			float midY = 0.5f * (node.MinY + node.MaxY);
+
+			auto first = _objects.begin() + node.First;
+			auto last = first + node.Count;
+			auto lower = std::partition(first, last, [midY](const Object& o) { return o.Y < midY; });
+			auto quadrants = {
+				first,
+				std::partition(first, lower, [midX](const Object& o) { return o.X < midX; }),
+				lower,
+				std::partition(lower, last, [midX](const Object& o) { return o.X < midX; }),
+				last };
+
+			int firstChild = static_cast<int>(_nodes.size());
+			int numChildren = 0;
+
+			auto from = quadrants.begin();
+			for (auto to = from + 1; to != quadrants.end(); from = to++)
+			{
+				if (*from == *to)
+					continue;
+
+				_nodes.push_back(MakeNode(static_cast<int>(*from - _objects.begin()), static_cast<int>(*to - *from)));
+				++numChildren;
+			}
+
+			_nodes[nodeIdx].Children = firstChild;
+			_nodes[nodeIdx].NumChildren = numChildren;
+
+			for (int child = firstChild; child < firstChild + numChildren; ++child)
+				Split(child, depth + 1);
+		}
+
+		Node MakeNode(int first, int count) const noexcept
+		{
+			Node node{ _objects[first].X, _objects[first].Y, _objects[first].X, _objects[first].Y,
+				0.0f, 0.0f, 0.0f, 0.0f, first, count, 0, 0 };
+
+			for (int i = first; i < first + count; ++i)
+			{
+				auto& o = _objects[i];
+				node.MinX = std::min(node.MinX, o.X);
+				node.MinY = std::min(node.MinY, o.Y);
+				node.MaxX = std::max(node.MaxX, o.X);
+				node.MaxY = std::max(node.MaxY, o.Y);
+				node.CenterX += o.Energy * o.X;
+				node.CenterY += o.Energy * o.Y;
+				node.Energy += o.Energy;
+			}
+
+			node.CenterX /= node.Energy;
+			node.CenterY /= node.Energy;
+			node.Size = std::max(node.MaxX - node.MinX, node.MaxY - node.MinY);
+			return node;
+		}
+
+	public:
+		// n objects, object(idx, x, y, energy) tells where they are and returns false for the
+		// ones not to be seen (the energy must be > 0 for the others)
+		template <typename TObjectFn>
+		void Build(int n, TObjectFn&& object)
+		{
+			_objects.clear();
+			_nodes.clear();
+
+			for (int idx = 0; idx < n; ++idx)
+			{
+				Object o{ 0.0f, 0.0f, 0.0f, idx };
+				if (object(idx, o.X, o.Y, o.Energy))
+					_objects.push_back(o);
+			}
+
+			if (_objects.empty())
+				return;
+
+			_nodes.push_back(MakeNode(0, static_cast<int>(_objects.size())));
+			Split(0, 0);
+		}
+
+		size_t NumObjects() const noexcept
+		{
+			return _objects.size();
+		}
+
+		// Appends to out what the observer at (x, y) sees within radiusSquare, object self
+		// excluded (-1 for none): the objects of the nearby nodes as the sight tables have them,
+		// and one entry for each node accepted by the opening angle theta (0 = exact). A node is
+		// only accepted or dropped as a whole if its box is completely inside or outside the
+		// radius. displacement(dx, dy) as for the PairTable builds; with wrap-around, the nodes
+		// going further than halfWidth / halfHeight from the observer are always opened, so
+		// everything in them is on the same side
+		template <typename TDisplacementFn>
+		void Collect(
+			float x,
+			float y,
+			int self,
+			float theta,
+			float radiusSquare,
+			float halfWidth,
+			float halfHeight,
+			TDisplacementFn&& displacement,
+			std::vector<DirectionWithDistanceSquare>& out) const
+		{
+			if (_nodes.empty())
+				return;
+
+			float thetaSquare = theta * theta;
+
+			int stack[3 * MaxDepth + 4];
+			int depth = 0;
+			stack[depth++] = 0;
+
+			while (depth > 0)
+			{
+				auto& node = _nodes[stack[--depth]];
+
+				float halfX = 0.5f * (node.MaxX - node.MinX);
+				float halfY = 0.5f * (node.MaxY - node.MinY);
+				float boxX = node.MinX + halfX - x;
+				float boxY = node.MinY + halfY - y;
+				displacement(boxX, boxY);
+
+				float farX = std::abs(boxX) + halfX;
+				float farY = std::abs(boxY) + halfY;
+
+				if (farX <= halfWidth && farY <= halfHeight)
+				{
+					float nearX = std::max(std::abs(boxX) - halfX, 0.0f);
+					float nearY = std::max(std::abs(boxY) - halfY, 0.0f);
+					float nearSquare = nearX * nearX + nearY * nearY;
+
+					if (nearSquare > radiusSquare)
+						continue;
+
+					if (node.NumChildren > 0
+						&& !(farX * farX + farY * farY > radiusSquare)
+						&& node.Size * node.Size < thetaSquare * nearSquare)
+					{
+						float dx = node.CenterX - x;
+						float dy = node.CenterY - y;
+						displacement(dx, dy);
+						out.push_back({ dx, dy, dx * dx + dy * dy, node.Energy });
+						continue;
+					}
+				}
+
+				if (node.NumChildren > 0)
+				{
+					for (int child = node.Children; child < node.Children + node.NumChildren; ++child)
+						stack[depth++] = child;
+					continue;
+				}
+
+				for (int i = node.First; i < node.First + node.Count; ++i)
+				{
+					auto& o = _objects[i];
+					if (o.Index == self)
+						continue;
+
+					float dx = o.X - x;
+					float dy = o.Y - y;
+					displacement(dx, dy);
+
+					float distanceSquare = dx * dx + dy * dy;
+					if (!(distanceSquare > radiusSquare))
+						out.push_back({ dx, dy, distanceSquare, o.Energy });
+				}
+			}
+		}
+	};
+}
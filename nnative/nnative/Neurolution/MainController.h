@@ -106,6 +106,9 @@ namespace Neurolution
             auto lastUIUpdate = std::chrono::high_resolution_clock::now();
 			long lastUpdateAt = 0;
 
+			// same FP environment as on the ThreadGrid workers
+			SetFlushDenormalsToZero();
+
             for (viewDetails.currentIteration = 0; !terminate; ++viewDetails.currentIteration)
             {
 				while (appPaused && !terminate)
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "../ThreadGrid.h"
+
+#include "EntityStore.h"
+#include "PairTable.h"
+
+namespace Neurolution
+{
+	// Verlet lists for a PairTable: the pairs within radius + skin, kept over the steps as the
+	// candidates of the table builds. They hold every pair within the radius as long as no
+	// point has moved more than skin / 2 since they were built; after that, or when the
+	// indices change (Invalidate), they are built again
+	class NeighborLists
+	{
+	public:
+		struct Stats
+		{
+			size_t Updates{ 0 };
+			size_t Rebuilds{ 0 };
+			double ListedPairs{ 0.0 };	// candidates handed to the table builds
+			double AllPairs{ 0.0 };		// what a brute force build would have checked
+
+			Stats& operator+=(const Stats& other) noexcept
+			{
+				Updates += other.Updates;
+				Rebuilds += other.Rebuilds;
+				ListedPairs += other.ListedPairs;
+				AllPairs += other.AllPairs;
+				return *this;
+			}
+		};
+
+	private:
+		static constexpr int PointsPerChunk = 1024;
+
+		PairTable _lists;
+		EntityStore::TFloats _x;	// positions at the last build
+		EntityStore::TFloats _y;
+		bool _valid{ false };
+		Stats _stats;
+
+	public:
+		void Invalidate() noexcept
+		{
+			_valid = false;
+		}
+
+		const Stats& GetStats() const noexcept
+		{
+			return _stats;
+		}
+
+		// numPoints things whose moves matter (rows and objects of the table), at
+		// point(idx, x, y); rebuild(lists) fills the lists when needed. Returns true if rebuilt
+		template <typename TPointFn, typename TRebuildFn>
+		bool Update(ThreadGrid& grid, int numPoints, double allPairs, float skin, TPointFn&& point, TRebuildFn&& rebuild)
+		{
+			++_stats.Updates;
+			_stats.AllPairs += allPairs;
+
+			bool stale = !_valid || numPoints != static_cast<int>(_x.size());
+			if (!stale)
+			{
+				// the furthest any point has moved, squared
+				float moved = grid.ParallelReduce("neighbor lists", 0, numPoints, PointsPerChunk, 0.0f,
+					[&](int, int from, int to)
+				{
+					float chunkMoved = 0.0f;
+					for (int i = from; i < to; ++i)
+					{
+						float x, y;
+						point(i, x, y);
+
+						float dx = x - _x[i];
+						float dy = y - _y[i];
+						chunkMoved = std::max(chunkMoved, dx * dx + dy * dy);
+					}
+					return chunkMoved;
+				},
+				[](float a, float b) { return std::max(a, b); });
+
+				float limit = 0.5f * skin;
+				stale = moved > limit * limit;
+			}
+
+			if (stale)
+			{
+				_x.resize(numPoints);
+				_y.resize(numPoints);
+				for (int i = 0; i < numPoints; ++i)
+					point(i, _x[i], _y[i]);
+
+				rebuild(_lists);
+
+				_valid = true;
+				++_stats.Rebuilds;
+			}
+
+			_stats.ListedPairs += static_cast<double>(_lists.NumPairs());
+			return stale;
+		}
+
+		// the candidates argument of the PairTable builds
+		auto Candidates() const noexcept
+		{
+			return [this](int idx, std::vector<int>& out)
+			{
+				PairRow row = _lists.Row(idx);
+				out.assign(row.Objects, row.Objects + row.Count);
+			};
+		}
+	};
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <vector>
+
+#include "NeuronNetwork.h"
+#include "NeuronKernels.h"
+
+namespace Neurolution
+{
+	// Population-wide evaluation of the neuron weighted inputs (W * x for every network),
+	// filling NeuronNetwork::WeightedInputs so the following network sub-steps only have to
+	// run the state machine.
+	//
+	// Work is split into (network, block of rows) items, so all the workers get the same
+	// amount of multiply-adds regardless of how many networks there are. Inside a block,
+	// rows are processed 4 at a time (NeuronKernels::Dot4), so each loaded input lane is
+	// re-used for 4 rows. Each row keeps the accumulation order of the single-row kernel,
+	// so the results are bit-identical to the per-cell path.
+	//
+	// With few large networks (NetworkSize >= WorldProp::IntraNetworkParallelRatio x number of 
+	// networks) each worker instead always takes the same contiguous block of rows of every 
+	// network, so a single network is spread over all the workers and each worker's share of 
+	// the weights stays in its own cache from one step to the next
+	enum class BatchPartition
+	{
+		Automatic,
+		Items,	// (network, 32 rows) items, round robin
+		Rows	// fixed block of rows of each network per worker
+	};
+
+	template <typename WorldProp>
+	class NetworkBatchEvaluator
+	{
+		using TNetwork = NeuronNetwork<WorldProp>;
+
+		static constexpr int RowsPerPass = 4;
+		static constexpr int RowsPerItem = 32;
+
+		// every network has WorldProp::NetworkSize neurons, NeuronNetwork::LoadFrom rejects others
+		static constexpr int ItemsPerNetwork = (WorldProp::NetworkSize + RowsPerItem - 1) / RowsPerItem;
+
+		std::vector<TNetwork*> _networks;
+
+		BatchPartition _partition{ BatchPartition::Automatic };
+
+	public:
+		template <typename TCellPtr>
+		void Add(std::vector<TCellPtr>& cells) noexcept
+		{
+			for (auto& cell : cells)
+				Add(*cell->Network);
+		}
+
+		void Add(TNetwork& network) noexcept
+		{
+			// Cells that did not get a new input vector since the last evaluation
+			// (dead cells skip PrepareIteration) still have valid weighted inputs
+			if (!network.WeightedInputsValid)
+			{
+				network.PrepareWeightedInputs();
+				_networks.push_back(&network);
+			}
+		}
+
+		void Clear() noexcept
+		{
+			_networks.clear();
+		}
+
+		size_t GetNumNetworks() const noexcept
+		{
+			return _networks.size();
+		}
+
+		// Automatic unless forced (benchmarks)
+		void SetPartition(BatchPartition partition) noexcept
+		{
+			_partition = partition;
+		}
+
+		BatchPartition GetEffectivePartition() const noexcept
+		{
+			if (_partition != BatchPartition::Automatic)
+				return _partition;
+
+			return static_cast<size_t>(WorldProp::NetworkSize) >= WorldProp::IntraNetworkParallelRatio * _networks.size() ? 
+				BatchPartition::Rows : BatchPartition::Items;
+		}
+
+		void Run(int threadIdx, int numThreads) noexcept
+		{
+			if (GetEffectivePartition() == BatchPartition::Rows)
+				RunRows(threadIdx, numThreads);
+			else
+				RunItems(threadIdx, numThreads);
+		}
+
+		// the whole of the networks [from, to) in the order added, on the calling worker: for 
+		// splitting them by the worker that should have them instead (NUMA placement)
+		void RunNetworks(int from, int to) noexcept
+		{
+			for (int idx = from; idx < to; ++idx)
+				EvaluateRows(*_networks[idx], 0, static_cast<unsigned int>(_networks[idx]->GetNetworkSize()));
+		}
+
+		void Finish() noexcept
+		{
+			for (auto network : _networks)
+				network->WeightedInputsValid = true;
+
+			_networks.clear();
+		}
+
+	private:
+		void RunItems(int threadIdx, int numThreads) noexcept
+		{
+			int numItems = static_cast<int>(_networks.size()) * ItemsPerNetwork;
+
+			for (int item = threadIdx; item < numItems; item += numThreads)
+			{
+				auto& network = *_networks[item / ItemsPerNetwork];
+
+				unsigned int rowFrom = (item % ItemsPerNetwork) * RowsPerItem;
+				unsigned int rowTo = rowFrom + RowsPerItem;
+				if (rowTo > network.GetNetworkSize())
+					rowTo = static_cast<unsigned int>(network.GetNetworkSize());
+
+				EvaluateRows(network, rowFrom, rowTo);
+			}
+		}
+
+		void RunRows(int threadIdx, int numThreads) noexcept
+		{
+			for (auto network : _networks)
+			{
+				// Block bounds stay multiples of RowsPerPass, the last worker takes the remainder
+				unsigned int numPasses = static_cast<unsigned int>(network->GetNetworkSize()) / RowsPerPass;
+
+				unsigned int rowFrom = numPasses * threadIdx / numThreads * RowsPerPass;
+				unsigned int rowTo = threadIdx + 1 == numThreads ? 
+					static_cast<unsigned int>(network->GetNetworkSize()) : 
+					numPasses * (threadIdx + 1) / numThreads * RowsPerPass;
+
+				EvaluateRows(*network, rowFrom, rowTo);
+			}
+		}
+
+		static void EvaluateRows(TNetwork& network, unsigned int rowFrom, unsigned int rowTo) noexcept
+		{
+			if constexpr (WorldProp::SparseInputEvaluation)
+			{
+				if (network.UseSparseInputs)
+				{
+					network.EvaluateWeightedInputsSparse(rowFrom, rowTo);
+					return;
+				}
+			}
+
+			unsigned int j = rowFrom;
+
+			// Reduced precision and fixed point weights go row by row
+			if constexpr (WorldProp::ManualLoopUnroll && WorldProp::NetworkWeightStorage == WeightStorage::Float32 && 
+				!WorldProp::FixedPointNetwork)
+			{
+				for (; j + RowsPerPass <= rowTo; j += RowsPerPass)
+				{
+					EvaluateRows4(network, j);
+				}
+			}
+
+			for (; j < rowTo; ++j)
+			{
+				network.EvaluateWeightedInput(j);
+			}
+		}
+
+		static void EvaluateRows4(TNetwork& network, unsigned int j) noexcept
+		{
+			const float* iwptr = network.InputVector.data();
+
+			const float* nwptr[RowsPerPass] = {
+				network.GetWeights(j + 0),
+				network.GetWeights(j + 1),
+				network.GetWeights(j + 2),
+				network.GetWeights(j + 3)
+			};
+
+			float sums[RowsPerPass];
+			NeuronKernels<WorldProp>::Get().Dot4(nwptr, iwptr, network.GetRowSize(), sums);
+
+			for (int r = 0; r < RowsPerPass; ++r)
+			{
+				int neuronPositionInInputVector = j + r + WorldProp::SensorPackSize;
+
+				float weightedInput = -nwptr[r][neuronPositionInInputVector] * iwptr[neuronPositionInInputVector];
+				weightedInput += sums[r];
+
+				network.WeightedInputs[j + r] = weightedInput;
+			}
+		}
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+#include "../Random.h"
+
+#include "NeuronNetwork.h"
+
+namespace Neurolution
+{
+	// All the births of one birth check as a single parallel job: Add() each clone (serial,
+	// draws the seed from the world's generator), Run() on every worker, then Finish().
+	// Work is split into (clone, block of rows) items, so a handful of births still keeps
+	// all the workers busy. Destinations must not be the source of another clone in the same
+	// batch (cloning a network into itself is fine)
+	template <typename WorldProp>
+	class NetworkCloner
+	{
+		using TNetwork = NeuronNetwork<WorldProp>;
+
+		static constexpr int RowsPerItem = 32;
+
+		// every network has WorldProp::NetworkSize neurons, NeuronNetwork::LoadFrom rejects others
+		static constexpr int ItemsPerNetwork = (WorldProp::NetworkSize + RowsPerItem - 1) / RowsPerItem;
+
+		struct CloneJob
+		{
+			const TNetwork* Source;
+			TNetwork* Destination;
+			uint32_t Seed;
+			bool SevereMutations;
+			float Severity;
+		};
+
+		std::vector<CloneJob> _jobs;
+
+	public:
+		void Add(const TNetwork& source, TNetwork& destination, Random& rnd, bool severeMutations, float severity) noexcept
+		{
+			destination.PrepareClone(source);
+			_jobs.push_back({ &source, &destination, static_cast<uint32_t>(rnd.Next()), severeMutations, severity });
+		}
+
+		size_t GetNumJobs() const noexcept
+		{
+			return _jobs.size();
+		}
+
+		// RowsPerItem rows of one of the networks each
+		int GetNumItems() const noexcept
+		{
+			return static_cast<int>(_jobs.size()) * ItemsPerNetwork;
+		}
+
+		void Run(int threadIdx, int numThreads) noexcept
+		{
+			for (int item = threadIdx; item < GetNumItems(); item += numThreads)
+				RunItems(item, item + 1);
+		}
+
+		void RunItems(int from, int to) noexcept
+		{
+			for (int item = from; item < to; ++item)
+			{
+				auto& job = _jobs[item / ItemsPerNetwork];
+
+				size_t rowFrom = static_cast<size_t>(item % ItemsPerNetwork) * RowsPerItem;
+				size_t rowTo = rowFrom + RowsPerItem;
+				if (rowTo > job.Source->GetNetworkSize())
+					rowTo = job.Source->GetNetworkSize();
+
+				job.Destination->CloneRows(*job.Source, job.Seed, job.SevereMutations, job.Severity, rowFrom, rowTo);
+			}
+		}
+
+		void Finish() noexcept
+		{
+			for (auto& job : _jobs)
+				job.Destination->FinishClone(*job.Source);
+
+			_jobs.clear();
+		}
+	};
+}
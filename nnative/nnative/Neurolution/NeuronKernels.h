@@ -0,0 +1,1110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "../Utils.h"
+#include "../FixedPoint.h"
+#include "../CounterRandom.h"
+
+namespace Neurolution
+{
+    // One byte per neuron, the SIMD state update works on packed bytes. Saved to files as int
+    enum class NeuronState : uint8_t
+    {
+        Idle,
+        Excited0,
+        Excited1,
+        Recovering0,
+        Recovering1
+    };
+
+    enum class KernelIsa
+    {
+        Scalar,
+        Sse4,
+        Avx2,
+        Avx512
+    };
+
+    inline const char* KernelIsaName(KernelIsa isa) noexcept
+    {
+        switch (isa)
+        {
+        case KernelIsa::Sse4: return "sse4";
+        case KernelIsa::Avx2: return "avx2";
+        case KernelIsa::Avx512: return "avx512";
+        default: return "scalar";
+        }
+    }
+
+    inline bool ParseKernelIsa(const char* name, KernelIsa& isa) noexcept
+    {
+        for (auto candidate : { KernelIsa::Scalar, KernelIsa::Sse4, KernelIsa::Avx2, KernelIsa::Avx512 })
+        {
+            if (std::strcmp(name, KernelIsaName(candidate)) == 0)
+            {
+                isa = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct CpuFeatures
+    {
+        bool Sse41{ false };
+        bool Avx2Fma{ false };
+        bool Avx512F{ false };
+
+        static const CpuFeatures& Get() noexcept
+        {
+            static const CpuFeatures features = Detect();
+            return features;
+        }
+
+        KernelIsa BestIsa() const noexcept
+        {
+            if (Avx512F)
+                return KernelIsa::Avx512;
+            if (Avx2Fma)
+                return KernelIsa::Avx2;
+            if (Sse41)
+                return KernelIsa::Sse4;
+            return KernelIsa::Scalar;
+        }
+
+        bool Supports(KernelIsa isa) const noexcept
+        {
+            switch (isa)
+            {
+            case KernelIsa::Sse4: return Sse41;
+            case KernelIsa::Avx2: return Avx2Fma;
+            case KernelIsa::Avx512: return Avx512F;
+            default: return true;
+            }
+        }
+
+    private:
+        static void CpuId(int leaf, int subleaf, int regs[4]) noexcept
+        {
+#ifdef _MSC_VER
+            __cpuidex(regs, leaf, subleaf);
+#else
+            unsigned int a, b, c, d;
+            __cpuid_count(leaf, subleaf, a, b, c, d);
+            regs[0] = a; regs[1] = b; regs[2] = c; regs[3] = d;
+#endif
+        }
+
+        static uint64_t XGetBv() noexcept
+        {
+#ifdef _MSC_VER
+            return _xgetbv(0);
+#else
+            uint32_t eax, edx;
+            __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+        }
+
+        static CpuFeatures Detect() noexcept
+        {
+            CpuFeatures ret;
+
+            int regs[4];
+            CpuId(0, 0, regs);
+            int maxLeaf = regs[0];
+
+            if (maxLeaf < 1)
+                return ret;
+
+            CpuId(1, 0, regs);
+            bool sse41 = (regs[2] & (1 << 19)) != 0;
+            bool fma = (regs[2] & (1 << 12)) != 0;
+            bool osxsave = (regs[2] & (1 << 27)) != 0;
+            bool avx = (regs[2] & (1 << 28)) != 0;
+
+            bool avx2 = false;
+            bool avx512f = false;
+            if (maxLeaf >= 7)
+            {
+                CpuId(7, 0, regs);
+                avx2 = (regs[1] & (1 << 5)) != 0;
+                avx512f = (regs[1] & (1 << 16)) != 0;
+            }
+
+            // The OS has to save the YMM (and ZMM / opmask) state on context switches
+            uint64_t xcr0 = osxsave ? XGetBv() : 0;
+            bool osAvx = (xcr0 & 0x6) == 0x6;
+            bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+
+            ret.Sse41 = sse41;
+            ret.Avx2Fma = avx && avx2 && fma && osAvx;
+            ret.Avx512F = ret.Avx2Fma && avx512f && osAvx512;
+
+            return ret;
+        }
+    };
+
+    // Kernel ISA is selected once: explicit Override() (from the "-kernel=<name>" command line
+    // switch) or NNATIVE_KERNEL environment variable, otherwise the best one the CPU supports.
+    // Override() has to happen before the first network is evaluated
+    class KernelDispatch
+    {
+        static KernelIsa& SelectedRef() noexcept
+        {
+            static KernelIsa selected = Initial();
+            return selected;
+        }
+
+        static KernelIsa Initial() noexcept
+        {
+            KernelIsa isa = CpuFeatures::Get().BestIsa();
+
+            const char* env = std::getenv("NNATIVE_KERNEL");
+            KernelIsa requested;
+            if (env != nullptr && ParseKernelIsa(env, requested) && CpuFeatures::Get().Supports(requested))
+                isa = requested;
+
+            return isa;
+        }
+
+    public:
+        static KernelIsa Selected() noexcept
+        {
+            return SelectedRef();
+        }
+
+        // Returns false if the name is unknown or the CPU can't run that kernel
+        static bool Override(const char* name) noexcept
+        {
+            KernelIsa requested;
+            if (!ParseKernelIsa(name, requested) || !CpuFeatures::Get().Supports(requested))
+                return false;
+            SelectedRef() = requested;
+            return true;
+        }
+    };
+
+    // Dot product kernels. All of them accumulate the same 16 partial sums (lane l gets the
+    // products of the elements l, l+16, l+32, ...) and reduce them with the same tree as
+    // the original AVX2 code, so AVX-512 and AVX2 are bit-identical. The scalar and SSE4 ones 
+    // are for CPUs without FMA, where std::fma is a slow software emulation: they round the 
+    // products before the accumulation, so they differ from the FMA kernels in the last bits.
+    // Size must be a multiple of 16, both pointers must be aligned by the vector width
+    namespace NeuronKernelImpl
+    {
+        inline float ReduceLanes(const float lanes[16]) noexcept
+        {
+            float lo = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[8] + lanes[9]) + (lanes[10] + lanes[11]));
+            float hi = ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7])) + ((lanes[12] + lanes[13]) + (lanes[14] + lanes[15]));
+            return lo + hi;
+        }
+
+        inline float DotScalar(const float* w, const float* x, size_t size) noexcept
+        {
+            float acc[16] = { 0 };
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                for (int l = 0; l < 16; ++l)
+                    acc[l] += w[offs + l] * x[offs + l];
+            }
+
+            return ReduceLanes(acc);
+        }
+
+        NN_TARGET_SSE4 inline float ReduceSse(__m128 a, __m128 b) noexcept
+        {
+            a = _mm_hadd_ps(a, b);
+            a = _mm_hadd_ps(a, _mm_setzero_ps());
+            a = _mm_hadd_ps(a, _mm_setzero_ps());
+            return _mm_cvtss_f32(a);
+        }
+
+        NN_TARGET_SSE4 inline float DotSse4(const float* w, const float* x, size_t size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps();
+            __m128 acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps();
+            __m128 acc3 = _mm_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(w + offs + 0), _mm_load_ps(x + offs + 0)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(w + offs + 4), _mm_load_ps(x + offs + 4)));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_load_ps(w + offs + 8), _mm_load_ps(x + offs + 8)));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_load_ps(w + offs + 12), _mm_load_ps(x + offs + 12)));
+            }
+
+            // lanes 0..3 pair with 8..11 and 4..7 with 12..15, same as the 128-bit halves of
+            // the AVX2 reduction below
+            return ReduceSse(acc0, acc2) + ReduceSse(acc1, acc3);
+        }
+
+        NN_TARGET_AVX2 inline float ReduceAvx2(__m256 acc1, __m256 acc2) noexcept
+        {
+            /*
+            a = _mm256_hadd_ps(a, b)
+            a'0 := a1 + a0
+            a'1 := a3 + a2
+            a'2 := b1 + b0
+            a'3 := b2 + b3
+            a'4 := a5 + a4
+            a'5 := a7 + a6
+            a'6 := b5 + b4
+            a'7 := b7 + b6
+
+            2nd:
+            a = _mm256_hadd_ps(a, 0)
+            a''0 := a3 + a2 + a1 + a0
+            a''1 := b2 + b3 + b1 + b0
+            a''2 := 0
+            a''3 := 0
+            a''4 := a7 + a6 + a5 + a4
+            a''5 := b7 + b6 + b5 + b4
+            a''6 := 0
+            a''7 := 0
+
+            3rd:
+            a = _mm256_hadd_ps(a, 0)
+            a'''0 := b2 + b3 + b1 + b0 + a3 + a2 + a1 + a0
+            a'''1 := 0
+            a'''2 := 0
+            a'''3 := 0
+            a'''4 := b7 + b6 + b5 + b4 + a7 + a6 + a5 + a4
+            a'''5 := 0
+            a'''6 := 0
+            a'''7 := 0
+            */
+
+            acc1 = _mm256_hadd_ps(acc1, acc2);
+            acc1 = _mm256_hadd_ps(acc1, _mm256_setzero_ps());
+            acc1 = _mm256_hadd_ps(acc1, _mm256_setzero_ps());
+
+            return _mm_cvtss_f32(_mm256_castps256_ps128(acc1)) + _mm_cvtss_f32(_mm256_extractf128_ps(acc1, 1));
+        }
+
+        NN_TARGET_AVX2 inline float DotAvx2(const float* w, const float* x, size_t size) noexcept
+        {
+            __m256 acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                acc1 = _mm256_fmadd_ps(_mm256_load_ps(w + offs), _mm256_load_ps(x + offs), acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_load_ps(w + offs + 8), _mm256_load_ps(x + offs + 8), acc2);
+            }
+
+            return ReduceAvx2(acc1, acc2);
+        }
+
+        NN_TARGET_AVX512 inline float ReduceAvx512(__m512 acc) noexcept
+        {
+            // lower half holds the lanes of acc1, upper half - of acc2 in the AVX2 version
+            return ReduceAvx2(
+                _mm512_castps512_ps256(acc),
+                _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(acc), 1)));
+        }
+
+        NN_TARGET_AVX512 inline float DotAvx512(const float* w, const float* x, size_t size) noexcept
+        {
+            __m512 acc = _mm512_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+                acc = _mm512_fmadd_ps(_mm512_load_ps(w + offs), _mm512_load_ps(x + offs), acc);
+
+            return ReduceAvx512(acc);
+        }
+
+        // 4 rows at a time, sharing the input loads
+        inline void Dot4Scalar(const float* const w[4], const float* x, size_t size, float sums[4]) noexcept
+        {
+            for (int r = 0; r < 4; ++r)
+                sums[r] = DotScalar(w[r], x, size);
+        }
+
+        NN_TARGET_SSE4 inline void Dot4Sse4(const float* const w[4], const float* x, size_t size, float sums[4]) noexcept
+        {
+            for (int r = 0; r < 4; ++r)
+                sums[r] = DotSse4(w[r], x, size);
+        }
+
+        NN_TARGET_AVX2 inline void Dot4Avx2(const float* const w[4], const float* x, size_t size, float sums[4]) noexcept
+        {
+            __m256 acc01 = _mm256_setzero_ps();
+            __m256 acc02 = _mm256_setzero_ps();
+            __m256 acc11 = _mm256_setzero_ps();
+            __m256 acc12 = _mm256_setzero_ps();
+            __m256 acc21 = _mm256_setzero_ps();
+            __m256 acc22 = _mm256_setzero_ps();
+            __m256 acc31 = _mm256_setzero_ps();
+            __m256 acc32 = _mm256_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                __m256 in1 = _mm256_load_ps(x + offs);
+                __m256 in2 = _mm256_load_ps(x + offs + 8);
+
+                acc01 = _mm256_fmadd_ps(_mm256_load_ps(w[0] + offs), in1, acc01);
+                acc02 = _mm256_fmadd_ps(_mm256_load_ps(w[0] + offs + 8), in2, acc02);
+                acc11 = _mm256_fmadd_ps(_mm256_load_ps(w[1] + offs), in1, acc11);
+                acc12 = _mm256_fmadd_ps(_mm256_load_ps(w[1] + offs + 8), in2, acc12);
+                acc21 = _mm256_fmadd_ps(_mm256_load_ps(w[2] + offs), in1, acc21);
+                acc22 = _mm256_fmadd_ps(_mm256_load_ps(w[2] + offs + 8), in2, acc22);
+                acc31 = _mm256_fmadd_ps(_mm256_load_ps(w[3] + offs), in1, acc31);
+                acc32 = _mm256_fmadd_ps(_mm256_load_ps(w[3] + offs + 8), in2, acc32);
+            }
+
+            sums[0] = ReduceAvx2(acc01, acc02);
+            sums[1] = ReduceAvx2(acc11, acc12);
+            sums[2] = ReduceAvx2(acc21, acc22);
+            sums[3] = ReduceAvx2(acc31, acc32);
+        }
+
+        NN_TARGET_AVX512 inline void Dot4Avx512(const float* const w[4], const float* x, size_t size, float sums[4]) noexcept
+        {
+            __m512 acc0 = _mm512_setzero_ps();
+            __m512 acc1 = _mm512_setzero_ps();
+            __m512 acc2 = _mm512_setzero_ps();
+            __m512 acc3 = _mm512_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                __m512 in = _mm512_load_ps(x + offs);
+
+                acc0 = _mm512_fmadd_ps(_mm512_load_ps(w[0] + offs), in, acc0);
+                acc1 = _mm512_fmadd_ps(_mm512_load_ps(w[1] + offs), in, acc1);
+                acc2 = _mm512_fmadd_ps(_mm512_load_ps(w[2] + offs), in, acc2);
+                acc3 = _mm512_fmadd_ps(_mm512_load_ps(w[3] + offs), in, acc3);
+            }
+
+            sums[0] = ReduceAvx512(acc0);
+            sums[1] = ReduceAvx512(acc1);
+            sums[2] = ReduceAvx512(acc2);
+            sums[3] = ReduceAvx512(acc3);
+        }
+
+        // acc[i] += a * x[i], for the sparse (column by column) evaluation. Any size and alignment
+        inline void AxpyScalar(float a, const float* x, float* acc, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+                acc[i] += a * x[i];
+        }
+
+        NN_TARGET_SSE4 inline void AxpySse4(float a, const float* x, float* acc, size_t size) noexcept
+        {
+            __m128 av = _mm_set1_ps(a);
+
+            size_t i = 0;
+            for (; i + 4 <= size; i += 4)
+                _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(av, _mm_loadu_ps(x + i))));
+
+            for (; i < size; ++i)
+                acc[i] += a * x[i];
+        }
+
+        NN_TARGET_AVX2 inline void AxpyAvx2(float a, const float* x, float* acc, size_t size) noexcept
+        {
+            __m256 av = _mm256_set1_ps(a);
+
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+                _mm256_storeu_ps(acc + i, _mm256_fmadd_ps(av, _mm256_loadu_ps(x + i), _mm256_loadu_ps(acc + i)));
+
+            AxpyScalar(a, x + i, acc + i, size - i);
+        }
+
+        NN_TARGET_AVX512 inline void AxpyAvx512(float a, const float* x, float* acc, size_t size) noexcept
+        {
+            __m512 av = _mm512_set1_ps(a);
+
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+                _mm512_storeu_ps(acc + i, _mm512_fmadd_ps(av, _mm512_loadu_ps(x + i), _mm512_loadu_ps(acc + i)));
+
+            AxpyScalar(a, x + i, acc + i, size - i);
+        }
+
+        // Weight row copy fused with the mutation: dst[i] = src[i] * a + (2u - 1) * b, u being 
+        // CounterRandom(key) value number counter + i. Regular mutation is a = 1, b = max mutation, 
+        // severe one a = alpha, b = 1 - alpha. Integer hash and exact u conversion, separate 
+        // mul / add: all ISAs write the same bits as long as the compiler does not contract 
+        // them into FMAs (SSE4 uses the scalar one)
+        inline void MutateRowScalar(const float* src, float* dst, size_t size, float a, float b, 
+            uint32_t key, uint32_t counter) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                float u = CounterRandom::ToFloat(CounterRandom::Hash(key, counter + static_cast<uint32_t>(i)));
+                float product = src[i] * a;
+                float noise = (2.0f * u - 1.0f) * b;
+                dst[i] = product + noise;
+            }
+        }
+
+        NN_TARGET_AVX2 inline __m256 UniformAvx2(__m256i counters, __m256i key) noexcept
+        {
+            __m256i h = _mm256_add_epi32(_mm256_mullo_epi32(counters, _mm256_set1_epi32(static_cast<int>(CounterRandom::Increment))), key);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(CounterRandom::Mix1)));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+            h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<int>(CounterRandom::Mix2)));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(h, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+        }
+
+        NN_TARGET_AVX2 inline void MutateRowAvx2(const float* src, float* dst, size_t size, float a, float b,
+            uint32_t key, uint32_t counter) noexcept
+        {
+            const __m256 av = _mm256_set1_ps(a);
+            const __m256 bv = _mm256_set1_ps(b);
+            const __m256 two = _mm256_set1_ps(2.0f);
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256i keyv = _mm256_set1_epi32(static_cast<int>(key));
+            const __m256i step = _mm256_set1_epi32(8);
+
+            __m256i counters = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                __m256 u = UniformAvx2(counters, keyv);
+                __m256 noise = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(two, u), one), bv);
+                _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i), av), noise));
+                counters = _mm256_add_epi32(counters, step);
+            }
+
+            MutateRowScalar(src + i, dst + i, size - i, a, b, key, counter + static_cast<uint32_t>(i));
+        }
+
+        NN_TARGET_AVX512 inline void MutateRowAvx512(const float* src, float* dst, size_t size, float a, float b,
+            uint32_t key, uint32_t counter) noexcept
+        {
+            const __m512 av = _mm512_set1_ps(a);
+            const __m512 bv = _mm512_set1_ps(b);
+            const __m512 two = _mm512_set1_ps(2.0f);
+            const __m512 one = _mm512_set1_ps(1.0f);
+            const __m512i keyv = _mm512_set1_epi32(static_cast<int>(key));
+            const __m512i step = _mm512_set1_epi32(16);
+            const __m512i increment = _mm512_set1_epi32(static_cast<int>(CounterRandom::Increment));
+            const __m512i mix1 = _mm512_set1_epi32(static_cast<int>(CounterRandom::Mix1));
+            const __m512i mix2 = _mm512_set1_epi32(static_cast<int>(CounterRandom::Mix2));
+
+            __m512i counters = _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(counter)), 
+                _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m512i h = _mm512_add_epi32(_mm512_mullo_epi32(counters, increment), keyv);
+                h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+                h = _mm512_mullo_epi32(h, mix1);
+                h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 13));
+                h = _mm512_mullo_epi32(h, mix2);
+                h = _mm512_xor_si512(h, _mm512_srli_epi32(h, 16));
+
+                __m512 u = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(h, 8)), _mm512_set1_ps(1.0f / 16777216.0f));
+                __m512 noise = _mm512_mul_ps(_mm512_sub_ps(_mm512_mul_ps(two, u), one), bv);
+                _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_mul_ps(_mm512_loadu_ps(src + i), av), noise));
+                counters = _mm512_add_epi32(counters, step);
+            }
+
+            MutateRowScalar(src + i, dst + i, size - i, a, b, key, counter + static_cast<uint32_t>(i));
+        }
+
+        // Compact weight formats, widened to fp32 in registers. Same lane layout and reduction 
+        // as the fp32 kernels, widening is exact, so AVX2 and AVX-512 agree bit-for-bit here 
+        // too (the scalar and SSE4 ones again round the products). Int8 ones return the 
+        // un-scaled sum, caller applies the row scale
+
+        inline uint16_t FloatToBf16(float value) noexcept
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits += 0x7fff + ((bits >> 16) & 1); // round to nearest even
+            return static_cast<uint16_t>(bits >> 16);
+        }
+
+        inline float Bf16ToFloat(uint16_t value) noexcept
+        {
+            uint32_t bits = static_cast<uint32_t>(value) << 16;
+            float ret;
+            std::memcpy(&ret, &bits, sizeof(ret));
+            return ret;
+        }
+
+        inline float DotBf16Scalar(const uint16_t* w, const float* x, size_t size) noexcept
+        {
+            float acc[16] = { 0 };
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                for (int l = 0; l < 16; ++l)
+                    acc[l] += Bf16ToFloat(w[offs + l]) * x[offs + l];
+            }
+
+            return ReduceLanes(acc);
+        }
+
+        inline float DotInt8Scalar(const int8_t* w, const float* x, size_t size) noexcept
+        {
+            float acc[16] = { 0 };
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                for (int l = 0; l < 16; ++l)
+                    acc[l] += static_cast<float>(w[offs + l]) * x[offs + l];
+            }
+
+            return ReduceLanes(acc);
+        }
+
+        NN_TARGET_SSE4 inline __m128 LoadBf16x4(const uint16_t* w) noexcept
+        {
+            __m128i wide = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(w)));
+            return _mm_castsi128_ps(_mm_slli_epi32(wide, 16));
+        }
+
+        NN_TARGET_SSE4 inline __m128 LoadInt8x4(const int8_t* w) noexcept
+        {
+            int32_t packed;
+            std::memcpy(&packed, w, sizeof(packed));
+            return _mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed)));
+        }
+
+        NN_TARGET_SSE4 inline float DotBf16Sse4(const uint16_t* w, const float* x, size_t size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps();
+            __m128 acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps();
+            __m128 acc3 = _mm_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(LoadBf16x4(w + offs + 0), _mm_load_ps(x + offs + 0)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(LoadBf16x4(w + offs + 4), _mm_load_ps(x + offs + 4)));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(LoadBf16x4(w + offs + 8), _mm_load_ps(x + offs + 8)));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(LoadBf16x4(w + offs + 12), _mm_load_ps(x + offs + 12)));
+            }
+
+            return ReduceSse(acc0, acc2) + ReduceSse(acc1, acc3);
+        }
+
+        NN_TARGET_SSE4 inline float DotInt8Sse4(const int8_t* w, const float* x, size_t size) noexcept
+        {
+            __m128 acc0 = _mm_setzero_ps();
+            __m128 acc1 = _mm_setzero_ps();
+            __m128 acc2 = _mm_setzero_ps();
+            __m128 acc3 = _mm_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(LoadInt8x4(w + offs + 0), _mm_load_ps(x + offs + 0)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(LoadInt8x4(w + offs + 4), _mm_load_ps(x + offs + 4)));
+                acc2 = _mm_add_ps(acc2, _mm_mul_ps(LoadInt8x4(w + offs + 8), _mm_load_ps(x + offs + 8)));
+                acc3 = _mm_add_ps(acc3, _mm_mul_ps(LoadInt8x4(w + offs + 12), _mm_load_ps(x + offs + 12)));
+            }
+
+            return ReduceSse(acc0, acc2) + ReduceSse(acc1, acc3);
+        }
+
+        NN_TARGET_AVX2 inline __m256 LoadBf16x8(const uint16_t* w) noexcept
+        {
+            __m256i wide = _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(w)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+        }
+
+        NN_TARGET_AVX2 inline __m256 LoadInt8x8(const int8_t* w) noexcept
+        {
+            return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(w))));
+        }
+
+        NN_TARGET_AVX2 inline float DotBf16Avx2(const uint16_t* w, const float* x, size_t size) noexcept
+        {
+            __m256 acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                acc1 = _mm256_fmadd_ps(LoadBf16x8(w + offs), _mm256_load_ps(x + offs), acc1);
+                acc2 = _mm256_fmadd_ps(LoadBf16x8(w + offs + 8), _mm256_load_ps(x + offs + 8), acc2);
+            }
+
+            return ReduceAvx2(acc1, acc2);
+        }
+
+        NN_TARGET_AVX2 inline float DotInt8Avx2(const int8_t* w, const float* x, size_t size) noexcept
+        {
+            __m256 acc1 = _mm256_setzero_ps();
+            __m256 acc2 = _mm256_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                acc1 = _mm256_fmadd_ps(LoadInt8x8(w + offs), _mm256_load_ps(x + offs), acc1);
+                acc2 = _mm256_fmadd_ps(LoadInt8x8(w + offs + 8), _mm256_load_ps(x + offs + 8), acc2);
+            }
+
+            return ReduceAvx2(acc1, acc2);
+        }
+
+        NN_TARGET_AVX512 inline float DotBf16Avx512(const uint16_t* w, const float* x, size_t size) noexcept
+        {
+            __m512 acc = _mm512_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                __m512i wide = _mm512_cvtepu16_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(w + offs)));
+                acc = _mm512_fmadd_ps(_mm512_castsi512_ps(_mm512_slli_epi32(wide, 16)), _mm512_load_ps(x + offs), acc);
+            }
+
+            return ReduceAvx512(acc);
+        }
+
+        NN_TARGET_AVX512 inline float DotInt8Avx512(const int8_t* w, const float* x, size_t size) noexcept
+        {
+            __m512 acc = _mm512_setzero_ps();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                __m512i wide = _mm512_cvtepi8_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(w + offs)));
+                acc = _mm512_fmadd_ps(_mm512_cvtepi32_ps(wide), _mm512_load_ps(x + offs), acc);
+            }
+
+            return ReduceAvx512(acc);
+        }
+
+        // Q8.8 quantization of the weights and inputs for WorldProp::FixedPointNetwork: fp16(float) 
+        // rounding, but clamped to -32767..32767 (NaN -> 32767), so a pair of products can't 
+        // overflow the int32 lanes of the 16 bit multiply-adds below. The vector versions clamp 
+        // with min / max, which pick the bound for NaN the same way
+
+        inline int16_t ToFixedScalar(float v) noexcept
+        {
+            float scaled = v * 256.0f;
+            scaled = scaled < 32767.0f ? scaled : 32767.0f;
+            scaled = scaled > -32767.0f ? scaled : -32767.0f;
+            return static_cast<int16_t>(std::nearbyint(scaled));
+        }
+
+        inline void ToFixedRowScalar(const float* src, int16_t* dst, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+                dst[i] = ToFixedScalar(src[i]);
+        }
+
+        NN_TARGET_AVX2 inline __m256i ToFixedAvx2(__m256 v) noexcept
+        {
+            __m256 scaled = _mm256_mul_ps(v, _mm256_set1_ps(256.0f));
+            scaled = _mm256_max_ps(_mm256_min_ps(scaled, _mm256_set1_ps(32767.0f)), _mm256_set1_ps(-32767.0f));
+            return _mm256_cvtps_epi32(scaled); // current rounding mode, as std::nearbyint
+        }
+
+        NN_TARGET_AVX2 inline void ToFixedRowAvx2(const float* src, int16_t* dst, size_t size) noexcept
+        {
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m256i packed = _mm256_packs_epi32(ToFixedAvx2(_mm256_loadu_ps(src + i)), ToFixedAvx2(_mm256_loadu_ps(src + i + 8)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+
+            for (; i < size; ++i)
+                dst[i] = ToFixedScalar(src[i]);
+        }
+
+        // Fixed point (Q8.8 x Q8.8 -> Q16.16) dot products. Each multiply-add pair fits its int32 
+        // lane (see above) and is widened to int64 before summing, so the sum is exact and every 
+        // ISA, thread count or machine gives the same result. AVX-512 would need AVX512BW for the 
+        // 16 bit lanes, so the AVX-512 table uses the AVX2 fixed point kernels
+
+        inline int64_t DotFixedScalar(const int16_t* w, const int16_t* x, size_t size) noexcept
+        {
+            int64_t acc = 0;
+
+            for (size_t i = 0; i < size; ++i)
+                acc += static_cast<int32_t>(w[i]) * x[i];
+
+            return acc;
+        }
+
+        NN_TARGET_SSE4 inline int64_t ReduceEpi64(__m128i acc) noexcept
+        {
+            acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+            return _mm_cvtsi128_si64(acc);
+        }
+
+        NN_TARGET_SSE4 inline __m128i WidenAddEpi32(__m128i acc, __m128i v) noexcept
+        {
+            acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+            return _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_unpackhi_epi64(v, v)));
+        }
+
+        NN_TARGET_SSE4 inline int64_t DotFixedSse4(const int16_t* w, const int16_t* x, size_t size) noexcept
+        {
+            __m128i acc0 = _mm_setzero_si128();
+            __m128i acc1 = _mm_setzero_si128();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                const __m128i* wp = reinterpret_cast<const __m128i*>(w + offs);
+                const __m128i* xp = reinterpret_cast<const __m128i*>(x + offs);
+
+                acc0 = WidenAddEpi32(acc0, _mm_madd_epi16(_mm_load_si128(wp), _mm_load_si128(xp)));
+                acc1 = WidenAddEpi32(acc1, _mm_madd_epi16(_mm_load_si128(wp + 1), _mm_load_si128(xp + 1)));
+            }
+
+            return ReduceEpi64(_mm_add_epi64(acc0, acc1));
+        }
+
+        NN_TARGET_AVX2 inline int64_t DotFixedAvx2(const int16_t* w, const int16_t* x, size_t size) noexcept
+        {
+            __m256i acc0 = _mm256_setzero_si256();
+            __m256i acc1 = _mm256_setzero_si256();
+
+            for (size_t offs = 0; offs < size; offs += 16)
+            {
+                __m256i wv = _mm256_load_si256(reinterpret_cast<const __m256i*>(w + offs));
+                __m256i xv = _mm256_load_si256(reinterpret_cast<const __m256i*>(x + offs));
+                __m256i pairs = _mm256_madd_epi16(wv, xv);
+
+                acc0 = _mm256_add_epi64(acc0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(pairs)));
+                acc1 = _mm256_add_epi64(acc1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(pairs, 1)));
+            }
+
+            __m256i acc = _mm256_add_epi64(acc0, acc1);
+            return ReduceEpi64(_mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)));
+        }
+
+        // Neuron state machine, one neuron at a time
+        template <typename WorldProp>
+        inline void UpdateNeuronState(NeuronState& state, float& charge, float weightedInput, float& output) noexcept
+        {
+            switch (state)
+            {
+            case NeuronState::Idle:
+
+                charge = ValueCap(
+                    charge * WorldProp::NeuronChargeDecay + weightedInput,
+                    WorldProp::NeuronMinCharge,
+                    WorldProp::NeuronMaxCharge
+                );
+
+                if (charge > WorldProp::NeuronChargeThreshold)
+                {
+                    state = NeuronState::Excited0;
+                    output = 1.0f;
+                }
+                else
+                {
+                    output = 0.0f;
+                }
+                break;
+
+            case NeuronState::Excited0:
+                state = NeuronState::Excited1;
+                output = 0.7f;
+                break;
+
+            case NeuronState::Excited1:
+                state = NeuronState::Recovering0;
+                output = 0.2f;
+                break;
+
+            case NeuronState::Recovering0:
+                state = NeuronState::Recovering1;
+                output = 0.0f;
+                break;
+
+            case NeuronState::Recovering1:
+                state = NeuronState::Idle;
+                charge = 0.0f;
+                output = 0.0f;
+                break;
+            }
+        }
+
+        // Same state machine in Q8.8, the charge arithmetic saturates
+        template <typename WorldProp>
+        inline void UpdateNeuronStateFixed(NeuronState& state, fp16& charge, fp16 weightedInput, float& output) noexcept
+        {
+            constexpr fp16 decay = fp16::FromConstant(WorldProp::NeuronChargeDecay);
+            constexpr fp16 minCharge = fp16::FromConstant(WorldProp::NeuronMinCharge);
+            constexpr fp16 maxCharge = fp16::FromConstant(WorldProp::NeuronMaxCharge);
+            constexpr fp16 threshold = fp16::FromConstant(WorldProp::NeuronChargeThreshold);
+
+            switch (state)
+            {
+            case NeuronState::Idle:
+
+                charge = ValueCap(charge * decay + weightedInput, minCharge, maxCharge);
+
+                if (charge > threshold)
+                {
+                    state = NeuronState::Excited0;
+                    output = 1.0f;
+                }
+                else
+                {
+                    output = 0.0f;
+                }
+                break;
+
+            case NeuronState::Excited0:
+                state = NeuronState::Excited1;
+                output = 0.7f;
+                break;
+
+            case NeuronState::Excited1:
+                state = NeuronState::Recovering0;
+                output = 0.2f;
+                break;
+
+            case NeuronState::Recovering0:
+                state = NeuronState::Recovering1;
+                output = 0.0f;
+                break;
+
+            case NeuronState::Recovering1:
+                state = NeuronState::Idle;
+                charge = fp16{};
+                output = 0.0f;
+                break;
+            }
+        }
+
+        template <typename WorldProp>
+        inline void UpdateStatesFixedScalar(NeuronState* states, fp16* charges, const fp16* weightedInputs,
+            float* outputs, size_t size) noexcept
+        {
+            for (size_t j = 0; j < size; ++j)
+                UpdateNeuronStateFixed<WorldProp>(states[j], charges[j], weightedInputs[j], outputs[j]);
+        }
+
+        template <typename WorldProp>
+        inline void UpdateStatesScalar(NeuronState* states, float* charges, const float* weightedInputs,
+            float* outputs, size_t size) noexcept
+        {
+            for (size_t j = 0; j < size; ++j)
+                UpdateNeuronState<WorldProp>(states[j], charges[j], weightedInputs[j], outputs[j]);
+        }
+
+        // Branch-free version of the state machine over 8 / 16 neurons at a time: 
+        //  - Idle: charge = cap(charge * decay + input), goes to Excited0 if above the threshold
+        //  - any other state moves to the next one, Recovering1 -> Idle also zeroes the charge
+        //  - output only depends on the new state: { 0, 1, 0.7, 0.2, 0 }
+        // Charge is mul + add (no FMA) and capped as max(min(max, x), min), which keeps 
+        // ValueCap's behaviour for NaN (-> min), so the results match the scalar code exactly 
+        // (unless the compiler contracts the scalar one into an FMA, as /fp:fast may do)
+        constexpr float StateOutputs[8] = { 0.0f, 1.0f, 0.7f, 0.2f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+        template <typename WorldProp>
+        NN_TARGET_AVX2 inline void UpdateStatesAvx2(NeuronState* states, float* charges, const float* weightedInputs,
+            float* outputs, size_t size) noexcept
+        {
+            const __m256 decay = _mm256_set1_ps(WorldProp::NeuronChargeDecay);
+            const __m256 minCharge = _mm256_set1_ps(WorldProp::NeuronMinCharge);
+            const __m256 maxCharge = _mm256_set1_ps(WorldProp::NeuronMaxCharge);
+            const __m256 threshold = _mm256_set1_ps(WorldProp::NeuronChargeThreshold);
+            const __m256 outputLut = _mm256_loadu_ps(StateOutputs);
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i recovering1 = _mm256_set1_epi32(static_cast<int>(NeuronState::Recovering1));
+
+            uint8_t* stateBytes = reinterpret_cast<uint8_t*>(states);
+
+            size_t j = 0;
+            for (; j + 8 <= size; j += 8)
+            {
+                __m256i state = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(stateBytes + j)));
+                __m256 charge = _mm256_loadu_ps(charges + j);
+
+                __m256 idle = _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, _mm256_setzero_si256()));
+                __m256 lastState = _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, recovering1));
+
+                __m256 idleCharge = _mm256_add_ps(_mm256_mul_ps(charge, decay), _mm256_loadu_ps(weightedInputs + j));
+                idleCharge = _mm256_max_ps(_mm256_min_ps(maxCharge, idleCharge), minCharge);
+
+                __m256 fires = _mm256_and_ps(idle, _mm256_cmp_ps(idleCharge, threshold, _CMP_GT_OQ));
+
+                // next = state + 1, Recovering1 wraps to Idle, Idle stays unless fires
+                __m256i next = _mm256_andnot_si256(_mm256_castps_si256(_mm256_or_ps(lastState, idle)), _mm256_add_epi32(state, one));
+                next = _mm256_or_si256(next, _mm256_and_si256(_mm256_castps_si256(fires), one));
+
+                charge = _mm256_blendv_ps(charge, idleCharge, idle);
+                charge = _mm256_andnot_ps(lastState, charge);
+
+                _mm256_storeu_ps(charges + j, charge);
+                _mm256_storeu_ps(outputs + j, _mm256_permutevar8x32_ps(outputLut, next));
+
+                __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(next), _mm256_extracti128_si256(next, 1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(stateBytes + j), _mm_packus_epi16(packed, packed));
+            }
+
+            for (; j < size; ++j)
+                UpdateNeuronState<WorldProp>(states[j], charges[j], weightedInputs[j], outputs[j]);
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX512 inline void UpdateStatesAvx512(NeuronState* states, float* charges, const float* weightedInputs,
+            float* outputs, size_t size) noexcept
+        {
+            const __m512 decay = _mm512_set1_ps(WorldProp::NeuronChargeDecay);
+            const __m512 minCharge = _mm512_set1_ps(WorldProp::NeuronMinCharge);
+            const __m512 maxCharge = _mm512_set1_ps(WorldProp::NeuronMaxCharge);
+            const __m512 threshold = _mm512_set1_ps(WorldProp::NeuronChargeThreshold);
+            const __m512 outputLut = _mm512_castps256_ps512(_mm256_loadu_ps(StateOutputs));
+            const __m512i one = _mm512_set1_epi32(1);
+            const __m512i recovering1 = _mm512_set1_epi32(static_cast<int>(NeuronState::Recovering1));
+
+            uint8_t* stateBytes = reinterpret_cast<uint8_t*>(states);
+
+            size_t j = 0;
+            for (; j + 16 <= size; j += 16)
+            {
+                __m512i state = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(stateBytes + j)));
+                __m512 charge = _mm512_loadu_ps(charges + j);
+
+                __mmask16 idle = _mm512_cmpeq_epi32_mask(state, _mm512_setzero_si512());
+                __mmask16 lastState = _mm512_cmpeq_epi32_mask(state, recovering1);
+
+                __m512 idleCharge = _mm512_add_ps(_mm512_mul_ps(charge, decay), _mm512_loadu_ps(weightedInputs + j));
+                idleCharge = _mm512_max_ps(_mm512_min_ps(maxCharge, idleCharge), minCharge);
+
+                __mmask16 fires = _mm512_mask_cmp_ps_mask(idle, idleCharge, threshold, _CMP_GT_OQ);
+
+                __m512i next = _mm512_maskz_add_epi32(static_cast<__mmask16>(~(idle | lastState)), state, one);
+                next = _mm512_mask_mov_epi32(next, fires, one);
+
+                charge = _mm512_mask_mov_ps(charge, idle, idleCharge);
+                charge = _mm512_maskz_mov_ps(static_cast<__mmask16>(~lastState), charge);
+
+                _mm512_storeu_ps(charges + j, charge);
+                _mm512_storeu_ps(outputs + j, _mm512_permutexvar_ps(next, outputLut));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(stateBytes + j), _mm512_cvtepi32_epi8(next));
+            }
+
+            for (; j < size; ++j)
+                UpdateNeuronState<WorldProp>(states[j], charges[j], weightedInputs[j], outputs[j]);
+        }
+        // Q8.8 version of UpdateStatesAvx2 over 16 neurons at a time, one per epi16 lane. 
+        // mulhrs(charge, decay * 128) = (charge * decay * 128 + 2^14) >> 15 = (charge * decay + 128) >> 8, 
+        // the rounding of fp16::operator*, and adds_epi16 saturates as fp16::operator+, 
+        // so the results match UpdateNeuronStateFixed exactly
+        template <typename WorldProp>
+        NN_TARGET_AVX2 inline void UpdateStatesFixedAvx2(NeuronState* states, fp16* charges, const fp16* weightedInputs,
+            float* outputs, size_t size) noexcept
+        {
+            constexpr fp16 decay = fp16::FromConstant(WorldProp::NeuronChargeDecay);
+            static_assert(decay.Raw() > -fp16::One && decay.Raw() < fp16::One, "NeuronChargeDecay * 128 has to fit int16");
+            static_assert(sizeof(fp16) == sizeof(int16_t), "fp16 is loaded as int16 lanes");
+
+            const __m256i decay128 = _mm256_set1_epi16(static_cast<int16_t>(decay.Raw() * 128));
+            const __m256i minCharge = _mm256_set1_epi16(fp16::FromConstant(WorldProp::NeuronMinCharge).Raw());
+            const __m256i maxCharge = _mm256_set1_epi16(fp16::FromConstant(WorldProp::NeuronMaxCharge).Raw());
+            const __m256i threshold = _mm256_set1_epi16(fp16::FromConstant(WorldProp::NeuronChargeThreshold).Raw());
+            const __m256 outputLut = _mm256_loadu_ps(StateOutputs);
+            const __m256i one = _mm256_set1_epi16(1);
+            const __m256i recovering1 = _mm256_set1_epi16(static_cast<int16_t>(NeuronState::Recovering1));
+
+            uint8_t* stateBytes = reinterpret_cast<uint8_t*>(states);
+
+            size_t j = 0;
+            for (; j + 16 <= size; j += 16)
+            {
+                __m256i state = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(stateBytes + j)));
+                __m256i charge = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(charges + j));
+
+                __m256i idle = _mm256_cmpeq_epi16(state, _mm256_setzero_si256());
+                __m256i lastState = _mm256_cmpeq_epi16(state, recovering1);
+
+                __m256i idleCharge = _mm256_adds_epi16(_mm256_mulhrs_epi16(charge, decay128), 
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weightedInputs + j)));
+                idleCharge = _mm256_max_epi16(_mm256_min_epi16(idleCharge, maxCharge), minCharge);
+
+                __m256i fires = _mm256_and_si256(idle, _mm256_cmpgt_epi16(idleCharge, threshold));
+
+                __m256i next = _mm256_andnot_si256(_mm256_or_si256(lastState, idle), _mm256_add_epi16(state, one));
+                next = _mm256_or_si256(next, _mm256_and_si256(fires, one));
+
+                charge = _mm256_blendv_epi8(charge, idleCharge, idle);
+                charge = _mm256_andnot_si256(lastState, charge);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(charges + j), charge);
+
+                __m128i nextLo = _mm256_castsi256_si128(next);
+                __m128i nextHi = _mm256_extracti128_si256(next, 1);
+                _mm256_storeu_ps(outputs + j, _mm256_permutevar8x32_ps(outputLut, _mm256_cvtepu16_epi32(nextLo)));
+                _mm256_storeu_ps(outputs + j + 8, _mm256_permutevar8x32_ps(outputLut, _mm256_cvtepu16_epi32(nextHi)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(stateBytes + j), _mm_packus_epi16(nextLo, nextHi));
+            }
+
+            for (; j < size; ++j)
+                UpdateNeuronStateFixed<WorldProp>(states[j], charges[j], weightedInputs[j], outputs[j]);
+        }
+    }
+
+    // Per-WorldProp table of the kernels for the selected ISA, resolved on the first use
+    template <typename WorldProp>
+    struct NeuronKernels
+    {
+        using TDotFn = float(*)(const float* w, const float* x, size_t size);
+        using TDot4Fn = void(*)(const float* const w[4], const float* x, size_t size, float sums[4]);
+        using TDotBf16Fn = float(*)(const uint16_t* w, const float* x, size_t size);
+        using TDotInt8Fn = float(*)(const int8_t* w, const float* x, size_t size);
+        using TDotFixedFn = int64_t(*)(const int16_t* w, const int16_t* x, size_t size);
+        using TToFixedFn = void(*)(const float* src, int16_t* dst, size_t size);
+        using TAxpyFn = void(*)(float a, const float* x, float* acc, size_t size);
+        using TMutateRowFn = void(*)(const float* src, float* dst, size_t size, float a, float b, 
+            uint32_t key, uint32_t counter);
+        using TUpdateStatesFn = void(*)(NeuronState* states, float* charges, const float* weightedInputs,
+            float* outputs, size_t size);
+        using TUpdateStatesFixedFn = void(*)(NeuronState* states, fp16* charges, const fp16* weightedInputs,
+            float* outputs, size_t size);
+
+        KernelIsa Isa;
+        TDotFn Dot;
+        TDot4Fn Dot4;
+        TDotBf16Fn DotBf16;
+        TDotInt8Fn DotInt8;
+        TDotFixedFn DotFixed;
+        TToFixedFn ToFixed;
+        TAxpyFn Axpy;
+        TMutateRowFn MutateRow;
+        TUpdateStatesFn UpdateStates;
+        TUpdateStatesFixedFn UpdateStatesFixed;
+
+        static const NeuronKernels& Get() noexcept
+        {
+            static const NeuronKernels kernels = For(KernelDispatch::Selected());
+            return kernels;
+        }
+
+        static NeuronKernels For(KernelIsa isa) noexcept
+        {
+            using namespace NeuronKernelImpl;
+
+            switch (isa)
+            {
+            case KernelIsa::Avx512:
+                return { isa, &DotAvx512, &Dot4Avx512, &DotBf16Avx512, &DotInt8Avx512, &DotFixedAvx2, &ToFixedRowAvx2, &AxpyAvx512, &MutateRowAvx512, &UpdateStatesAvx512<WorldProp>, &UpdateStatesFixedAvx2<WorldProp> };
+            case KernelIsa::Avx2:
+                return { isa, &DotAvx2, &Dot4Avx2, &DotBf16Avx2, &DotInt8Avx2, &DotFixedAvx2, &ToFixedRowAvx2, &AxpyAvx2, &MutateRowAvx2, &UpdateStatesAvx2<WorldProp>, &UpdateStatesFixedAvx2<WorldProp> };
+            case KernelIsa::Sse4:
+                return { isa, &DotSse4, &Dot4Sse4, &DotBf16Sse4, &DotInt8Sse4, &DotFixedSse4, &ToFixedRowScalar, &AxpySse4, &MutateRowScalar, &UpdateStatesScalar<WorldProp>, &UpdateStatesFixedScalar<WorldProp> };
+            default:
+                return { KernelIsa::Scalar, &DotScalar, &Dot4Scalar, &DotBf16Scalar, &DotInt8Scalar, &DotFixedScalar, &ToFixedRowScalar, &AxpyScalar, &MutateRowScalar, &UpdateStatesScalar<WorldProp>, &UpdateStatesFixedScalar<WorldProp> };
+            }
+        }
+    };
+}
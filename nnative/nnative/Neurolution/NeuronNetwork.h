@@ -3,12 +3,19 @@
 #include <ostream>
 #include <istream>
 #include <vector>
+#include <algorithm>
+#include <cmath>
 
 #include <immintrin.h>
 
 #include "../Random.h"
+#include "../CounterRandom.h"
 #include "../Utils.h"
 #include "../Allocators.h"
+#include "../FixedPoint.h"
+
+#include "AppProperties.h"
+#include "NeuronKernels.h"
 
 namespace Neurolution
 {
@@ -52,113 +59,76 @@ namespace Neurolution
 		}
 	};
 
-    enum class NeuronState : int
-    {
-        Idle,
-        Excited0,
-        Excited1,
-        Recovering0,
-        Recovering1
-    };
-
-
 	template <typename WorldProp>
-    struct Neuron
+    struct NeuronNetwork
     {
+		using ThisType = NeuronNetwork<WorldProp>;
+
+        using TInputOutputVector = std::vector<float, cache_aligned<float>>;
         using TWeightsVector = std::vector<float, cache_aligned<float>>;
+        using TStatesVector = std::vector<NeuronState, cache_aligned<NeuronState>>;
+
+        // Single row-major (network size) x (vector size) matrix, row j holds the input 
+        // weights of the neuron j. Vector size is a multiple of 16, so every row starts 
+        // at a cache-line boundary
         TWeightsVector Weights;
 
-		float Charge;
+        // Reduced precision copy of Weights, same layout, for WorldProp::NetworkWeightStorage. 
+        // Weights stay the master copy, UpdateCompactWeights() re-builds this one from it
+        std::vector<uint16_t, cache_aligned<uint16_t>> WeightsBf16;
+        std::vector<int8_t, cache_aligned<int8_t>> WeightsInt8;
+        TInputOutputVector WeightScales; // per row, int8 value * scale = weight
 
-        NeuronState State;
+        // Q8.8 state for WorldProp::FixedPointNetwork: weights (re-built from Weights as the 
+        // reduced precision copies above), inputs quantized once per evaluation, charges and 
+        // weighted inputs. Charges is only synced with ChargesFixed on save / load
+        std::vector<int16_t, cache_aligned<int16_t>> WeightsFixed;
+        std::vector<int16_t, cache_aligned<int16_t>> InputVectorFixed;
+        std::vector<fp16, cache_aligned<fp16>> ChargesFixed;
+        std::vector<fp16, cache_aligned<fp16>> WeightedInputsFixed;
 
-        Neuron()
-			: Neuron(0)
-        {
-        }
+        // For WorldProp::SparseInputEvaluation: Weights transposed (row i holds the weights of 
+        // the input i in all the neurons) and the self-feedback weights, both re-built from 
+        // Weights; indices of the non-zero inputs of the current evaluation
+        TWeightsVector WeightsTransposed;
+        TInputOutputVector SelfWeights;
+        std::vector<int> ActiveInputs;
+        bool UseSparseInputs{ false };
 
-        Neuron(int size)
-            : Charge(0)
-            , State(NeuronState::Idle)
-            , Weights(size)
-        {
-            for (int i = 0; i < size; ++i)
-                Weights[i] = 0;
-        }
+        TInputOutputVector Charges;
 
-        Neuron(const Neuron& other, Random& rnd, bool severe)
-        {
-            CloneFrom(other, rnd, severe);
-        }
+        TStatesVector States;
 
-        void CloneFrom(const Neuron& other, Random& rnd, bool severe) noexcept
-        {
-            Charge = 0;
-            State = NeuronState::Idle;
+        std::vector<LightSensor, cache_aligned<LightSensor>> Eye;
 
-            size_t size = other.Weights.size();
+        TInputOutputVector InputVector;
 
-            if (Weights.size() != size)
-            {
-                TWeightsVector(size).swap(Weights);
-            }
+        TInputOutputVector OutputVector;
 
-            if (!severe)
-            {
-                float maxMutation = WorldProp::NetworkMaxRegularMutation;
+        // Per-neuron weighted input cache for WorldProp::MemoizeWeightedInput, only valid 
+        // until the next PrepareIteration() / CleanOutputs() / CloneFrom() / LoadFrom() 
+        TInputOutputVector WeightedInputs;
+        bool WeightedInputsValid{ false };
 
-                for (int i = 0; i < size; ++i)
-                    Weights[i] = other.Weights[i] + (2.0f * rnd.NextFloat() - 1.0f) * maxMutation;
-            }
-            else
-            {
-                float alpha = WorldProp::NetworkSevereMutationAlpha;
-
-                for (int i = 0; i < size; ++i)
-                    Weights[i] = other.Weights[i] * alpha + (2.0f * rnd.NextFloat() - 1.0f) * (1.0f - alpha);
-            }
+        size_t GetNetworkSize() const noexcept 
+        {
+            return Charges.size();
         }
 
-		void SaveTo(std::ostream& stream)
-		{
-			stream.write(reinterpret_cast<const char*>(&Charge), sizeof(Charge));
-			stream.write(reinterpret_cast<const char*>(&State), sizeof(State));
-			int size = static_cast<int>(Weights.size());
-			stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
-			stream.write(reinterpret_cast<const char*>(&Weights[0]), sizeof(Weights[0]) * size);
-		}
-
-		void LoadFrom(std::istream& stream)
-		{
-			stream.read(reinterpret_cast<char*>(&Charge), sizeof(Charge));
-			stream.read(reinterpret_cast<char*>(&State), sizeof(State));
-			int size = 0;
-			stream.read(reinterpret_cast<char*>(&size), sizeof(size));
-			Weights.resize(size);
-			stream.read(reinterpret_cast<char*>(&Weights[0]), sizeof(Weights[0]) * size);
-		}
-
-    };
-
-	template <typename WorldProp>
-    struct NeuronNetwork
-    {
-		using TNeuron = Neuron<WorldProp>;
-		using ThisType = NeuronNetwork<WorldProp>;
-
-        using TInputOutputVector = std::vector<float, cache_aligned<float>>;
-
-        std::vector<TNeuron, cache_aligned<TNeuron>> Neurons;
-
-        std::vector<LightSensor, cache_aligned<LightSensor>> Eye;
-
-        TInputOutputVector InputVector;
+        // Stride between the matrix rows, same as the input vector size
+        size_t GetRowSize() const noexcept
+        {
+            return InputVector.size();
+        }
 
-        TInputOutputVector OutputVector;
+        float* GetWeights(size_t j) noexcept
+        {
+            return Weights.data() + j * GetRowSize();
+        }
 
-        size_t GetNetworkSize() const noexcept 
+        const float* GetWeights(size_t j) const noexcept
         {
-            return Neurons.size();
+            return Weights.data() + j * GetRowSize();
         }
 
         size_t GetVectorSize() const noexcept 
@@ -174,10 +144,13 @@ namespace Neurolution
 		}
 
         NeuronNetwork(int networkSize)
-            : Eye(WorldProp::EyeSize)
-            , Neurons(networkSize)
+            : Weights(static_cast<size_t>(networkSize) * (networkSize + WorldProp::SensorPackSize), 0.0f)
+            , Charges(networkSize, 0.0f)
+            , States(networkSize, NeuronState::Idle)
+            , Eye(WorldProp::EyeSize)
             , InputVector(GetVectorSize())
             , OutputVector(GetVectorSize())
+            , WeightedInputs(networkSize)
         {
             for (int i = 0; i < WorldProp::EyeSize; ++i)
             {
@@ -191,169 +164,269 @@ namespace Neurolution
                 );
             }
 
-            for (int i = 0; i < networkSize; ++i)
+            if constexpr (WorldProp::FixedPointNetwork)
             {
-                Neurons[i] = TNeuron(WorldProp::SensorPackSize + networkSize);
+                InputVectorFixed.resize(GetVectorSize());
+                ChargesFixed.resize(networkSize);
+                WeightedInputsFixed.resize(networkSize);
             }
+
+            UpdateCompactWeights();
         }
 
-        void IterateNetwork(Random& rnd, TInputOutputVector& inputVector, TInputOutputVector& outputVector) noexcept
+        void UpdateCompactWeights() noexcept
         {
-            for (unsigned int j = 0; j < Neurons.size(); ++j)
+            size_t rowSize = GetRowSize();
+
+            if constexpr (WorldProp::FixedPointNetwork)
             {
-                int neuronPositionInInputVector = j + WorldProp::SensorPackSize;
+                static_assert(WorldProp::NetworkWeightStorage == WeightStorage::Float32, 
+                    "FixedPointNetwork has its own weight format");
+                static_assert(WorldProp::MemoizeWeightedInput, "FixedPointNetwork requires MemoizeWeightedInput");
 
-                // 1st step - calculate updated charge values
-                auto& neuron = Neurons[j];
+                WeightsFixed.resize(Weights.size());
 
-				float weightedInput = -neuron.Weights[neuronPositionInInputVector] * inputVector[neuronPositionInInputVector];
+                NeuronKernels<WorldProp>::Get().ToFixed(Weights.data(), WeightsFixed.data(), Weights.size());
+            }
+            else if constexpr (WorldProp::NetworkWeightStorage == WeightStorage::BFloat16)
+            {
+                WeightsBf16.resize(Weights.size());
 
-                if (neuron.State == NeuronState::Idle)
+                for (size_t i = 0; i < Weights.size(); ++i)
+                    WeightsBf16[i] = NeuronKernelImpl::FloatToBf16(Weights[i]);
+            }
+            else if constexpr (WorldProp::NetworkWeightStorage == WeightStorage::Int8)
+            {
+                WeightsInt8.resize(Weights.size());
+                WeightScales.resize(GetNetworkSize());
+
+                for (size_t j = 0; j < GetNetworkSize(); ++j)
                 {
-                    // only calculate the weighted input if we are in the idle state, 
-                    // in other states neuron is ignoring inputs until it recovers to idle
+                    const float* src = GetWeights(j);
+                    int8_t* dst = WeightsInt8.data() + j * rowSize;
 
-                    if constexpr (WorldProp::ManualLoopUnroll)
-                    {
-                        __m256 acc1 = _mm256_setzero_ps();
-                        __m256 acc2 = _mm256_setzero_ps();
-
-                        const float* nwptr = neuron.Weights.data();
-                        const float* iwptr = inputVector.data();
-
-                        unsigned int size = neuron.Weights.size();
-                        for (unsigned int offs = 0; offs < size; offs += 16)
-                        {
-                            acc1 = _mm256_fmadd_ps(
-                                _mm256_load_ps(nwptr + offs),
-                                _mm256_load_ps(iwptr + offs),
-                                acc1
-                            );
-                            acc2 = _mm256_fmadd_ps(
-                                _mm256_load_ps(nwptr + offs + 8),
-                                _mm256_load_ps(iwptr + offs + 8),
-                                acc2
-                            );
-                        }
-
-                        /*
-                        a = _mm256_hadd_ps(a, b)
-                        a'0 := a1 + a0
-                        a'1 := a3 + a2
-                        a'2 := b1 + b0
-                        a'3 := b2 + b3
-                        a'4 := a5 + a4
-                        a'5 := a7 + a6
-                        a'6 := b5 + b4
-                        a'7 := b7 + b6
-
-                        2nd:
-                        a = _mm256_hadd_ps(a, 0)
-                        a''0 := a3 + a2 + a1 + a0
-                        a''1 := b2 + b3 + b1 + b0
-                        a''2 := 0
-                        a''3 := 0
-                        a''4 := a7 + a6 + a5 + a4
-                        a''5 := b7 + b6 + b5 + b4
-                        a''6 := 0
-                        a''7 := 0
-
-                        3rd:
-                        a = _mm256_hadd_ps(a, 0)
-                        a'''0 := b2 + b3 + b1 + b0 + a3 + a2 + a1 + a0
-                        a'''1 := 0
-                        a'''2 := 0
-                        a'''3 := 0
-                        a'''4 := b7 + b6 + b5 + b4 + a7 + a6 + a5 + a4
-                        a'''5 := 0
-                        a'''6 := 0
-                        a'''7 := 0
-                        */
-
-                        acc1 = _mm256_hadd_ps(acc1, acc2);
-                        acc1 = _mm256_hadd_ps(acc1, _mm256_setzero_ps());
-                        acc1 = _mm256_hadd_ps(acc1, _mm256_setzero_ps());
-                        weightedInput += acc1.m256_f32[0] + acc1.m256_f32[4];
-
-                        //               unsigned int offset = neuron.Weights.size() & (~15);
-                                       //for (unsigned int i = 0; i < (neuron.Weights.size() & 15); ++i)
-                                       //{
-                                       //	weightedInput += neuron.Weights[i + offset] * inputVector[i + offset];
-                                       //}
-                    }
-                    else
-                    {
-                        int sz = neuron.Weights.size();
-                        for (unsigned int i = 0; i < sz; ++i)
-                        {
-                            _mm_prefetch((char*)&neuron.Weights[i + 1], 1);
-                            _mm_prefetch((char*)&inputVector[i + 1], 1);
-
-                            weightedInput += neuron.Weights[i] * inputVector[i];
-                        }
-                    }
+                    float maxAbs = 0.0f;
+                    for (size_t i = 0; i < rowSize; ++i)
+                        maxAbs = std::max(maxAbs, std::abs(src[i]));
+
+                    float invScale = maxAbs > 0.0f ? 127.0f / maxAbs : 0.0f;
+                    WeightScales[j] = maxAbs / 127.0f;
+
+                    for (size_t i = 0; i < rowSize; ++i)
+                        dst[i] = static_cast<int8_t>(std::lrint(std::min(127.0f, std::max(-127.0f, src[i] * invScale))));
                 }
+            }
+
+            if constexpr (WorldProp::SparseInputEvaluation)
+            {
+                static_assert(WorldProp::NetworkWeightStorage == WeightStorage::Float32 && !WorldProp::FixedPointNetwork,
+                    "SparseInputEvaluation requires Float32 weights");
+
+                size_t networkSize = GetNetworkSize();
 
-                // 2nd step - update neuron state according to current state + new input
-                // and update state and current output
+                WeightsTransposed.resize(Weights.size());
+                SelfWeights.resize(networkSize);
 
-                switch (neuron.State)
+                for (size_t j = 0; j < networkSize; ++j)
                 {
-                case NeuronState::Idle:
+                    const float* src = GetWeights(j);
 
-                    neuron.Charge = ValueCap(
-                        neuron.Charge * WorldProp::NeuronChargeDecay + weightedInput,
-						WorldProp::NeuronMinCharge,
-						WorldProp::NeuronMaxCharge
-                    );
+                    for (size_t i = 0; i < rowSize; ++i)
+                        WeightsTransposed[i * networkSize + j] = src[i];
 
-                    if (neuron.Charge > WorldProp::NeuronChargeThreshold)
-                    {
-                        neuron.State = NeuronState::Excited0;
-						outputVector[j] = 1.0f;
-                    }
-                    else
-                    {
-                        outputVector[j] = 0.0f;
-                    }
-                    break;
-
-                case NeuronState::Excited0:
-                    neuron.State = NeuronState::Excited1;
-					outputVector[j] = 0.7f;
-					break;
-
-                case NeuronState::Excited1:
-                    neuron.State = NeuronState::Recovering0;
-                    outputVector[j] = 0.2f;
-                    break;
-
-                case NeuronState::Recovering0:
-                    neuron.State = NeuronState::Recovering1;
-                    outputVector[j] = 0.0f;
-                    break;
-
-                case NeuronState::Recovering1:
-                    neuron.State = NeuronState::Idle;
-                    neuron.Charge = 0.0f;
-                    outputVector[j] = 0.0f;
-                    break;
+                    SelfWeights[j] = src[j + WorldProp::SensorPackSize];
+                }
+            }
+        }
+
+        // Weighted sum of the inputs of neuron j, including the negative self-feedback term. 
+        // This is a pure function of the neuron weights and the input vector, so it stays 
+        // constant across the network sub-steps of one world step (see IterateNetwork(Random&))
+        float ComputeWeightedInput(unsigned int j, const TInputOutputVector& inputVector) const noexcept
+        {
+            int neuronPositionInInputVector = j + WorldProp::SensorPackSize;
+
+            if constexpr (WorldProp::NetworkWeightStorage == WeightStorage::BFloat16)
+            {
+                const uint16_t* nwptr = WeightsBf16.data() + j * GetRowSize();
+
+                float weightedInput = -NeuronKernelImpl::Bf16ToFloat(nwptr[neuronPositionInInputVector]) * 
+                    inputVector[neuronPositionInInputVector];
+
+                return weightedInput + NeuronKernels<WorldProp>::Get().DotBf16(nwptr, inputVector.data(), GetRowSize());
+            }
+            else if constexpr (WorldProp::NetworkWeightStorage == WeightStorage::Int8)
+            {
+                const int8_t* nwptr = WeightsInt8.data() + j * GetRowSize();
+
+                float sum = -static_cast<float>(nwptr[neuronPositionInInputVector]) * inputVector[neuronPositionInInputVector];
+                sum += NeuronKernels<WorldProp>::Get().DotInt8(nwptr, inputVector.data(), GetRowSize());
+
+                return sum * WeightScales[j];
+            }
+
+            const float* nwptr = GetWeights(j);
+
+            float weightedInput = -nwptr[neuronPositionInInputVector] * inputVector[neuronPositionInInputVector];
+
+            if constexpr (WorldProp::ManualLoopUnroll)
+            {
+                weightedInput += NeuronKernels<WorldProp>::Get().Dot(nwptr, inputVector.data(), GetRowSize());
+            }
+            else
+            {
+                int sz = static_cast<int>(GetRowSize());
+                for (int i = 0; i < sz; ++i)
+                {
+                    _mm_prefetch((char*)&nwptr[i + 1], 1);
+                    _mm_prefetch((char*)&inputVector[i + 1], 1);
+
+                    weightedInput += nwptr[i] * inputVector[i];
+                }
+            }
+
+            return weightedInput;
+        }
+
+        // Q8.8 version of the above, needs PrepareWeightedInputs() first. Sum is exact (int64), 
+        // only the final shift back to Q8.8 rounds
+        fp16 ComputeWeightedInputFixed(unsigned int j) const noexcept
+        {
+            int neuronPositionInInputVector = j + WorldProp::SensorPackSize;
+
+            const int16_t* nwptr = WeightsFixed.data() + j * GetRowSize();
+            const int16_t* iwptr = InputVectorFixed.data();
+
+            int64_t sum = NeuronKernels<WorldProp>::Get().DotFixed(nwptr, iwptr, GetRowSize());
+            sum -= static_cast<int32_t>(nwptr[neuronPositionInInputVector]) * iwptr[neuronPositionInInputVector];
+
+            int64_t rounded = (sum + fp16::One / 2) >> fp16::FractionBits;
+            return fp16::FromRawSaturated(static_cast<int32_t>(rounded < INT32_MIN ? INT32_MIN : (rounded > INT32_MAX ? INT32_MAX : rounded)));
+        }
+
+        // Once per evaluation, before the EvaluateWeightedInput() calls
+        void PrepareWeightedInputs() noexcept
+        {
+            if constexpr (WorldProp::FixedPointNetwork)
+            {
+                NeuronKernels<WorldProp>::Get().ToFixed(InputVector.data(), InputVectorFixed.data(), InputVector.size());
+            }
+
+            if constexpr (WorldProp::SparseInputEvaluation)
+            {
+                ActiveInputs.clear();
+
+                for (int i = 0; i < static_cast<int>(InputVector.size()); ++i)
+                {
+                    if (InputVector[i] != 0.0f)
+                        ActiveInputs.push_back(i);
                 }
+
+                UseSparseInputs = ActiveInputs.size() < InputVector.size() * WorldProp::SparseActivityThreshold;
+            }
+        }
+
+        // Weighted inputs of the neurons rowFrom..rowTo-1 from the non-zero inputs only, cost 
+        // is proportional to their number rather than to the row size. Needs PrepareWeightedInputs(). 
+        // Sums in a different order than the dense path, so the results differ in the last bits
+        void EvaluateWeightedInputsSparse(unsigned int rowFrom, unsigned int rowTo) noexcept
+        {
+            auto& kernels = NeuronKernels<WorldProp>::Get();
+
+            size_t networkSize = GetNetworkSize();
+            size_t numRows = rowTo - rowFrom;
+
+            float* acc = WeightedInputs.data() + rowFrom;
+            std::fill(acc, acc + numRows, 0.0f);
+
+            for (int i : ActiveInputs)
+                kernels.Axpy(InputVector[i], WeightsTransposed.data() + i * networkSize + rowFrom, acc, numRows);
+
+            for (unsigned int j = rowFrom; j < rowTo; ++j)
+                WeightedInputs[j] -= SelfWeights[j] * InputVector[j + WorldProp::SensorPackSize];
+        }
+
+        // Fills the weighted input cache entry of neuron j
+        void EvaluateWeightedInput(unsigned int j) noexcept
+        {
+            if constexpr (WorldProp::FixedPointNetwork)
+                WeightedInputsFixed[j] = ComputeWeightedInputFixed(j);
+            else
+                WeightedInputs[j] = ComputeWeightedInput(j, InputVector);
+        }
+
+        // Update neuron state according to current state + new input and update the current output
+        void UpdateNeuronState(unsigned int j, float weightedInput, TInputOutputVector& outputVector) noexcept
+        {
+            NeuronKernelImpl::UpdateNeuronState<WorldProp>(States[j], Charges[j], weightedInput, outputVector[j]);
+        }
+
+        void IterateNetwork(Random& rnd, TInputOutputVector& inputVector, TInputOutputVector& outputVector) noexcept
+        {
+            for (unsigned int j = 0; j < GetNetworkSize(); ++j)
+            {
+                float weightedInput = 0.0f;
+
+                // only calculate the weighted input if we are in the idle state, 
+                // in other states neuron is ignoring inputs until it recovers to idle
+                if (States[j] == NeuronState::Idle)
+                    weightedInput = ComputeWeightedInput(j, inputVector);
+
+                UpdateNeuronState(j, weightedInput, outputVector);
             }
         }
 
         void PrepareIteration() noexcept
         {
             InputVector.swap(OutputVector);
+            WeightedInputsValid = false;
         }
 
         void IterateNetwork(Random& rnd) noexcept
         {
-            IterateNetwork(rnd, InputVector, OutputVector);
+            if constexpr (WorldProp::MemoizeWeightedInput)
+            {
+                // InputVector only changes in PrepareIteration(), so all the sub-steps between two 
+                // consecutive PrepareIteration() calls see the very same weighted inputs -- compute 
+                // them once and only replay the state machine on the following sub-steps. 
+                // Same code computes the values, so the results are bit-identical to the non-cached path
+                if (!WeightedInputsValid)
+                {
+                    PrepareWeightedInputs();
+
+                    if (UseSparseInputs)
+                    {
+                        EvaluateWeightedInputsSparse(0, static_cast<unsigned int>(GetNetworkSize()));
+                    }
+                    else
+                    {
+                        for (unsigned int j = 0; j < GetNetworkSize(); ++j)
+                            EvaluateWeightedInput(j);
+                    }
+
+                    WeightedInputsValid = true;
+                }
+
+                if constexpr (WorldProp::FixedPointNetwork)
+                {
+                    NeuronKernels<WorldProp>::Get().UpdateStatesFixed(
+                        States.data(), ChargesFixed.data(), WeightedInputsFixed.data(), OutputVector.data(), GetNetworkSize());
+                }
+                else
+                {
+                    NeuronKernels<WorldProp>::Get().UpdateStates(
+                        States.data(), Charges.data(), WeightedInputs.data(), OutputVector.data(), GetNetworkSize());
+                }
+            }
+            else
+            {
+                IterateNetwork(rnd, InputVector, OutputVector);
+            }
         }
 
         void CleanOutputs() noexcept
         {
+            WeightedInputsValid = false;
             std::fill(std::begin(InputVector), std::end(InputVector), 0.0f);
             std::fill(std::begin(OutputVector), std::end(OutputVector), 0.0f);
         }
@@ -361,19 +434,76 @@ namespace Neurolution
         void CloneFrom(const ThisType& other, Random& rnd, bool severeMutations = false,
 			float severity = 0.0f) noexcept
         {
-            size_t newSize = other.Neurons.size();
+            PrepareClone(other);
+            CloneRows(other, static_cast<uint32_t>(rnd.Next()), severeMutations, severity, 0, other.GetNetworkSize());
+            FinishClone(other);
+        }
 
-            if (Neurons.size() != newSize)
+        // CloneFrom() in parts, so the rows of one clone can be spread over several workers: 
+        // PrepareClone() and FinishClone() once, CloneRows() for any split of the rows. 
+        // The mutations only depend on the seed and the row / weight index (CounterRandom), 
+        // so the result does not depend on the split. other may be this network
+        void PrepareClone(const ThisType& other) noexcept
+        {
+            size_t newSize = other.GetNetworkSize();
+            size_t rowSize = other.GetRowSize();
+
+            if (GetNetworkSize() != newSize)
+            {
+                Charges.resize(newSize);
+                States.resize(newSize);
+                WeightedInputs.resize(newSize);
+            }
+
+            if (Weights.size() != other.Weights.size())
+            {
+                TWeightsVector(other.Weights.size()).swap(Weights);
+            }
+
+            std::fill(std::begin(Charges), std::end(Charges), 0.0f);
+            std::fill(std::begin(States), std::end(States), NeuronState::Idle);
+
+            if constexpr (WorldProp::FixedPointNetwork)
             {
-                Neurons.resize(newSize);
+                InputVectorFixed.resize(rowSize);
+                ChargesFixed.assign(newSize, fp16{});
+                WeightedInputsFixed.resize(newSize);
             }
+        }
+
+        void CloneRows(const ThisType& other, uint32_t seed, bool severeMutations, float severity,
+            size_t rowFrom, size_t rowTo) noexcept
+        {
+            auto& kernels = NeuronKernels<WorldProp>::Get();
 
-            for (int i = 0; i < newSize; ++i)
+            size_t rowSize = other.GetRowSize();
+
+            // Row severity draws and weight noise come from two different streams
+            CounterRandom rowRandom(CounterRandom::Hash(seed, 0xffffffffu));
+
+            for (size_t i = rowFrom; i < rowTo; ++i)
             {
-                bool severe = severeMutations && (rnd.NextDouble() < severity);
-                Neurons[i].CloneFrom(other.Neurons[i], rnd, severe);
+                bool severe = severeMutations && (rowRandom.NextFloat(static_cast<uint32_t>(i)) < severity);
+
+                const float* src = other.GetWeights(i);
+                float* dst = GetWeights(i);
+                uint32_t counter = static_cast<uint32_t>(i * rowSize);
+
+                if (!severe)
+                {
+                    float maxMutation = WorldProp::NetworkMaxRegularMutation;
+                    kernels.MutateRow(src, dst, rowSize, 1.0f, maxMutation, seed, counter);
+                }
+                else
+                {
+                    float alpha = WorldProp::NetworkSevereMutationAlpha;
+                    kernels.MutateRow(src, dst, rowSize, alpha, 1.0f - alpha, seed, counter);
+                }
             }
+        }
 
+        void FinishClone(const ThisType& other) noexcept
+        {
             std::copy(
                 std::cbegin(other.InputVector),
                 std::cend(other.InputVector),
@@ -383,11 +513,14 @@ namespace Neurolution
                 std::cbegin(other.OutputVector),
                 std::cend(other.OutputVector),
                 std::begin(OutputVector));
+
+            UpdateCompactWeights();
+            WeightedInputsValid = false;
         }
 
 		void SaveTo(std::ostream& stream)
 		{
-			int numNeurons = static_cast<int>(Neurons.size());
+			int numNeurons = static_cast<int>(GetNetworkSize());
 			int numEyeCells = static_cast<int>(Eye.size());
 			int vectorSize = static_cast<int>(InputVector.size());
 
@@ -398,9 +531,22 @@ namespace Neurolution
 			stream.write(reinterpret_cast<const char*>(&numEyeCells), sizeof(numEyeCells));
 			stream.write(reinterpret_cast<const char*>(&vectorSize), sizeof(vectorSize));
 
-			for (int nidx = 0; nidx < Neurons.size(); ++nidx)
+			if constexpr (WorldProp::FixedPointNetwork)
 			{
-				Neurons[nidx].SaveTo(stream);
+				for (int nidx = 0; nidx < numNeurons; ++nidx)
+					Charges[nidx] = ChargesFixed[nidx];
+			}
+
+			// Same layout as it used to be with a separate Neuron object per row:
+			// charge, state (int), number of weights, weights
+			for (int nidx = 0; nidx < numNeurons; ++nidx)
+			{
+				int state = static_cast<int>(States[nidx]);
+
+				stream.write(reinterpret_cast<const char*>(&Charges[nidx]), sizeof(Charges[nidx]));
+				stream.write(reinterpret_cast<const char*>(&state), sizeof(state));
+				stream.write(reinterpret_cast<const char*>(&vectorSize), sizeof(vectorSize));
+				stream.write(reinterpret_cast<const char*>(GetWeights(nidx)), sizeof(float) * vectorSize);
 			}
 
 			for (int eidx = 0; eidx < Eye.size(); ++eidx)
@@ -425,11 +571,29 @@ namespace Neurolution
 			if (OutputVector.size() != vectorSize)
 				throw std::runtime_error("Internal erorr: InputVector.size() must match OutputVector.size()");
 
-			Neurons.resize(numNeurons);
+			// NetworkBatchEvaluator and NetworkCloner split the work by WorldProp::NetworkSize rows
+			if (numNeurons != WorldProp::NetworkSize)
+				throw std::runtime_error("Saved network size does not match NetworkSize");
+
+			Charges.resize(numNeurons);
+			States.resize(numNeurons);
+			Weights.resize(static_cast<size_t>(numNeurons) * vectorSize);
 
-			for (int nidx = 0; nidx < Neurons.size(); ++nidx)
+			for (int nidx = 0; nidx < numNeurons; ++nidx)
 			{
-				Neurons[nidx].LoadFrom(stream);
+				int rowSize = 0;
+				int state = 0;
+
+				stream.read(reinterpret_cast<char*>(&Charges[nidx]), sizeof(Charges[nidx]));
+				stream.read(reinterpret_cast<char*>(&state), sizeof(state));
+				stream.read(reinterpret_cast<char*>(&rowSize), sizeof(rowSize));
+
+				States[nidx] = static_cast<NeuronState>(state);
+
+				if (rowSize != vectorSize)
+					throw std::runtime_error("Internal erorr: number of neuron weights must match the vector size");
+
+				stream.read(reinterpret_cast<char*>(GetWeights(nidx)), sizeof(float) * vectorSize);
 			}
 
 			Eye.resize(numEyeCells);
@@ -444,6 +608,18 @@ namespace Neurolution
 
 			stream.read(reinterpret_cast<char*>(&InputVector[0]), sizeof(InputVector[0]) * vectorSize);
 			stream.read(reinterpret_cast<char*>(&OutputVector[0]), sizeof(OutputVector[0]) * vectorSize);
+
+			WeightedInputs.resize(numNeurons);
+			WeightedInputsValid = false;
+
+			if constexpr (WorldProp::FixedPointNetwork)
+			{
+				InputVectorFixed.resize(vectorSize);
+				ChargesFixed.assign(std::cbegin(Charges), std::cend(Charges));
+				WeightedInputsFixed.resize(numNeurons);
+			}
+
+			UpdateCompactWeights();
 		}
 	};
 }
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "../ThreadGrid.h"
+
+#include "WorldUtils.h"
+
+namespace Neurolution
+{
+	// The objects one observer has in its PairTable row, ascending object index
+	struct PairRow
+	{
+		const DirectionWithDistanceSquare* Directions;
+		const int* Objects;
+		int Count;
+
+		const DirectionWithDistanceSquare* begin() const noexcept { return Directions; }
+		const DirectionWithDistanceSquare* end() const noexcept { return Directions + Count; }
+		const DirectionWithDistanceSquare* data() const noexcept { return Directions; }
+		size_t size() const noexcept { return static_cast<size_t>(Count); }
+
+		// the entries with object index in [from, to)
+		PairRow Slice(int from, int to) const noexcept
+		{
+			const int* first = std::lower_bound(Objects, Objects + Count, from);
+			const int* last = std::lower_bound(first, Objects + Count, to);
+			int offset = static_cast<int>(first - Objects);
+			return { Directions + offset, first, static_cast<int>(last - first) };
+		}
+	};
+
+	// Candidates argument of the PairTable builds: every pair is checked, in cache-sized tiles
+	struct AllPairs {};
+
+	// Displacements and distances between objects closer than a given radius, built once per
+	// step and read by everyone who needs them, one CSR row of DirectionWithDistanceSquare per
+	// observer (Energy is how the observer sees the object). Rows are in ascending object
+	// order, so sums over them keep the brute force order. Built in parallel on a ThreadGrid:
+	//  - BuildSymmetric: all pairs within one set, each distance computed once for both rows
+	//    (negated for the second one, which is exact)
+	//  - BuildCross: rows of one set over the objects of another
+	// Pairs come either from all tiles of BlockSize x BlockSize objects (AllPairs), or from a
+	// candidates(i, out) function giving a superset of the objects near i, ascending (grids)
+	class PairTable
+	{
+	public:
+		static constexpr int BlockSize = 64;
+
+	private:
+		struct Hit
+		{
+			int I;
+			int J;
+			float DX;
+			float DY;
+			float DistanceSquare;
+		};
+
+		std::vector<int> _rowStart;
+		std::vector<int> _objects;
+		std::vector<DirectionWithDistanceSquare> _directions;
+
+		std::vector<std::vector<Hit>> _tiles;	// symmetric: tile (a, b) at a * numBlocks + b, a <= b; cross: per row block
+		std::vector<uint8_t> _seen;
+		std::vector<float> _seenEnergy;
+		std::vector<int> _rowCursor;
+		std::vector<int> _blockStart;
+		std::vector<std::vector<int>> _candidates; // per worker
+
+		static int NumBlocks(int n) noexcept
+		{
+			return (n + BlockSize - 1) / BlockSize;
+		}
+
+		template <typename TSeenFn>
+		void PrepareSeen(ThreadGrid& grid, int n, TSeenFn&& seen)
+		{
+			_seen.resize(n);
+			_seenEnergy.resize(n);
+
+			grid.GridRun([&](int idx, int numThreads)
+			{
+				for (int j = idx; j < n; j += numThreads)
+				{
+					float energy = 0.0f;
+					_seen[j] = seen(j, energy) ? 1 : 0;
+					_seenEnergy[j] = energy;
+				}
+			});
+		}
+
+		// the final rows of [rowFrom, rowTo): offsets from the _rowCursor counts, then the
+		// cursors are reset to the row starts for the fill
+		void StartRows(int rowFrom, int rowTo, int offset) noexcept
+		{
+			for (int i = rowFrom; i < rowTo; ++i)
+			{
+				_rowStart[i] = offset;
+				offset += _rowCursor[i];
+				_rowCursor[i] = _rowStart[i];
+			}
+		}
+
+		void Emit(int row, int object, float dx, float dy, float distanceSquare) noexcept
+		{
+			int slot = _rowCursor[row]++;
+			_objects[slot] = object;
+			_directions[slot] = { dx, dy, distanceSquare, _seenEnergy[object] };
+		}
+
+		void FinishBlocks(int numRows, int numBlocks)
+		{
+			_blockStart[0] = 0;
+			for (int b = 0; b < numBlocks; ++b)
+				_blockStart[b + 1] += _blockStart[b];
+
+			_rowStart[numRows] = _blockStart[numBlocks];
+			_objects.resize(_blockStart[numBlocks]);
+			_directions.resize(_blockStart[numBlocks]);
+		}
+
+		void PrepareWorkers(ThreadGrid& grid)
+		{
+			if (_candidates.size() != static_cast<size_t>(grid.GetNumThreads()))
+				_candidates.resize(grid.GetNumThreads());
+		}
+
+	public:
+		PairRow Row(int i) const noexcept
+		{
+			int from = _rowStart[i];
+			return { _directions.data() + from, _objects.data() + from, _rowStart[i + 1] - from };
+		}
+
+		size_t NumPairs() const noexcept
+		{
+			return _objects.size();
+		}
+
+		// n objects; position(idx, x, y); displacement(dx, dy) turns raw differences into the
+		// ones to use (wrap-around); seen(idx, energy) tells if the others see idx, and how
+		// bright; pairs are kept when DistanceSquare <= radiusSquare
+		template <typename TPositionFn, typename TDisplacementFn, typename TSeenFn, typename TCandidatesFn>
+		void BuildSymmetric(
+			ThreadGrid& grid,
+			int n,
+			float radiusSquare,
+			TPositionFn&& position,
+			TDisplacementFn&& displacement,
+			TSeenFn&& seen,
+			TCandidatesFn&& candidates)
+		{
+			int numBlocks = NumBlocks(n);
+
+			PrepareWorkers(grid);
+			_tiles.resize(static_cast<size_t>(numBlocks) * numBlocks);
+			_rowStart.resize(n + 1);
+			_rowCursor.resize(n);
+			_blockStart.assign(numBlocks + 1, 0);
+
+			PrepareSeen(grid, n, seen);
+
+			auto pair = [&](int i, float xi, float yi, int j, std::vector<Hit>& hits)
+			{
+				float xj, yj;
+				position(j, xj, yj);
+
+				float dx = xj - xi;
+				float dy = yj - yi;
+				displacement(dx, dy);
+
+				float distanceSquare = dx * dx + dy * dy;
+				if (!(distanceSquare > radiusSquare))
+					hits.push_back({ i, j, dx, dy, distanceSquare });
+			};
+
+			if constexpr (std::is_same_v<std::decay_t<TCandidatesFn>, AllPairs>)
+			{
+				grid.GridRun([&](int idx, int numThreads)
+				{
+					int tile = 0;
+					for (int a = 0; a < numBlocks; ++a)
+					{
+						for (int b = a; b < numBlocks; ++b, ++tile)
+						{
+							if (tile % numThreads != idx)
+								continue;
+
+							auto& hits = _tiles[a * numBlocks + b];
+							hits.clear();
+
+							int iTo = std::min(n, (a + 1) * BlockSize);
+							int jTo = std::min(n, (b + 1) * BlockSize);
+							for (int i = a * BlockSize; i < iTo; ++i)
+							{
+								float xi, yi;
+								position(i, xi, yi);
+
+								for (int j = (a == b ? i + 1 : b * BlockSize); j < jTo; ++j)
+									pair(i, xi, yi, j, hits);
+							}
+						}
+					}
+				});
+			}
+			else
+			{
+				grid.GridRun([&](int idx, int numThreads)
+				{
+					auto& out = _candidates[idx];
+					for (int a = idx; a < numBlocks; a += numThreads)
+					{
+						for (int b = a; b < numBlocks; ++b)
+							_tiles[a * numBlocks + b].clear();
+
+						int iTo = std::min(n, (a + 1) * BlockSize);
+						for (int i = a * BlockSize; i < iTo; ++i)
+						{
+							float xi, yi;
+							position(i, xi, yi);
+
+							candidates(i, out);
+							for (int j : out)
+							{
+								if (j > i)
+									pair(i, xi, yi, j, _tiles[a * numBlocks + j / BlockSize]);
+							}
+						}
+					}
+				});
+			}
+
+			// Row r gets, in this order: the transposed hits of tiles (a < r's block, r's block),
+			// then both of the diagonal tile, then the direct ones of the tiles right of it --
+			// which is ascending object order. Counted first, then filled
+			auto forEachEntry = [&](int r, auto&& emit)
+			{
+				for (int a = 0; a <= r; ++a)
+				{
+					for (auto& hit : _tiles[a * numBlocks + r])
+					{
+						if (_seen[hit.I])
+							emit(hit.J, hit.I, -hit.DX, -hit.DY, hit.DistanceSquare);
+						if (a == r && _seen[hit.J])
+							emit(hit.I, hit.J, hit.DX, hit.DY, hit.DistanceSquare);
+					}
+				}
+				for (int b = r + 1; b < numBlocks; ++b)
+				{
+					for (auto& hit : _tiles[r * numBlocks + b])
+					{
+						if (_seen[hit.J])
+							emit(hit.I, hit.J, hit.DX, hit.DY, hit.DistanceSquare);
+					}
+				}
+			};
+
+			grid.GridRun([&](int idx, int numThreads)
+			{
+				for (int r = idx; r < numBlocks; r += numThreads)
+				{
+					int rowFrom = r * BlockSize;
+					int rowTo = std::min(n, rowFrom + BlockSize);
+					std::fill(_rowCursor.begin() + rowFrom, _rowCursor.begin() + rowTo, 0);
+
+					forEachEntry(r, [&](int row, int, float, float, float) { ++_rowCursor[row]; });
+
+					int total = 0;
+					for (int i = rowFrom; i < rowTo; ++i)
+						total += _rowCursor[i];
+					_blockStart[r + 1] = total;
+				}
+			});
+
+			FinishBlocks(n, numBlocks);
+
+			grid.GridRun([&](int idx, int numThreads)
+			{
+				for (int r = idx; r < numBlocks; r += numThreads)
+				{
+					StartRows(r * BlockSize, std::min(n, (r + 1) * BlockSize), _blockStart[r]);
+					forEachEntry(r, [&](int row, int object, float dx, float dy, float distanceSquare)
+					{
+						Emit(row, object, dx, dy, distanceSquare);
+					});
+				}
+			});
+		}
+
+		// numRows observers at positionRow(idx, x, y), over numObjects objects at
+		// positionObject(idx, x, y), otherwise as BuildSymmetric
+		template <typename TRowPositionFn, typename TObjectPositionFn, typename TDisplacementFn, typename TSeenFn, typename TCandidatesFn>
+		void BuildCross(
+			ThreadGrid& grid,
+			int numRows,
+			int numObjects,
+			float radiusSquare,
+			TRowPositionFn&& positionRow,
+			TObjectPositionFn&& positionObject,
+			TDisplacementFn&& displacement,
+			TSeenFn&& seen,
+			TCandidatesFn&& candidates)
+		{
+			int numBlocks = NumBlocks(numRows);
+
+			PrepareWorkers(grid);
+			_tiles.resize(numBlocks);
+			_rowStart.resize(numRows + 1);
+			_rowCursor.resize(numRows);
+			_blockStart.assign(numBlocks + 1, 0);
+
+			PrepareSeen(grid, numObjects, seen);
+
+			auto pair = [&](int i, float xi, float yi, int j, std::vector<Hit>& hits)
+			{
+				if (!_seen[j])
+					return;
+
+				float xj, yj;
+				positionObject(j, xj, yj);
+
+				float dx = xj - xi;
+				float dy = yj - yi;
+				displacement(dx, dy);
+
+				float distanceSquare = dx * dx + dy * dy;
+				if (!(distanceSquare > radiusSquare))
+				{
+					hits.push_back({ i, j, dx, dy, distanceSquare });
+					++_rowCursor[i];
+				}
+			};
+
+			// Hits of a row block, in tile order for AllPairs: the rows get them ascending once
+			// they are distributed in that order
+			grid.GridRun([&](int idx, int numThreads)
+			{
+				for (int r = idx; r < numBlocks; r += numThreads)
+				{
+					auto& hits = _tiles[r];
+					hits.clear();
+
+					int rowFrom = r * BlockSize;
+					int rowTo = std::min(numRows, rowFrom + BlockSize);
+					std::fill(_rowCursor.begin() + rowFrom, _rowCursor.begin() + rowTo, 0);
+
+					if constexpr (std::is_same_v<std::decay_t<TCandidatesFn>, AllPairs>)
+					{
+						for (int jFrom = 0; jFrom < numObjects; jFrom += BlockSize)
+						{
+							int jTo = std::min(numObjects, jFrom + BlockSize);
+							for (int i = rowFrom; i < rowTo; ++i)
+							{
+								float xi, yi;
+								positionRow(i, xi, yi);
+
+								for (int j = jFrom; j < jTo; ++j)
+									pair(i, xi, yi, j, hits);
+							}
+						}
+					}
+					else
+					{
+						auto& out = _candidates[idx];
+						for (int i = rowFrom; i < rowTo; ++i)
+						{
+							float xi, yi;
+							positionRow(i, xi, yi);
+
+							candidates(i, out);
+							for (int j : out)
+								pair(i, xi, yi, j, hits);
+						}
+					}
+
+					_blockStart[r + 1] = static_cast<int>(hits.size());
+				}
+			});
+
+			FinishBlocks(numRows, numBlocks);
+
+			grid.GridRun([&](int idx, int numThreads)
+			{
+				for (int r = idx; r < numBlocks; r += numThreads)
+				{
+					StartRows(r * BlockSize, std::min(numRows, (r + 1) * BlockSize), _blockStart[r]);
+					for (auto& hit : _tiles[r])
+						Emit(hit.I, hit.J, hit.DX, hit.DY, hit.DistanceSquare);
+				}
+			});
+		}
+	};
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "../Allocators.h"
+
+#include "NeuronNetwork.h"
+#include "EntityStore.h"
+#include "SimulationKernels.h"
+#include "WorldUtils.h"
+
+namespace Neurolution
+{
+	// BlockedSensing: the eye of all the cells as a brute force over tiles of ObserverTile
+	// cells x ObjectChunk objects, so a chunk of positions is read from L1 by all the cells of
+	// the tile. SimulationKernels::VisibleObjects does the visibility checks of a chunk on SIMD
+	// masks, EyeSignals adds up what is left, for the three colors in one pass over the tile.
+	// Objects go in index order, as in the sight tables, so the values are the same as the
+	// VectorizedSimulation eye's
+	template <typename WorldProp>
+	class SensingTiles
+	{
+	public:
+		static constexpr int ObserverTile = 8;
+		static constexpr int ObjectChunk = 256;
+		static constexpr int NumTripods = WorldProp::EyeSizeNumTripods;
+		static constexpr int PaddedTripods = (NumTripods + 15) / 16 * 16;
+
+		// the objects of each color: red foods, green prey, blue predators
+		static constexpr int NumColors = 3;
+
+		// One cell looking, Inputs are its eye's entries of the InputVector
+		struct Observer
+		{
+			float X;
+			float Y;
+			float Rotation;
+			const LightSensor* Eye;
+			int Self;			// index of the cell among the objects, -1 if none
+			bool SeesFoods;		// red is left as is if not
+			float* Inputs;
+		};
+
+	private:
+		using TFloats = EntityStore::TFloats;
+
+		// all the objects, each color padded up to whole vectors with dark ones
+		TFloats _x;
+		TFloats _y;
+		TFloats _brightness;
+		std::array<int, NumColors + 1> _colorStart{};
+
+		float _maxX{ 0.0f };
+		float _maxY{ 0.0f };
+
+		struct alignas(64) Scratch
+		{
+			float Angles[PaddedTripods];
+			float ViewX[ObserverTile][PaddedTripods];
+			float ViewY[ObserverTile][PaddedTripods];
+			float Widths[ObserverTile][NumColors][PaddedTripods];
+			float Values[ObserverTile][NumColors][PaddedTripods];
+			DirectionWithDistanceSquare Visible[ObjectChunk];
+		};
+		std::vector<Scratch, cache_aligned<Scratch>> _scratch; // per worker
+
+	public:
+		explicit SensingTiles(int numWorkers)
+			: _scratch(numWorkers)
+		{
+		}
+
+		// counts[color] objects, object(color, idx, x, y, brightness) tells where they are and
+		// returns false for the ones not to be seen
+		template <typename TObjectFn>
+		void Prepare(const std::array<int, NumColors>& counts, int maxX, int maxY, TObjectFn&& object)
+		{
+			_maxX = static_cast<float>(maxX);
+			_maxY = static_cast<float>(maxY);
+
+			_colorStart[0] = 0;
+			for (int color = 0; color < NumColors; ++color)
+				_colorStart[color + 1] = _colorStart[color] + (counts[color] + 15) / 16 * 16;
+
+			size_t total = _colorStart[NumColors];
+			_x.resize(total);
+			_y.resize(total);
+			_brightness.resize(total);
+
+			for (int color = 0; color < NumColors; ++color)
+			{
+				for (int idx = 0, slot = _colorStart[color]; slot < _colorStart[color + 1]; ++idx, ++slot)
+				{
+					float x = 0.0f, y = 0.0f, brightness = 0.0f;
+					if (idx >= counts[color] || !object(color, idx, x, y, brightness))
+						brightness = 0.0f;
+
+					_x[slot] = x;
+					_y[slot] = y;
+					_brightness[slot] = brightness;
+				}
+			}
+		}
+
+		// index of object idx of the color among all the objects, for Observer::Self
+		int ObjectIndex(int color, int idx) const noexcept
+		{
+			return _colorStart[color] + idx;
+		}
+
+		size_t NumObjects() const noexcept
+		{
+			return _brightness.size();
+		}
+
+		// up to ObserverTile cells
+		void Sense(int threadIdx, const Observer* observers, int numObservers) noexcept
+		{
+			auto& kernels = SimulationKernels<WorldProp>::Get();
+			auto& scratch = _scratch[threadIdx];
+
+			for (int o = 0; o < numObservers; ++o)
+			{
+				auto& observer = observers[o];
+
+				// tripods padded up to whole vectors, looking nowhere, so they never see anything
+				for (int t = 0; t < PaddedTripods; ++t)
+				{
+					scratch.Angles[t] = t < NumTripods ? observer.Rotation + observer.Eye[3 * t].Direction : 0.0f;
+					for (int color = 0; color < NumColors; ++color)
+					{
+						scratch.Widths[o][color][t] = t < NumTripods ? observer.Eye[3 * t + color].Width : 1.0f;
+						scratch.Values[o][color][t] = 0.0f;
+					}
+				}
+
+				kernels.SinCos(scratch.Angles, scratch.ViewY[o], scratch.ViewX[o], PaddedTripods);
+
+				for (int t = NumTripods; t < PaddedTripods; ++t)
+					scratch.ViewX[o][t] = scratch.ViewY[o][t] = 0.0f;
+			}
+
+			for (int color = 0; color < NumColors; ++color)
+			{
+				for (int from = _colorStart[color]; from < _colorStart[color + 1]; from += ObjectChunk)
+				{
+					int size = std::min(ObjectChunk, _colorStart[color + 1] - from);
+
+					for (int o = 0; o < numObservers; ++o)
+					{
+						auto& observer = observers[o];
+						if (color == 0 && !observer.SeesFoods)
+							continue;
+
+						size_t numVisible = kernels.VisibleObjects(observer.X, observer.Y,
+							_x.data() + from, _y.data() + from, _brightness.data() + from, size,
+							observer.Self - from, _maxX, _maxY, scratch.Visible);
+
+						kernels.EyeSignals(scratch.ViewX[o], scratch.ViewY[o], scratch.Widths[o][color], PaddedTripods,
+							scratch.Visible, numVisible, scratch.Values[o][color]);
+					}
+				}
+			}
+
+			for (int o = 0; o < numObservers; ++o)
+			{
+				auto& observer = observers[o];
+				for (int t = 0; t < NumTripods; ++t)
+				{
+					if (observer.SeesFoods)
+						observer.Inputs[3 * t] = 20000 * scratch.Values[o][0][t];
+					observer.Inputs[3 * t + 1] = 20000 * scratch.Values[o][1][t];
+					observer.Inputs[3 * t + 2] = 20000 * scratch.Values[o][2][t];
+				}
+			}
+		}
+	};
+}
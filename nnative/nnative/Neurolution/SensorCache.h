@@ -0,0 +1,261 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "../Allocators.h"
+
+#include "NeuronNetwork.h"
+#include "PairTable.h"
+#include "WorldUtils.h"
+
+namespace Neurolution
+{
+	// SensorCacheTolerance: the eye values of each cell kept from step to step, with the
+	// objects they were computed from. Each step only the objects that changed go through the
+	// eye again, as a delta (the old entry with its energy negated, the new one): objects that
+	// came into sight or left it, the ones whose displacement from the cell moved by more than
+	// Tolerance x their distance, or whose energy changed by more than Tolerance x of it, and
+	// the ones that went over the edge of a tripod. Once the cell turns, and every
+	// RefreshSteps, everything is computed again, which also bounds the rounding drift of the
+	// deltas. Rows are matched by object index, so the cache has to be invalidated when the
+	// indices change
+	template <typename WorldProp>
+	class SensorCache
+	{
+	public:
+		static constexpr int NumColors = 3;
+		static constexpr int NumTripods = WorldProp::EyeSizeNumTripods;
+		static constexpr int PaddedTripods = (NumTripods + 15) / 16 * 16;
+		static constexpr float Tolerance = WorldProp::SensorCacheTolerance;
+		static constexpr int RefreshSteps = WorldProp::SensorCacheRefreshSteps;
+
+		using TValues = float[NumColors][PaddedTripods];
+		using TRows = std::array<PairRow, NumColors>;
+
+		struct Stats
+		{
+			size_t Updates{ 0 };		// cell x color
+			size_t FullUpdates{ 0 };
+			double Entries{ 0.0 };		// what computing everything again would have gone through
+			double Evaluated{ 0.0 };	// what went through the eye
+
+			Stats& operator+=(const Stats& other) noexcept
+			{
+				Updates += other.Updates;
+				FullUpdates += other.FullUpdates;
+				Entries += other.Entries;
+				Evaluated += other.Evaluated;
+				return *this;
+			}
+		};
+
+	private:
+		struct alignas(64) Observer
+		{
+			alignas(64) TValues Values;
+			alignas(64) float ViewX[NumTripods];	// tripod directions at Rotation
+			alignas(64) float ViewY[NumTripods];
+			float Rotation{ 0.0f };
+			std::array<bool, NumColors> Valid{};
+			std::array<std::vector<int>, NumColors> Objects;
+			std::array<std::vector<DirectionWithDistanceSquare>, NumColors> Used;
+		};
+
+		struct alignas(64) Worker
+		{
+			std::array<std::vector<DirectionWithDistanceSquare>, NumColors> Deltas;
+			std::vector<int> Objects;
+			std::vector<DirectionWithDistanceSquare> Used;
+			Stats Counters;
+		};
+
+		std::vector<Observer, cache_aligned<Observer>> _observers;
+		std::vector<Worker, cache_aligned<Worker>> _workers;
+
+		// Which tripods have the object in front (cos > 0): the tripods are a fan narrower than 
+		// pi (see NeuronNetwork), so these are the ones before or after some boundary. Returns 
+		// the boundary, negative if the first tripod is not among them
+		static int Front(const Observer& observer, const DirectionWithDistanceSquare& item) noexcept
+		{
+			auto inFront = [&](int t)
+			{
+				return observer.ViewX[t] * item.DirectionX + observer.ViewY[t] * item.DirectionY > 0.0f;
+			};
+
+			bool first = inFront(0);
+			int boundary = NumTripods;
+			if (inFront(NumTripods - 1) != first)
+			{
+				int from = 0;
+				boundary = NumTripods - 1;
+				while (boundary - from > 1)
+				{
+					int mid = (from + boundary) / 2;
+					(inFront(mid) == first ? from : boundary) = mid;
+				}
+			}
+
+			return first ? boundary : -boundary;
+		}
+
+		// Moved or changed beyond the tolerance, or went over the 90 degree edge of a tripod, 
+		// where a narrow sensor's response jumps from most of its peak to nothing
+		static bool Changed(const Observer& observer, const DirectionWithDistanceSquare& used, const DirectionWithDistanceSquare& now) noexcept
+		{
+			float dx = now.DirectionX - used.DirectionX;
+			float dy = now.DirectionY - used.DirectionY;
+			return dx * dx + dy * dy > Tolerance * Tolerance * used.DistanceSquare
+				|| std::abs(now.Energy - used.Energy) > Tolerance * used.Energy
+				|| Front(observer, used) != Front(observer, now);
+		}
+
+		static DirectionWithDistanceSquare Negated(DirectionWithDistanceSquare item) noexcept
+		{
+			item.Energy = -item.Energy;
+			return item;
+		}
+
+		// Matches row against what the observer has for the color, by object index, puts the
+		// differences into deltas and keeps the entries used from now on
+		void Merge(Worker& worker, Observer& observer, int color, PairRow row)
+		{
+			auto& deltas = worker.Deltas[color];
+			auto& objects = observer.Objects[color];
+			auto& used = observer.Used[color];
+
+			worker.Objects.clear();
+			worker.Used.clear();
+
+			int i = 0, j = 0;
+			int numUsed = static_cast<int>(objects.size());
+
+			while (i < row.Count || j < numUsed)
+			{
+				if (j == numUsed || (i < row.Count && row.Objects[i] < objects[j]))
+				{
+					// came into sight
+					deltas.push_back(row.Directions[i]);
+					worker.Objects.push_back(row.Objects[i]);
+					worker.Used.push_back(row.Directions[i]);
+					++i;
+				}
+				else if (i == row.Count || objects[j] < row.Objects[i])
+				{
+					// left
+					deltas.push_back(Negated(used[j]));
+					++j;
+				}
+				else
+				{
+					if (Changed(observer, used[j], row.Directions[i]))
+					{
+						deltas.push_back(Negated(used[j]));
+						deltas.push_back(row.Directions[i]);
+						worker.Used.push_back(row.Directions[i]);
+					}
+					else
+					{
+						worker.Used.push_back(used[j]);
+					}
+					worker.Objects.push_back(row.Objects[i]);
+					++i;
+					++j;
+				}
+			}
+
+			objects.swap(worker.Objects);
+			used.swap(worker.Used);
+		}
+
+	public:
+		SensorCache(int numWorkers, int numObservers)
+			: _observers(numObservers)
+			, _workers(numWorkers)
+		{
+		}
+
+		// all the observers, everything is computed again on the next update
+		void Invalidate(int numObservers)
+		{
+			if (static_cast<int>(_observers.size()) != numObservers)
+				_observers.resize(numObservers);
+
+			for (auto& observer : _observers)
+				observer.Valid = {};
+		}
+
+		// one color of all the observers (the foods, after they are moved around)
+		void InvalidateColor(int color)
+		{
+			for (auto& observer : _observers)
+				observer.Valid[color] = false;
+		}
+
+		Stats GetStats() const noexcept
+		{
+			Stats stats;
+			for (auto& worker : _workers)
+				stats += worker.Counters;
+			return stats;
+		}
+
+		// Brings the values of observer up to date with its rows (with Objects, as in the sight
+		// tables) and returns them; light(rotation, rows, values) adds the light of rows to
+		// values, as seen at rotation by eye. Rows of colors the observer does not see are empty
+		template <typename TLightFn>
+		const TValues& Update(int threadIdx, long step, int observerIdx, float rotation, const LightSensor* eye, const TRows& rows, TLightFn&& light)
+		{
+			auto& worker = _workers[threadIdx];
+			auto& observer = _observers[observerIdx];
+
+			// ReSharper disable once CompareOfFloatsByEqualityOperator
+			if ((step + observerIdx) % RefreshSteps == 0 || rotation != observer.Rotation)
+			{
+				observer.Valid = {};
+				observer.Rotation = rotation;
+
+				for (int t = 0; t < NumTripods; ++t)
+				{
+					observer.ViewX[t] = std::cos(rotation + eye[3 * t].Direction);
+					observer.ViewY[t] = std::sin(rotation + eye[3 * t].Direction);
+				}
+			}
+
+			TRows lists;
+			for (int color = 0; color < NumColors; ++color)
+			{
+				PairRow row = rows[color];
+				auto& deltas = worker.Deltas[color];
+				deltas.clear();
+
+				++worker.Counters.Updates;
+				worker.Counters.Entries += row.Count;
+
+				if (observer.Valid[color])
+				{
+					Merge(worker, observer, color, row);
+					lists[color] = { deltas.data(), nullptr, static_cast<int>(deltas.size()) };
+				}
+				else
+				{
+					++worker.Counters.FullUpdates;
+
+					for (int t = 0; t < PaddedTripods; ++t)
+						observer.Values[color][t] = 0.0f;
+
+					observer.Objects[color].assign(row.Objects, row.Objects + row.Count);
+					observer.Used[color].assign(row.Directions, row.Directions + row.Count);
+					observer.Valid[color] = true;
+					lists[color] = row;
+				}
+
+				worker.Counters.Evaluated += lists[color].Count;
+			}
+
+			light(observer.Rotation, lists, observer.Values);
+			return observer.Values;
+		}
+	};
+}
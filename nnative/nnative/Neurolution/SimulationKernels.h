@@ -0,0 +1,655 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <cstdint>
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "../Utils.h"
+#include "../VectorMath.h"
+
+#include "NeuronKernels.h"
+#include "WorldUtils.h"
+
+namespace Neurolution
+{
+    // Cells moved together by MoveCells, structure of arrays. Lanes past Count are ignored
+    struct MovementBatch
+    {
+        static constexpr int Size = 16;
+
+        alignas(64) float ForceLeft[Size];
+        alignas(64) float ForceRight[Size];
+        alignas(64) float Energy[Size];
+        alignas(64) float Rotation[Size];
+        alignas(64) float VelocityX[Size];
+        alignas(64) float VelocityY[Size];
+        alignas(64) float LocationX[Size];
+        alignas(64) float LocationY[Size];
+        alignas(64) float Mass[Size];
+        alignas(64) int32_t Predator[Size]; // 0 or -1, as a lane mask
+
+        int Count{ 0 };
+
+        MovementBatch() noexcept
+        {
+            Clear();
+        }
+
+        void Clear() noexcept
+        {
+            for (int i = 0; i < Size; ++i)
+            {
+                ForceLeft[i] = ForceRight[i] = Energy[i] = Rotation[i] = 0.0f;
+                VelocityX[i] = VelocityY[i] = LocationX[i] = LocationY[i] = 0.0f;
+                Mass[i] = 1.0f;
+                Predator[i] = 0;
+            }
+            Count = 0;
+        }
+    };
+
+    // SIMD versions of the simulation's per-object math, on VectorMath:
+    //  - SinCos over an array
+    //  - EyeSignals: the light one tripod sensor gets from a list of objects, vectorized over
+    //    tripods, so each tripod still sums up the objects in their order
+    //  - VisibleObjects: the objects of an SoA list one cell sees, as the list for EyeSignals,
+    //    the visibility checks vectorized over objects
+    //  - MoveCells: the movement and physics of World::IterateCellThinkingAndMoving
+    // Scalar, AVX2 and AVX-512 versions do the same operations in the same order and are
+    // bit-identical, as long as the compiler does not contract the scalar ones into FMAs
+    // (MSVC does not by default). Array sizes must be multiples of 16, aligned by 64
+    namespace SimulationKernelImpl
+    {
+        static constexpr float Sqrt2 = 1.4142135623730950488016887242097f;
+        static constexpr float TwoPi = (float)(M_PI * 2.0f);
+
+        inline void SinCosScalar(const float* angles, float* sine, float* cosine, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+                VectorMath::SinCos(angles[i], sine[i], cosine[i]);
+        }
+
+        inline void EyeSignalsScalar(const float* viewX, const float* viewY, const float* widths, size_t numTripods,
+            const DirectionWithDistanceSquare* objects, size_t numObjects, float* values) noexcept
+        {
+            for (size_t i = 0; i < numObjects; ++i)
+            {
+                auto& item = objects[i];
+                float invSqrRoot = VectorMath::RSqrt(item.DistanceSquare);
+                float brightness = item.Energy * invSqrRoot * invSqrRoot;
+
+                for (size_t t = 0; t < numTripods; ++t)
+                {
+                    float modulo = std::fma(viewX[t], item.DirectionX, viewY[t] * item.DirectionY);
+                    if (modulo > 0.0f)
+                        values[t] += brightness * VectorMath::Pow(modulo * invSqrRoot, widths[t]);
+                }
+            }
+        }
+
+        // Raw displacement, or the shortest one across the borders with WrapAroundDistances, as 
+        // World::Displacement
+        template <typename WorldProp>
+        float DisplacementScalar(float d, float size) noexcept
+        {
+            if constexpr (WorldProp::WrapAroundDistances)
+            {
+                if (d > 0.5f * size)
+                    return d - size;
+                if (d < -0.5f * size)
+                    return d + size;
+            }
+            return d;
+        }
+
+        // Objects with brightness > 0, within MaxDistanceSquareVisibility and other than self 
+        // (index into the arrays, may be out of range) go to out, in their order
+        template <typename WorldProp>
+        size_t VisibleObjectsScalar(float x, float y, const float* objectX, const float* objectY, const float* brightness,
+            size_t numObjects, int self, float maxX, float maxY, DirectionWithDistanceSquare* out) noexcept
+        {
+            constexpr float radiusSquare = static_cast<float>(WorldProp::MaxDistanceSquareVisibility);
+
+            size_t count = 0;
+            for (size_t i = 0; i < numObjects; ++i)
+            {
+                float dx = DisplacementScalar<WorldProp>(objectX[i] - x, maxX);
+                float dy = DisplacementScalar<WorldProp>(objectY[i] - y, maxY);
+                float distanceSquare = dx * dx + dy * dy;
+
+                if (brightness[i] > 0.0f && !(distanceSquare > radiusSquare) && static_cast<int>(i) != self)
+                    out[count++] = { dx, dy, distanceSquare, brightness[i] };
+            }
+            return count;
+        }
+
+        template <typename WorldProp>
+        void MoveCellsScalar(MovementBatch& b, float maxX, float maxY) noexcept
+        {
+            constexpr float timeDelta = WorldProp::StepTimeDelta;
+
+            for (int i = 0; i < b.Count; ++i)
+            {
+                bool isPredator = b.Predator[i] != 0;
+                float forceLeft = b.ForceLeft[i];
+                float forceRight = b.ForceRight[i];
+
+                float forwardForce = (forceLeft + forceRight) / Sqrt2;
+                float rotationForce = (forceLeft - forceRight) / Sqrt2;
+
+                float moveEnergyRequired = (std::abs(forceLeft) + std::abs(forceRight)) *
+                    (isPredator ? WorldProp::PredatorMoveEnergyFactor : WorldProp::MoveEnergyFactor);
+
+                if (isPredator)
+                {
+                    forwardForce *= 0.94f;
+                    if (b.Energy[i] > WorldProp::PredatorsOvereatEnergy)
+                        forwardForce *= WorldProp::PredatorsOveratSlowdownFactor;
+                }
+                else if (b.Energy[i] < WorldProp::SedatedAtEnergyLevel)
+                {
+                    float slowdownFactor = b.Energy[i] / WorldProp::SedatedAtEnergyLevel;
+                    forwardForce *= slowdownFactor;
+                    rotationForce *= slowdownFactor;
+                    moveEnergyRequired *= slowdownFactor;
+                }
+
+                if (moveEnergyRequired <= b.Energy[i])
+                {
+                    b.Energy[i] -= moveEnergyRequired;
+                    b.Rotation[i] = LoopValue(b.Rotation[i] + rotationForce, 0.0f, TwoPi);
+
+                    float sine, cosine;
+                    VectorMath::SinCos(b.Rotation[i], sine, cosine);
+
+                    if constexpr (WorldProp::RealPhysics)
+                    {
+                        float velocityX = b.VelocityX[i];
+                        float velocityY = b.VelocityY[i];
+
+                        float velocitySquare = velocityX * velocityX + velocityY * velocityY;
+                        if (velocitySquare > 0.0000001f)
+                        {
+                            float velocity = VectorMath::Sqrt(velocitySquare);
+                            float velocityCube = velocity * velocitySquare;
+
+                            float airDrag =
+                                WorldProp::AirDragFactorCube * velocityCube +
+                                WorldProp::AirDragFactorQuadratic * velocitySquare +
+                                WorldProp::AirDragFactorLinear * velocity;
+
+                            float airDragDeltaV = airDrag / b.Mass[i] * timeDelta;
+                            airDragDeltaV = (airDragDeltaV < velocity) ? airDragDeltaV : velocity;
+
+                            velocityX -= airDragDeltaV * (velocityX / velocity) * timeDelta;
+                            velocityY -= airDragDeltaV * (velocityY / velocity) * timeDelta;
+                        }
+
+                        float forwardForceDeltaV = forwardForce / b.Mass[i] * timeDelta;
+
+                        velocityX += forwardForceDeltaV * cosine * timeDelta;
+                        velocityY += forwardForceDeltaV * sine * timeDelta;
+
+                        b.VelocityX[i] = velocityX;
+                        b.VelocityY[i] = velocityY;
+                        b.LocationX[i] = LoopValue(b.LocationX[i] + velocityX * timeDelta, 0.0f, maxX);
+                        b.LocationY[i] = LoopValue(b.LocationY[i] + velocityY * timeDelta, 0.0f, maxY);
+                    }
+                    else
+                    {
+                        b.LocationX[i] = LoopValue(b.LocationX[i] + forwardForce * cosine, 0.0f, maxX);
+                        b.LocationY[i] = LoopValue(b.LocationY[i] + forwardForce * sine, 0.0f, maxY);
+                    }
+                }
+                else if (!isPredator)
+                {
+                    b.Energy[i] = 0.0f;
+                }
+            }
+        }
+
+        // AVX2
+
+        NN_TARGET_AVX2 inline void SinCosAvx2(const float* angles, float* sine, float* cosine, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; i += 8)
+            {
+                __m256 s, c;
+                VectorMath::SinCos(_mm256_load_ps(angles + i), s, c);
+                _mm256_store_ps(sine + i, s);
+                _mm256_store_ps(cosine + i, c);
+            }
+        }
+
+        NN_TARGET_AVX2 inline void EyeSignalsAvx2(const float* viewX, const float* viewY, const float* widths, size_t numTripods,
+            const DirectionWithDistanceSquare* objects, size_t numObjects, float* values) noexcept
+        {
+            for (size_t i = 0; i < numObjects; ++i)
+            {
+                auto& item = objects[i];
+                float invSqrRoot = VectorMath::RSqrt(item.DistanceSquare);
+
+                __m256 inv = _mm256_set1_ps(invSqrRoot);
+                __m256 brightness = _mm256_set1_ps(item.Energy * invSqrRoot * invSqrRoot);
+                __m256 dx = _mm256_set1_ps(item.DirectionX);
+                __m256 dy = _mm256_set1_ps(item.DirectionY);
+
+                for (size_t t = 0; t < numTripods; t += 8)
+                {
+                    __m256 modulo = _mm256_fmadd_ps(_mm256_load_ps(viewX + t), dx, _mm256_mul_ps(_mm256_load_ps(viewY + t), dy));
+                    __m256 visible = _mm256_cmp_ps(modulo, _mm256_setzero_ps(), _CMP_GT_OQ);
+
+                    __m256 signal = _mm256_mul_ps(brightness,
+                        VectorMath::Pow(_mm256_mul_ps(modulo, inv), _mm256_load_ps(widths + t)));
+
+                    _mm256_store_ps(values + t, _mm256_add_ps(_mm256_load_ps(values + t), _mm256_and_ps(signal, visible)));
+                }
+            }
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX2 __m256 DisplacementAvx2(__m256 d, __m256 size) noexcept
+        {
+            if constexpr (WorldProp::WrapAroundDistances)
+            {
+                __m256 half = _mm256_mul_ps(_mm256_set1_ps(0.5f), size);
+                __m256 wrapped = _mm256_blendv_ps(d, _mm256_sub_ps(d, size), _mm256_cmp_ps(d, half, _CMP_GT_OQ));
+                return _mm256_blendv_ps(wrapped, _mm256_add_ps(d, size),
+                    _mm256_cmp_ps(d, _mm256_mul_ps(_mm256_set1_ps(-0.5f), size), _CMP_LT_OQ));
+            }
+            return d;
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX2 size_t VisibleObjectsAvx2(float x, float y, const float* objectX, const float* objectY, const float* brightness,
+            size_t numObjects, int self, float maxX, float maxY, DirectionWithDistanceSquare* out) noexcept
+        {
+            const __m256 px = _mm256_set1_ps(x);
+            const __m256 py = _mm256_set1_ps(y);
+            const __m256 sizeX = _mm256_set1_ps(maxX);
+            const __m256 sizeY = _mm256_set1_ps(maxY);
+            const __m256 radiusSquare = _mm256_set1_ps(static_cast<float>(WorldProp::MaxDistanceSquareVisibility));
+
+            alignas(32) float dxs[8];
+            alignas(32) float dys[8];
+            alignas(32) float distances[8];
+
+            size_t count = 0;
+            for (size_t i = 0; i < numObjects; i += 8)
+            {
+                __m256 dx = DisplacementAvx2<WorldProp>(_mm256_sub_ps(_mm256_load_ps(objectX + i), px), sizeX);
+                __m256 dy = DisplacementAvx2<WorldProp>(_mm256_sub_ps(_mm256_load_ps(objectY + i), py), sizeY);
+                __m256 distanceSquare = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+                __m256 visible = _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_load_ps(brightness + i), _mm256_setzero_ps(), _CMP_GT_OQ),
+                    _mm256_cmp_ps(distanceSquare, radiusSquare, _CMP_NGT_UQ));
+
+                int mask = _mm256_movemask_ps(visible);
+                if (static_cast<size_t>(self - static_cast<int>(i)) < 8)
+                    mask &= ~(1 << (self - static_cast<int>(i)));
+                if (mask == 0)
+                    continue;
+
+                _mm256_store_ps(dxs, dx);
+                _mm256_store_ps(dys, dy);
+                _mm256_store_ps(distances, distanceSquare);
+
+                for (int lane = 0; lane < 8; ++lane)
+                {
+                    if (mask & (1 << lane))
+                        out[count++] = { dxs[lane], dys[lane], distances[lane], brightness[i + lane] };
+                }
+            }
+            return count;
+        }
+
+        NN_TARGET_AVX2 inline __m256 LoopValueAvx2(__m256 value, __m256 maxValue) noexcept
+        {
+            value = _mm256_blendv_ps(value, _mm256_sub_ps(value, maxValue), _mm256_cmp_ps(value, maxValue, _CMP_GE_OQ));
+            return _mm256_blendv_ps(value, _mm256_add_ps(value, maxValue), _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX2 void MoveCellsAvx2(MovementBatch& b, float maxX, float maxY) noexcept
+        {
+            const __m256 timeDelta = _mm256_set1_ps(WorldProp::StepTimeDelta);
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+            for (int offs = 0; offs < b.Count; offs += 8)
+            {
+                __m256 isPredator = _mm256_castsi256_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(b.Predator + offs)));
+                __m256 forceLeft = _mm256_load_ps(b.ForceLeft + offs);
+                __m256 forceRight = _mm256_load_ps(b.ForceRight + offs);
+                __m256 energy = _mm256_load_ps(b.Energy + offs);
+                __m256 mass = _mm256_load_ps(b.Mass + offs);
+
+                __m256 forwardForce = _mm256_div_ps(_mm256_add_ps(forceLeft, forceRight), _mm256_set1_ps(Sqrt2));
+                __m256 rotationForce = _mm256_div_ps(_mm256_sub_ps(forceLeft, forceRight), _mm256_set1_ps(Sqrt2));
+
+                __m256 moveEnergyRequired = _mm256_mul_ps(
+                    _mm256_add_ps(_mm256_and_ps(forceLeft, absMask), _mm256_and_ps(forceRight, absMask)),
+                    _mm256_blendv_ps(_mm256_set1_ps(WorldProp::MoveEnergyFactor), _mm256_set1_ps(WorldProp::PredatorMoveEnergyFactor), isPredator));
+
+                // predators: a bit slow and heavy, slower still when overeaten
+                __m256 predatorForward = _mm256_mul_ps(forwardForce, _mm256_set1_ps(0.94f));
+                predatorForward = _mm256_blendv_ps(predatorForward,
+                    _mm256_mul_ps(predatorForward, _mm256_set1_ps(WorldProp::PredatorsOveratSlowdownFactor)),
+                    _mm256_cmp_ps(energy, _mm256_set1_ps(WorldProp::PredatorsOvereatEnergy), _CMP_GT_OQ));
+
+                // sedated prey
+                __m256 sedated = _mm256_andnot_ps(isPredator, _mm256_cmp_ps(energy, _mm256_set1_ps(WorldProp::SedatedAtEnergyLevel), _CMP_LT_OQ));
+                __m256 slowdownFactor = _mm256_div_ps(energy, _mm256_set1_ps(WorldProp::SedatedAtEnergyLevel));
+                forwardForce = _mm256_blendv_ps(forwardForce, _mm256_mul_ps(forwardForce, slowdownFactor), sedated);
+                rotationForce = _mm256_blendv_ps(rotationForce, _mm256_mul_ps(rotationForce, slowdownFactor), sedated);
+                moveEnergyRequired = _mm256_blendv_ps(moveEnergyRequired, _mm256_mul_ps(moveEnergyRequired, slowdownFactor), sedated);
+
+                forwardForce = _mm256_blendv_ps(forwardForce, predatorForward, isPredator);
+
+                __m256 moves = _mm256_cmp_ps(moveEnergyRequired, energy, _CMP_LE_OQ);
+
+                __m256 rotation = LoopValueAvx2(_mm256_add_ps(_mm256_load_ps(b.Rotation + offs), rotationForce), _mm256_set1_ps(TwoPi));
+
+                __m256 sine, cosine;
+                VectorMath::SinCos(rotation, sine, cosine);
+
+                __m256 velocityX = _mm256_load_ps(b.VelocityX + offs);
+                __m256 velocityY = _mm256_load_ps(b.VelocityY + offs);
+                __m256 locationX = _mm256_load_ps(b.LocationX + offs);
+                __m256 locationY = _mm256_load_ps(b.LocationY + offs);
+
+                if constexpr (WorldProp::RealPhysics)
+                {
+                    __m256 velocitySquare = _mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY));
+                    __m256 moving = _mm256_cmp_ps(velocitySquare, _mm256_set1_ps(0.0000001f), _CMP_GT_OQ);
+
+                    __m256 velocity = VectorMath::Sqrt(velocitySquare);
+                    __m256 velocityCube = _mm256_mul_ps(velocity, velocitySquare);
+
+                    __m256 airDrag = _mm256_add_ps(
+                        _mm256_add_ps(
+                            _mm256_mul_ps(_mm256_set1_ps(WorldProp::AirDragFactorCube), velocityCube),
+                            _mm256_mul_ps(_mm256_set1_ps(WorldProp::AirDragFactorQuadratic), velocitySquare)),
+                        _mm256_mul_ps(_mm256_set1_ps(WorldProp::AirDragFactorLinear), velocity));
+
+                    __m256 airDragDeltaV = _mm256_mul_ps(_mm256_div_ps(airDrag, mass), timeDelta);
+                    airDragDeltaV = _mm256_min_ps(airDragDeltaV, velocity);
+
+                    __m256 draggedX = _mm256_sub_ps(velocityX, _mm256_mul_ps(_mm256_mul_ps(airDragDeltaV, _mm256_div_ps(velocityX, velocity)), timeDelta));
+                    __m256 draggedY = _mm256_sub_ps(velocityY, _mm256_mul_ps(_mm256_mul_ps(airDragDeltaV, _mm256_div_ps(velocityY, velocity)), timeDelta));
+                    __m256 newVelocityX = _mm256_blendv_ps(velocityX, draggedX, moving);
+                    __m256 newVelocityY = _mm256_blendv_ps(velocityY, draggedY, moving);
+
+                    __m256 forwardForceDeltaV = _mm256_mul_ps(_mm256_div_ps(forwardForce, mass), timeDelta);
+                    newVelocityX = _mm256_add_ps(newVelocityX, _mm256_mul_ps(_mm256_mul_ps(forwardForceDeltaV, cosine), timeDelta));
+                    newVelocityY = _mm256_add_ps(newVelocityY, _mm256_mul_ps(_mm256_mul_ps(forwardForceDeltaV, sine), timeDelta));
+
+                    __m256 newLocationX = LoopValueAvx2(_mm256_add_ps(locationX, _mm256_mul_ps(newVelocityX, timeDelta)), _mm256_set1_ps(maxX));
+                    __m256 newLocationY = LoopValueAvx2(_mm256_add_ps(locationY, _mm256_mul_ps(newVelocityY, timeDelta)), _mm256_set1_ps(maxY));
+
+                    _mm256_store_ps(b.VelocityX + offs, _mm256_blendv_ps(velocityX, newVelocityX, moves));
+                    _mm256_store_ps(b.VelocityY + offs, _mm256_blendv_ps(velocityY, newVelocityY, moves));
+                    _mm256_store_ps(b.LocationX + offs, _mm256_blendv_ps(locationX, newLocationX, moves));
+                    _mm256_store_ps(b.LocationY + offs, _mm256_blendv_ps(locationY, newLocationY, moves));
+                }
+                else
+                {
+                    __m256 newLocationX = LoopValueAvx2(_mm256_add_ps(locationX, _mm256_mul_ps(forwardForce, cosine)), _mm256_set1_ps(maxX));
+                    __m256 newLocationY = LoopValueAvx2(_mm256_add_ps(locationY, _mm256_mul_ps(forwardForce, sine)), _mm256_set1_ps(maxY));
+
+                    _mm256_store_ps(b.LocationX + offs, _mm256_blendv_ps(locationX, newLocationX, moves));
+                    _mm256_store_ps(b.LocationY + offs, _mm256_blendv_ps(locationY, newLocationY, moves));
+                }
+
+                _mm256_store_ps(b.Rotation + offs, _mm256_blendv_ps(_mm256_load_ps(b.Rotation + offs), rotation, moves));
+
+                // prey that could not afford the move is dead, predators just wait
+                __m256 stuckEnergy = _mm256_and_ps(energy, isPredator);
+                _mm256_store_ps(b.Energy + offs, _mm256_blendv_ps(stuckEnergy, _mm256_sub_ps(energy, moveEnergyRequired), moves));
+            }
+        }
+
+        // AVX-512
+
+        NN_TARGET_AVX512 inline void SinCosAvx512(const float* angles, float* sine, float* cosine, size_t size) noexcept
+        {
+            for (size_t i = 0; i < size; i += 16)
+            {
+                __m512 s, c;
+                VectorMath::SinCos(_mm512_load_ps(angles + i), s, c);
+                _mm512_store_ps(sine + i, s);
+                _mm512_store_ps(cosine + i, c);
+            }
+        }
+
+        NN_TARGET_AVX512 inline void EyeSignalsAvx512(const float* viewX, const float* viewY, const float* widths, size_t numTripods,
+            const DirectionWithDistanceSquare* objects, size_t numObjects, float* values) noexcept
+        {
+            for (size_t i = 0; i < numObjects; ++i)
+            {
+                auto& item = objects[i];
+                float invSqrRoot = VectorMath::RSqrt(item.DistanceSquare);
+
+                __m512 inv = _mm512_set1_ps(invSqrRoot);
+                __m512 brightness = _mm512_set1_ps(item.Energy * invSqrRoot * invSqrRoot);
+                __m512 dx = _mm512_set1_ps(item.DirectionX);
+                __m512 dy = _mm512_set1_ps(item.DirectionY);
+
+                for (size_t t = 0; t < numTripods; t += 16)
+                {
+                    __m512 modulo = _mm512_fmadd_ps(_mm512_load_ps(viewX + t), dx, _mm512_mul_ps(_mm512_load_ps(viewY + t), dy));
+                    __mmask16 visible = _mm512_cmp_ps_mask(modulo, _mm512_setzero_ps(), _CMP_GT_OQ);
+
+                    __m512 signal = _mm512_mul_ps(brightness,
+                        VectorMath::Pow(_mm512_mul_ps(modulo, inv), _mm512_load_ps(widths + t)));
+
+                    __m512 acc = _mm512_load_ps(values + t);
+                    _mm512_store_ps(values + t, _mm512_mask_add_ps(acc, visible, acc, signal));
+                }
+            }
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX512 __m512 DisplacementAvx512(__m512 d, __m512 size) noexcept
+        {
+            if constexpr (WorldProp::WrapAroundDistances)
+            {
+                __m512 half = _mm512_mul_ps(_mm512_set1_ps(0.5f), size);
+                __m512 wrapped = _mm512_mask_sub_ps(d, _mm512_cmp_ps_mask(d, half, _CMP_GT_OQ), d, size);
+                return _mm512_mask_add_ps(wrapped,
+                    _mm512_cmp_ps_mask(d, _mm512_mul_ps(_mm512_set1_ps(-0.5f), size), _CMP_LT_OQ), d, size);
+            }
+            return d;
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX512 size_t VisibleObjectsAvx512(float x, float y, const float* objectX, const float* objectY, const float* brightness,
+            size_t numObjects, int self, float maxX, float maxY, DirectionWithDistanceSquare* out) noexcept
+        {
+            const __m512 px = _mm512_set1_ps(x);
+            const __m512 py = _mm512_set1_ps(y);
+            const __m512 sizeX = _mm512_set1_ps(maxX);
+            const __m512 sizeY = _mm512_set1_ps(maxY);
+            const __m512 radiusSquare = _mm512_set1_ps(static_cast<float>(WorldProp::MaxDistanceSquareVisibility));
+
+            alignas(64) float dxs[16];
+            alignas(64) float dys[16];
+            alignas(64) float distances[16];
+
+            size_t count = 0;
+            for (size_t i = 0; i < numObjects; i += 16)
+            {
+                __m512 dx = DisplacementAvx512<WorldProp>(_mm512_sub_ps(_mm512_load_ps(objectX + i), px), sizeX);
+                __m512 dy = DisplacementAvx512<WorldProp>(_mm512_sub_ps(_mm512_load_ps(objectY + i), py), sizeY);
+                __m512 distanceSquare = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+
+                __mmask16 visible = _mm512_mask_cmp_ps_mask(
+                    _mm512_cmp_ps_mask(_mm512_load_ps(brightness + i), _mm512_setzero_ps(), _CMP_GT_OQ),
+                    distanceSquare, radiusSquare, _CMP_NGT_UQ);
+
+                int mask = visible;
+                if (static_cast<size_t>(self - static_cast<int>(i)) < 16)
+                    mask &= ~(1 << (self - static_cast<int>(i)));
+                if (mask == 0)
+                    continue;
+
+                _mm512_store_ps(dxs, dx);
+                _mm512_store_ps(dys, dy);
+                _mm512_store_ps(distances, distanceSquare);
+
+                for (int lane = 0; lane < 16; ++lane)
+                {
+                    if (mask & (1 << lane))
+                        out[count++] = { dxs[lane], dys[lane], distances[lane], brightness[i + lane] };
+                }
+            }
+            return count;
+        }
+
+        NN_TARGET_AVX512 inline __m512 LoopValueAvx512(__m512 value, __m512 maxValue) noexcept
+        {
+            value = _mm512_mask_sub_ps(value, _mm512_cmp_ps_mask(value, maxValue, _CMP_GE_OQ), value, maxValue);
+            return _mm512_mask_add_ps(value, _mm512_cmp_ps_mask(value, _mm512_setzero_ps(), _CMP_LT_OQ), value, maxValue);
+        }
+
+        template <typename WorldProp>
+        NN_TARGET_AVX512 void MoveCellsAvx512(MovementBatch& b, float maxX, float maxY) noexcept
+        {
+            const __m512 timeDelta = _mm512_set1_ps(WorldProp::StepTimeDelta);
+            const __m512i absMask = _mm512_set1_epi32(0x7fffffff);
+
+            __mmask16 isPredator = _mm512_test_epi32_mask(_mm512_load_si512(b.Predator), _mm512_set1_epi32(-1));
+            __m512 forceLeft = _mm512_load_ps(b.ForceLeft);
+            __m512 forceRight = _mm512_load_ps(b.ForceRight);
+            __m512 energy = _mm512_load_ps(b.Energy);
+            __m512 mass = _mm512_load_ps(b.Mass);
+
+            __m512 forwardForce = _mm512_div_ps(_mm512_add_ps(forceLeft, forceRight), _mm512_set1_ps(Sqrt2));
+            __m512 rotationForce = _mm512_div_ps(_mm512_sub_ps(forceLeft, forceRight), _mm512_set1_ps(Sqrt2));
+
+            __m512 absSum = _mm512_add_ps(
+                _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(forceLeft), absMask)),
+                _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(forceRight), absMask)));
+            __m512 moveEnergyRequired = _mm512_mul_ps(absSum,
+                _mm512_mask_blend_ps(isPredator, _mm512_set1_ps(WorldProp::MoveEnergyFactor), _mm512_set1_ps(WorldProp::PredatorMoveEnergyFactor)));
+
+            // predators: a bit slow and heavy, slower still when overeaten
+            __m512 predatorForward = _mm512_mul_ps(forwardForce, _mm512_set1_ps(0.94f));
+            predatorForward = _mm512_mask_mul_ps(predatorForward,
+                _mm512_cmp_ps_mask(energy, _mm512_set1_ps(WorldProp::PredatorsOvereatEnergy), _CMP_GT_OQ),
+                predatorForward, _mm512_set1_ps(WorldProp::PredatorsOveratSlowdownFactor));
+
+            // sedated prey
+            __mmask16 sedated = _mm512_kandn(isPredator, _mm512_cmp_ps_mask(energy, _mm512_set1_ps(WorldProp::SedatedAtEnergyLevel), _CMP_LT_OQ));
+            __m512 slowdownFactor = _mm512_div_ps(energy, _mm512_set1_ps(WorldProp::SedatedAtEnergyLevel));
+            forwardForce = _mm512_mask_mul_ps(forwardForce, sedated, forwardForce, slowdownFactor);
+            rotationForce = _mm512_mask_mul_ps(rotationForce, sedated, rotationForce, slowdownFactor);
+            moveEnergyRequired = _mm512_mask_mul_ps(moveEnergyRequired, sedated, moveEnergyRequired, slowdownFactor);
+
+            forwardForce = _mm512_mask_blend_ps(isPredator, forwardForce, predatorForward);
+
+            __mmask16 moves = _mm512_cmp_ps_mask(moveEnergyRequired, energy, _CMP_LE_OQ);
+
+            __m512 oldRotation = _mm512_load_ps(b.Rotation);
+            __m512 rotation = LoopValueAvx512(_mm512_add_ps(oldRotation, rotationForce), _mm512_set1_ps(TwoPi));
+
+            __m512 sine, cosine;
+            VectorMath::SinCos(rotation, sine, cosine);
+
+            __m512 velocityX = _mm512_load_ps(b.VelocityX);
+            __m512 velocityY = _mm512_load_ps(b.VelocityY);
+            __m512 locationX = _mm512_load_ps(b.LocationX);
+            __m512 locationY = _mm512_load_ps(b.LocationY);
+
+            if constexpr (WorldProp::RealPhysics)
+            {
+                __m512 velocitySquare = _mm512_add_ps(_mm512_mul_ps(velocityX, velocityX), _mm512_mul_ps(velocityY, velocityY));
+                __mmask16 moving = _mm512_cmp_ps_mask(velocitySquare, _mm512_set1_ps(0.0000001f), _CMP_GT_OQ);
+
+                __m512 velocity = VectorMath::Sqrt(velocitySquare);
+                __m512 velocityCube = _mm512_mul_ps(velocity, velocitySquare);
+
+                __m512 airDrag = _mm512_add_ps(
+                    _mm512_add_ps(
+                        _mm512_mul_ps(_mm512_set1_ps(WorldProp::AirDragFactorCube), velocityCube),
+                        _mm512_mul_ps(_mm512_set1_ps(WorldProp::AirDragFactorQuadratic), velocitySquare)),
+                    _mm512_mul_ps(_mm512_set1_ps(WorldProp::AirDragFactorLinear), velocity));
+
+                __m512 airDragDeltaV = _mm512_mul_ps(_mm512_div_ps(airDrag, mass), timeDelta);
+                airDragDeltaV = _mm512_min_ps(airDragDeltaV, velocity);
+
+                __m512 newVelocityX = _mm512_mask_sub_ps(velocityX, moving, velocityX,
+                    _mm512_mul_ps(_mm512_mul_ps(airDragDeltaV, _mm512_div_ps(velocityX, velocity)), timeDelta));
+                __m512 newVelocityY = _mm512_mask_sub_ps(velocityY, moving, velocityY,
+                    _mm512_mul_ps(_mm512_mul_ps(airDragDeltaV, _mm512_div_ps(velocityY, velocity)), timeDelta));
+
+                __m512 forwardForceDeltaV = _mm512_mul_ps(_mm512_div_ps(forwardForce, mass), timeDelta);
+                newVelocityX = _mm512_add_ps(newVelocityX, _mm512_mul_ps(_mm512_mul_ps(forwardForceDeltaV, cosine), timeDelta));
+                newVelocityY = _mm512_add_ps(newVelocityY, _mm512_mul_ps(_mm512_mul_ps(forwardForceDeltaV, sine), timeDelta));
+
+                __m512 newLocationX = LoopValueAvx512(_mm512_add_ps(locationX, _mm512_mul_ps(newVelocityX, timeDelta)), _mm512_set1_ps(maxX));
+                __m512 newLocationY = LoopValueAvx512(_mm512_add_ps(locationY, _mm512_mul_ps(newVelocityY, timeDelta)), _mm512_set1_ps(maxY));
+
+                _mm512_store_ps(b.VelocityX, _mm512_mask_blend_ps(moves, velocityX, newVelocityX));
+                _mm512_store_ps(b.VelocityY, _mm512_mask_blend_ps(moves, velocityY, newVelocityY));
+                _mm512_store_ps(b.LocationX, _mm512_mask_blend_ps(moves, locationX, newLocationX));
+                _mm512_store_ps(b.LocationY, _mm512_mask_blend_ps(moves, locationY, newLocationY));
+            }
+            else
+            {
+                __m512 newLocationX = LoopValueAvx512(_mm512_add_ps(locationX, _mm512_mul_ps(forwardForce, cosine)), _mm512_set1_ps(maxX));
+                __m512 newLocationY = LoopValueAvx512(_mm512_add_ps(locationY, _mm512_mul_ps(forwardForce, sine)), _mm512_set1_ps(maxY));
+
+                _mm512_store_ps(b.LocationX, _mm512_mask_blend_ps(moves, locationX, newLocationX));
+                _mm512_store_ps(b.LocationY, _mm512_mask_blend_ps(moves, locationY, newLocationY));
+            }
+
+            _mm512_store_ps(b.Rotation, _mm512_mask_blend_ps(moves, oldRotation, rotation));
+
+            // prey that could not afford the move is dead, predators just wait
+            __m512 stuckEnergy = _mm512_maskz_mov_ps(isPredator, energy);
+            _mm512_store_ps(b.Energy, _mm512_mask_blend_ps(moves, stuckEnergy, _mm512_sub_ps(energy, moveEnergyRequired)));
+        }
+    }
+
+    template <typename WorldProp>
+    struct SimulationKernels
+    {
+        using TSinCosFn = void(*)(const float* angles, float* sine, float* cosine, size_t size);
+        using TEyeSignalsFn = void(*)(const float* viewX, const float* viewY, const float* widths, size_t numTripods,
+            const DirectionWithDistanceSquare* objects, size_t numObjects, float* values);
+        using TMoveCellsFn = void(*)(MovementBatch& batch, float maxX, float maxY);
+        using TVisibleObjectsFn = size_t(*)(float x, float y, const float* objectX, const float* objectY, const float* brightness,
+            size_t numObjects, int self, float maxX, float maxY, DirectionWithDistanceSquare* out);
+
+        KernelIsa Isa;
+        TSinCosFn SinCos;
+        TEyeSignalsFn EyeSignals;
+        TMoveCellsFn MoveCells;
+        TVisibleObjectsFn VisibleObjects;
+
+        static const SimulationKernels& Get() noexcept
+        {
+            static const SimulationKernels kernels = For(KernelDispatch::Selected());
+            return kernels;
+        }
+
+        static SimulationKernels For(KernelIsa isa) noexcept
+        {
+            using namespace SimulationKernelImpl;
+
+            switch (isa)
+            {
+            case KernelIsa::Avx512:
+                return { isa, &SinCosAvx512, &EyeSignalsAvx512, &MoveCellsAvx512<WorldProp>, &VisibleObjectsAvx512<WorldProp> };
+            case KernelIsa::Avx2:
+                return { isa, &SinCosAvx2, &EyeSignalsAvx2, &MoveCellsAvx2<WorldProp>, &VisibleObjectsAvx2<WorldProp> };
+            default:
+                return { KernelIsa::Scalar, &SinCosScalar, &EyeSignalsScalar, &MoveCellsScalar<WorldProp>, &VisibleObjectsScalar<WorldProp> };
+            }
+        }
+    };
+}
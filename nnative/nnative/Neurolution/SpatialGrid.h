@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "../ThreadGrid.h"
+
+namespace Neurolution
+{
+	// Uniform grid over the [0, maxX] x [0, maxY] world for one kind of objects (foods, prey,
+	// predators), referenced by their index in the owning container. Rebuilt from scratch with
+	// a counting sort in three parallel passes: object -> grid cell, per-cell counts, offsets
+	// + fill. Each worker owns a band of grid rows, so the objects of any grid cell are always
+	// stored in ascending index order and the result does not depend on the thread count
+	class SpatialGrid
+	{
+		float _invCellSize;
+		int _numX;
+		int _numY;
+
+		std::vector<int> _objectCells;	// grid cell of each object
+		std::vector<int> _cellStart;	// objects of cell c are _objects[_cellStart[c] .. _cellStart[c + 1])
+		std::vector<int> _cellCount;	// also used as a fill cursor
+		std::vector<int> _bandStart;	// first object slot of each worker's band
+		std::vector<int> _objects;
+
+		int ClampX(int cx) const noexcept
+		{
+			return cx < 0 ? 0 : (cx >= _numX ? _numX - 1 : cx);
+		}
+
+		int ClampY(int cy) const noexcept
+		{
+			return cy < 0 ? 0 : (cy >= _numY ? _numY - 1 : cy);
+		}
+
+		int BandFrom(int threadIdx, int numThreads) const noexcept
+		{
+			return static_cast<int>(static_cast<long long>(_numY) * threadIdx / numThreads) * _numX;
+		}
+
+		void AppendCell(int cx, int cy, std::vector<int>& out) const
+		{
+			int c = cy * _numX + cx;
+			out.insert(out.end(), _objects.begin() + _cellStart[c], _objects.begin() + _cellStart[c + 1]);
+		}
+
+	public:
+		SpatialGrid(float cellSize, int maxX, int maxY)
+			: _invCellSize(1.0f / cellSize)
+			, _numX(static_cast<int>(maxX / cellSize) + 1)
+			, _numY(static_cast<int>(maxY / cellSize) + 1)
+			, _cellStart(static_cast<size_t>(_numX) * _numY + 1, 0)
+			, _cellCount(static_cast<size_t>(_numX) * _numY, 0)
+		{
+		}
+
+		int CellOf(float x, float y) const noexcept
+		{
+			return ClampY(static_cast<int>(y * _invCellSize)) * _numX + ClampX(static_cast<int>(x * _invCellSize));
+		}
+
+		// position(idx, x, y) reports where object idx is
+		template <typename TPositionFn>
+		void Rebuild(ThreadGrid& grid, int numObjects, TPositionFn&& position)
+		{
+			int numThreads = grid.GetNumThreads();
+
+			_objectCells.resize(numObjects);
+			_objects.resize(numObjects);
+			_bandStart.resize(numThreads + 1);
+
+			grid.GridRun([&](int idx, int n)
+			{
+				for (int i = idx; i < numObjects; i += n)
+				{
+					float x, y;
+					position(i, x, y);
+					_objectCells[i] = CellOf(x, y);
+				}
+			});
+
+			grid.GridRun([&](int idx, int n)
+			{
+				int from = BandFrom(idx, n);
+				int to = BandFrom(idx + 1, n);
+
+				std::fill(_cellCount.begin() + from, _cellCount.begin() + to, 0);
+
+				for (int i = 0; i < numObjects; ++i)
+				{
+					int c = _objectCells[i];
+					if (c >= from && c < to)
+						++_cellCount[c];
+				}
+
+				int total = 0;
+				for (int c = from; c < to; ++c)
+					total += _cellCount[c];
+				_bandStart[idx + 1] = total;
+			});
+
+			_bandStart[0] = 0;
+			for (int t = 0; t < numThreads; ++t)
+				_bandStart[t + 1] += _bandStart[t];
+
+			grid.GridRun([&](int idx, int n)
+			{
+				int from = BandFrom(idx, n);
+				int to = BandFrom(idx + 1, n);
+
+				int offset = _bandStart[idx];
+				for (int c = from; c < to; ++c)
+				{
+					_cellStart[c] = offset;
+					offset += _cellCount[c];
+					_cellCount[c] = _cellStart[c];
+				}
+
+				for (int i = 0; i < numObjects; ++i)
+				{
+					int c = _objectCells[i];
+					if (c >= from && c < to)
+						_objects[_cellCount[c]++] = i;
+				}
+			});
+
+			_cellStart.back() = numObjects;
+		}
+
+		// Appends to out (cleared first) the indices of all the objects in the grid cells touching
+		// the square around (x, y), ascending, so sums over them keep the brute force order. The
+		// caller does the exact distance check. With wrap the square continues across the world
+		// borders, same as LoopValue
+		void Query(float x, float y, float radius, bool wrap, std::vector<int>& out) const
+		{
+			out.clear();
+			QueryAppend(x, y, radius, wrap, 0, out);
+		}
+
+		// As Query, but keeps what is in out already and appends the indices + offset after it,
+		// to query several grids sharing one index space
+		void QueryAppend(float x, float y, float radius, bool wrap, int offset, std::vector<int>& out) const
+		{
+			size_t first = out.size();
+
+			int cx0 = static_cast<int>(std::floor((x - radius) * _invCellSize));
+			int cx1 = static_cast<int>(std::floor((x + radius) * _invCellSize));
+			int cy0 = static_cast<int>(std::floor((y - radius) * _invCellSize));
+			int cy1 = static_cast<int>(std::floor((y + radius) * _invCellSize));
+
+			if (!wrap)
+			{
+				cx0 = ClampX(cx0);
+				cx1 = ClampX(cx1);
+				cy0 = ClampY(cy0);
+				cy1 = ClampY(cy1);
+			}
+			else
+			{
+				// the last row / column is only partially inside the world, one extra cell each
+				// side covers what lies past the border
+				if (cx0 < 0) --cx0;
+				if (cx1 >= _numX - 1) ++cx1;
+				if (cy0 < 0) --cy0;
+				if (cy1 >= _numY - 1) ++cy1;
+
+				if (cx1 - cx0 + 1 >= _numX) { cx0 = 0; cx1 = _numX - 1; }
+				if (cy1 - cy0 + 1 >= _numY) { cy0 = 0; cy1 = _numY - 1; }
+			}
+
+			for (int cy = cy0; cy <= cy1; ++cy)
+			{
+				int wy = cy < 0 ? cy + _numY : (cy >= _numY ? cy - _numY : cy);
+				for (int cx = cx0; cx <= cx1; ++cx)
+				{
+					int wx = cx < 0 ? cx + _numX : (cx >= _numX ? cx - _numX : cx);
+					AppendCell(wx, wy, out);
+				}
+			}
+
+			for (size_t i = first; i < out.size(); ++i)
+				out[i] += offset;
+
+			std::sort(out.begin() + first, out.end());
+		}
+	};
+}
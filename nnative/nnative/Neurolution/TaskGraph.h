@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ThreadGrid.h"
+
+namespace Neurolution
+{
+	// A step as a DAG of tasks. Each task says which resources (bits: entity classes, the
+	// grids and tables built from them, ...) it reads and which it writes, and depends on
+	// every task added before it that it conflicts with (one writes what the other reads or
+	// writes), so the order of adding is kept wherever it matters. Run goes through the graph
+	// on a ThreadGrid: the collective tasks, which run GridRuns themselves, one at a time on
+	// the calling thread, all the others concurrently on the workers, as soon as they are
+	// ready. Each task is timed, WriteDot draws the graph with the times and the critical path
+	class TaskGraph
+	{
+	public:
+		using TResources = uint32_t;
+
+		enum class Kind
+		{
+			Chunked,	// fn(threadIdx, from, to) over [0, count()), the chunks taken by any worker
+			Serial,		// fn() on one of the workers, its GridRuns done there in turn
+			Collective	// fn() on the calling thread, its GridRuns on all the workers
+		};
+
+	private:
+		struct Task
+		{
+			std::string Name;
+			Kind TaskKind;
+			TResources Reads;
+			TResources Writes;
+			int ChunkSize;
+			std::function<int()> Count;
+			std::function<void(int, int, int)> Run;
+			std::vector<int> Successors{};
+			int NumPredecessors{ 0 };
+			double Seconds{ 0.0 };	// from the first chunk taken to the last one done, summed over the runs
+			long Runs{ 0 };
+		};
+
+		struct alignas(64) TaskState
+		{
+			std::atomic<int> Pending{ 0 };
+			std::atomic<bool> Ready{ false };
+			std::atomic<bool> Done{ false };
+			std::atomic<int> NextChunk{ 0 };
+			std::atomic<int> ChunksLeft{ 0 };
+			int Count{ 0 };
+			int NumChunks{ 0 };
+			std::chrono::high_resolution_clock::time_point Start;
+		};
+
+		std::vector<Task> _tasks;
+		std::unique_ptr<TaskState[]> _states;
+		size_t _numStates{ 0 };
+
+		std::atomic<int> _numDone{ 0 };
+		std::atomic<int> _numInFlight{ 0 };	// ready tasks of the workers not done yet
+
+		static bool Conflict(const Task& first, const Task& second) noexcept
+		{
+			return (first.Writes & (second.Reads | second.Writes)) != 0 || (first.Reads & second.Writes) != 0;
+		}
+
+		void MakeReady(int taskIdx) noexcept
+		{
+			auto& task = _tasks[taskIdx];
+			auto& state = _states[taskIdx];
+
+			if (task.TaskKind == Kind::Collective)
+			{
+				state.Ready.store(true);
+				return;
+			}
+
+			state.Count = task.TaskKind == Kind::Serial ? 1 : task.Count();
+			state.NumChunks = task.TaskKind == Kind::Serial ? 1 : (state.Count + task.ChunkSize - 1) / task.ChunkSize;
+			state.NextChunk.store(0);
+			state.ChunksLeft.store(state.NumChunks);
+
+			_numInFlight.fetch_add(1);
+
+			if (state.NumChunks == 0)
+			{
+				state.Start = std::chrono::high_resolution_clock::now();
+				Finish(taskIdx);
+				return;
+			}
+
+			state.Ready.store(true, std::memory_order_release);
+		}
+
+		void Finish(int taskIdx) noexcept
+		{
+			auto& task = _tasks[taskIdx];
+			auto& state = _states[taskIdx];
+
+			task.Seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - state.Start).count();
+			++task.Runs;
+			state.Done.store(true);
+
+			// the successors first, so the workers do not see nothing in flight meanwhile
+			for (int successor : task.Successors)
+			{
+				if (_states[successor].Pending.fetch_sub(1) == 1)
+					MakeReady(successor);
+			}
+
+			if (task.TaskKind != Kind::Collective)
+				_numInFlight.fetch_sub(1);
+
+			_numDone.fetch_add(1);
+		}
+
+		// a worker's part of a wave: chunks of the ready tasks, the earliest added first,
+		// until none of its tasks is left in flight
+		void Work(int threadIdx) noexcept
+		{
+			while (_numInFlight.load() > 0)
+			{
+				bool found = false;
+
+				for (int taskIdx = 0; taskIdx < static_cast<int>(_tasks.size()) && !found; ++taskIdx)
+				{
+					auto& task = _tasks[taskIdx];
+					auto& state = _states[taskIdx];
+
+					if (task.TaskKind == Kind::Collective
+						|| !state.Ready.load(std::memory_order_acquire)
+						|| state.NextChunk.load() >= state.NumChunks)
+						continue;
+
+					int chunk = state.NextChunk.fetch_add(1);
+					if (chunk >= state.NumChunks)
+						continue;
+
+					if (chunk == 0)
+						state.Start = std::chrono::high_resolution_clock::now();
+
+					int from = chunk * task.ChunkSize;
+					task.Run(threadIdx, from, std::min(from + task.ChunkSize, state.Count));
+
+					if (state.ChunksLeft.fetch_sub(1) == 1)
+						Finish(taskIdx);
+
+					found = true;
+				}
+
+				if (!found)
+					std::this_thread::yield();
+			}
+		}
+
+		int Add(const char* name, Kind kind, TResources reads, TResources writes, int chunkSize,
+			std::function<int()> count, std::function<void(int, int, int)> run)
+		{
+			int taskIdx = static_cast<int>(_tasks.size());
+			_tasks.push_back(Task{ name, kind, reads, writes, chunkSize, std::move(count), std::move(run) });
+
+			for (int earlier = 0; earlier < taskIdx; ++earlier)
+			{
+				if (Conflict(_tasks[earlier], _tasks[taskIdx]))
+				{
+					_tasks[earlier].Successors.push_back(taskIdx);
+					++_tasks[taskIdx].NumPredecessors;
+				}
+			}
+
+			return taskIdx;
+		}
+
+	public:
+		bool Empty() const noexcept
+		{
+			return _tasks.empty();
+		}
+
+		int AddChunked(const char* name, TResources reads, TResources writes, int chunkSize,
+			std::function<int()> count, std::function<void(int, int, int)> fn)
+		{
+			return Add(name, Kind::Chunked, reads, writes, chunkSize, std::move(count), std::move(fn));
+		}
+
+		int AddSerial(const char* name, TResources reads, TResources writes, std::function<void()> fn)
+		{
+			return Add(name, Kind::Serial, reads, writes, 1, nullptr, [fn](int, int, int) { fn(); });
+		}
+
+		int AddCollective(const char* name, TResources reads, TResources writes, std::function<void()> fn)
+		{
+			return Add(name, Kind::Collective, reads, writes, 1, nullptr, [fn](int, int, int) { fn(); });
+		}
+
+		void Run(ThreadGrid& grid) noexcept
+		{
+			if (_numStates != _tasks.size())
+			{
+				_states = std::make_unique<TaskState[]>(_tasks.size());
+				_numStates = _tasks.size();
+			}
+
+			for (size_t taskIdx = 0; taskIdx < _tasks.size(); ++taskIdx)
+			{
+				_states[taskIdx].Pending.store(_tasks[taskIdx].NumPredecessors);
+				_states[taskIdx].Ready.store(false);
+				_states[taskIdx].Done.store(false);
+			}
+
+			_numDone.store(0);
+			_numInFlight.store(0);
+
+			for (int taskIdx = 0; taskIdx < static_cast<int>(_tasks.size()); ++taskIdx)
+			{
+				if (_tasks[taskIdx].NumPredecessors == 0)
+					MakeReady(taskIdx);
+			}
+
+			while (_numDone.load() < static_cast<int>(_tasks.size()))
+			{
+				// the collective ones in between the waves of the others, the workers being all theirs
+				bool collective = false;
+				for (int taskIdx = 0; taskIdx < static_cast<int>(_tasks.size()) && !collective; ++taskIdx)
+				{
+					auto& state = _states[taskIdx];
+					if (_tasks[taskIdx].TaskKind != Kind::Collective || !state.Ready.load() || state.Done.load())
+						continue;
+
+					state.Start = std::chrono::high_resolution_clock::now();
+					_tasks[taskIdx].Run(0, 0, 1);
+					Finish(taskIdx);
+					collective = true;
+				}
+
+				if (!collective && _numInFlight.load() > 0)
+					grid.GridRun([&](int threadIdx, int) { Work(threadIdx); });
+			}
+		}
+
+		void ResetTimes() noexcept
+		{
+			for (auto& task : _tasks)
+			{
+				task.Seconds = 0.0;
+				task.Runs = 0;
+			}
+		}
+
+		double MeanSeconds(int taskIdx) const noexcept
+		{
+			auto& task = _tasks[taskIdx];
+			return task.Runs > 0 ? task.Seconds / task.Runs : 0.0;
+		}
+
+		// all the tasks one after another
+		double SumSeconds() const noexcept
+		{
+			double sum = 0.0;
+			for (int taskIdx = 0; taskIdx < static_cast<int>(_tasks.size()); ++taskIdx)
+				sum += MeanSeconds(taskIdx);
+			return sum;
+		}
+
+		// The longest chain of dependent tasks by their mean times, first to last (the tasks
+		// are added in a topological order, the successors always come later)
+		std::vector<int> CriticalPath() const
+		{
+			int numTasks = static_cast<int>(_tasks.size());
+			std::vector<double> finish(numTasks, 0.0);
+			std::vector<int> previous(numTasks, -1);
+
+			for (int taskIdx = 0; taskIdx < numTasks; ++taskIdx)
+			{
+				finish[taskIdx] += MeanSeconds(taskIdx);
+				for (int successor : _tasks[taskIdx].Successors)
+				{
+					if (finish[taskIdx] > finish[successor])
+					{
+						finish[successor] = finish[taskIdx];
+						previous[successor] = taskIdx;
+					}
+				}
+			}
+
+			std::vector<int> path;
+			if (numTasks == 0)
+				return path;
+
+			for (int taskIdx = static_cast<int>(std::max_element(finish.begin(), finish.end()) - finish.begin());
+				taskIdx >= 0; taskIdx = previous[taskIdx])
+				path.push_back(taskIdx);
+
+			std::reverse(path.begin(), path.end());
+			return path;
+		}
+
+		double CriticalPathSeconds() const
+		{
+			double sum = 0.0;
+			for (int taskIdx : CriticalPath())
+				sum += MeanSeconds(taskIdx);
+			return sum;
+		}
+
+		// Graphviz: the tasks with what they read / write (resourceNames[bit]) and their mean
+		// times, the dependencies without the ones implied by others, the critical path in red
+		void WriteDot(std::ostream& out, const std::vector<std::string>& resourceNames) const
+		{
+			int numTasks = static_cast<int>(_tasks.size());
+
+			// reachable[a][b]: b depends on a, directly or not
+			std::vector<std::vector<bool>> reachable(numTasks, std::vector<bool>(numTasks, false));
+			for (int taskIdx = numTasks - 1; taskIdx >= 0; --taskIdx)
+			{
+				for (int successor : _tasks[taskIdx].Successors)
+				{
+					reachable[taskIdx][successor] = true;
+					for (int later = successor + 1; later < numTasks; ++later)
+					{
+						if (reachable[successor][later])
+							reachable[taskIdx][later] = true;
+					}
+				}
+			}
+
+			std::vector<int> path = CriticalPath();
+			std::vector<bool> critical(numTasks, false);
+			for (int taskIdx : path)
+				critical[taskIdx] = true;
+
+			auto names = [&](TResources resources)
+			{
+				std::string list;
+				for (size_t bit = 0; bit < resourceNames.size(); ++bit)
+				{
+					if (resources & (TResources{ 1 } << bit))
+						list += (list.empty() ? "" : ", ") + resourceNames[bit];
+				}
+				return list;
+			};
+
+			out << "digraph step {" << std::endl;
+			out << "  node [fontname=\"Helvetica\", fontsize=10];" << std::endl;
+
+			for (int taskIdx = 0; taskIdx < numTasks; ++taskIdx)
+			{
+				auto& task = _tasks[taskIdx];
+				out << "  t" << taskIdx << " [label=\"" << task.Name
+					<< "\\n" << std::fixed << std::setprecision(3) << MeanSeconds(taskIdx) * 1000.0 << " ms"
+					<< "\\nreads: " << names(task.Reads)
+					<< "\\nwrites: " << names(task.Writes) << "\""
+					<< (task.TaskKind == Kind::Collective ? ", shape=box" : task.TaskKind == Kind::Serial ? ", shape=ellipse" : ", shape=box, style=rounded")
+					<< (critical[taskIdx] ? ", color=red, penwidth=2" : "") << "];" << std::endl;
+			}
+
+			for (int taskIdx = 0; taskIdx < numTasks; ++taskIdx)
+			{
+				for (int successor : _tasks[taskIdx].Successors)
+				{
+					bool implied = std::any_of(_tasks[taskIdx].Successors.begin(), _tasks[taskIdx].Successors.end(),
+						[&](int other) { return other != successor && reachable[other][successor]; });
+					if (implied)
+						continue;
+
+					bool onPath = std::adjacent_find(path.begin(), path.end(),
+						[&](int a, int b) { return a == taskIdx && b == successor; }) != path.end();
+
+					out << "  t" << taskIdx << " -> t" << successor << (onPath ? " [color=red, penwidth=2]" : "") << ";" << std::endl;
+				}
+			}
+
+			out << "}" << std::endl;
+			out.unsetf(std::ios_base::floatfield);
+		}
+	};
+}
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <limits>
 #include <filesystem>
 #include <fstream>
 #include <chrono>
@@ -17,51 +18,44 @@
 
 #include "Cell.h"
 #include "Population.h"
+#include "NetworkBatchEvaluator.h"
+#include "SpatialGrid.h"
+#include "AngularEye.h"
+#include "PairTable.h"
+#include "NeighborLists.h"
+#include "FarFieldTree.h"
+#include "SensorCache.h"
+#include "SensingTiles.h"
+#include "SimulationKernels.h"
+#include "NetworkCloner.h"
+#include "TaskGraph.h"
 #include "../Utils.h"
 
 #include "WorldUtils.h"
 
 namespace Neurolution
 {
-	//template <typename WorldProp>
-    struct DirectionWithDistanceSquare //: public Orientation
-    {
-		float DirectionX;
-		float DirectionY;
-        float DistanceSquare;
-
-        void Set(float dx, float dy)  noexcept
-        {
-            DirectionX = dx;
-            DirectionY = dy;
-            DistanceSquare = dx * dx + dy * dy;
-        }
-    };
-
+	// A food in the foods' EntityStore
 	template <typename WorldProp>
-    struct Food : public MaterialPointWithEnergyValue
+    struct Food : public EntityRef
     {
-        Food()
-        {
-        }
-
-        Food(Random& rnd, int maxX, int maxY)
+        Food(EntityStore& store, int index) noexcept
+            : EntityRef(store, index)
         {
-            Reset(rnd, maxX, maxY);
         }
 
-        float Consume(float delta = 0.071f)  noexcept
+        float Consume(float delta = 0.071f) const noexcept
         {
             float ret = 0.0f;
 
-            while (EnergyValue > 0.001)
+            while (EnergyValue() > 0.001)
             {
-                float valueCopy = InterlockedCompareExchange(&EnergyValue, 0.0f, 0.0f);
+                float valueCopy = InterlockedCompareExchange(&EnergyValue(), 0.0f, 0.0f);
                 float newDelta = valueCopy < 0.5f ? valueCopy : 0.5f;
                 float newValue = valueCopy - newDelta;
 
                 // ReSharper disable once CompareOfFloatsByEqualityOperator
-                if (InterlockedCompareExchange(&EnergyValue, newValue, valueCopy) == valueCopy)
+                if (InterlockedCompareExchange(&EnergyValue(), newValue, valueCopy) == valueCopy)
                 {
                     ret = valueCopy - newValue;
                     break;
@@ -71,31 +65,21 @@ namespace Neurolution
             return ret;
         }
 
-        bool IsEmpty() const  noexcept { return EnergyValue < 0.00001; }
+        bool IsEmpty() const  noexcept { return EnergyValue() < 0.00001; }
 
-        void Reset(Random& rnd, int maxX, int maxY, bool valueOnly = false)  noexcept
+        void Reset(Random& rnd, int maxX, int maxY, bool valueOnly = false) const noexcept
         {
-			EnergyValue = WorldProp::FoodInitialValue;// * (0.5 + rnd.NextDouble());
+			EnergyValue() = WorldProp::FoodInitialValue;// * (0.5 + rnd.NextDouble());
 
             if (!valueOnly)
             {
-                LocationX = (float)rnd.Next(maxX);
-                LocationY = (float)rnd.Next(maxY);
+                LocationX() = (float)rnd.Next(maxX);
+                LocationY() = (float)rnd.Next(maxY);
 
-				VelocityX = (float)(rnd.NextDouble() * 2.5 - 1.25);
-				VelocityY = (float)(rnd.NextDouble() * 2.5 - 1.25);
+				VelocityX() = (float)(rnd.NextDouble() * 2.5 - 1.25);
+				VelocityY() = (float)(rnd.NextDouble() * 2.5 - 1.25);
             }
         }
-
-		void SaveTo(std::ostream& stream)
-		{
-			this->MaterialPointWithEnergyValue::SaveTo(stream);
-		}
-
-		void LoadFrom(std::istream& stream)
-		{
-			this->MaterialPointWithEnergyValue::LoadFrom(stream);
-		}
     };
 
 	template <typename WorldProp>
@@ -104,21 +88,46 @@ namespace Neurolution
 	public:
 		using TProp = WorldProp;
 		using TCell = Cell<WorldProp>;
+		using TCells = CellPopulation<TCell>;
+		using TCellRef = CellRef<TCell>;
 	private:
         static constexpr float SQRT_2 = 1.4142135623730950488016887242097f; // unfortunately std::sqrt is not a constexpr function
+        static constexpr int NetworkIterationsPerStep = 4; // each of NetworkStepsPerIteration
+
+        // ThreadGrid::ParallelFor chunks: small enough for the stealing to even out cells 
+        // that cost much more than others, big enough to keep the chunk taking cheap
+        static constexpr int BodiesPerChunk = 8;
+        static constexpr int CellsPerCollisionChunk = 64;
+        static constexpr int NetworksPerChunk = 4;
+        static constexpr int FoodsPerChunk = 256;
+
+        // eye values of the foods, prey and predators per tripod, padded up to whole vectors
+        static constexpr int PaddedTripods = SensorCache<WorldProp>::PaddedTripods;
+        using TEyeValues = typename SensorCache<WorldProp>::TValues;
 
         int _numWorkerThreads;
 
 
-		Population<std::shared_ptr<TCell>> _cells;
-		Population<std::shared_ptr<TCell>> _predators;
-        Population<Food<WorldProp>> _foods;
+		// cold records + hot state, the foods are hot state only
+		TCells _cells;
+		TCells _predators;
+        EntityStore _foods;
 		std::vector<std::pair<int, int>> _interGenerationCloneMapCells;
 		std::vector<std::pair<int, int>> _interGenerationCloneMapPredators;
 
-        std::vector<std::vector<DirectionWithDistanceSquare>> _cellDirections;
-        std::vector<std::vector<DirectionWithDistanceSquare>> _predatorDirections;
-        std::vector<std::vector<DirectionWithDistanceSquare>> _foodDirections;
+        // Pairs within sight, re-built each step before the sensing: bodies are prey [0, P) then 
+        // predators, foods are seen by prey only. Pairs within capture distance for the 
+        // collisions, re-built after the movement
+        PairTable _sightPairs;
+        PairTable _sightFoods;
+        PairTable _contactFoods;
+        PairTable _contactPredators;
+
+        // Only used with NeighborListSkin, the candidates of the tables above
+        NeighborLists _sightPairLists;
+        NeighborLists _sightFoodLists;
+        NeighborLists _contactFoodLists;
+        NeighborLists _contactPredatorLists;
 
         int _maxX;
         int _maxY;
@@ -133,61 +142,217 @@ namespace Neurolution
 
         ThreadGrid _grid;
 
+        NetworkBatchEvaluator<WorldProp> _batchEvaluator;
+
+        NetworkCloner<WorldProp> _cloner;
+        std::vector<TCell*> _newborns;
+
+        // Only used with UseSpatialGrid, re-built each step before the sensing, predators 
+        // once more after the movement for the collisions
+        SpatialGrid _foodGrid;
+        SpatialGrid _cellGrid;
+        SpatialGrid _predatorGrid;
+
+        // Only used with BlockedSensing, instead of the sight tables
+        SensingTiles<WorldProp> _sensingTiles;
+
+        // Only used with FarFieldOpeningAngle, instead of the sight tables: the trees of the 
+        // foods, prey and predators, and what each worker's current cell sees of them
+        std::array<FarFieldTree, 3> _farFieldTrees;
+        struct alignas(64) FarFieldSight
+        {
+            std::array<std::vector<DirectionWithDistanceSquare>, 3> Colors;
+        };
+        std::vector<FarFieldSight, cache_aligned<FarFieldSight>> _farFieldSight;
+
+        // Only used with SensorCacheTolerance, the eye values of the cells from the last step
+        SensorCache<WorldProp> _sensorCache;
+
+        // Only used with TaskGraphStep: the step's tasks, built on the first step, and the 
+        // step they are running
+        TaskGraph _stepGraph;
+        long _graphStep{ 0 };
+
+        // what the tasks of the step graph read and write
+        enum StepResource : TaskGraph::TResources
+        {
+            FoodsResource = 1u << 0,
+            PreyResource = 1u << 1,			// where the prey are and how they move
+            PreyEnergyResource = 1u << 2,
+            PredatorsResource = 1u << 3,
+            FoodGridResource = 1u << 4,
+            PreyGridResource = 1u << 5,
+            PredatorGridResource = 1u << 6,
+            BodySightResource = 1u << 7,
+            FoodSightResource = 1u << 8,
+            ActiveBodiesResource = 1u << 9,
+            PreyNetworksResource = 1u << 10,	// with the eye's state and the age
+            PredatorNetworksResource = 1u << 11,
+            FoodContactsResource = 1u << 12,
+            PredatorContactsResource = 1u << 13,
+            RandomResource = 1u << 14
+        };
+
+        // Only used with SkipDormantCells: the bodies (prey, then predators) with energy left, 
+        // collected at the start of each step
+        std::vector<int> _activeBodies;
+
+        // Only used with NumaAwarePlacement: the scheduled bodies by their home node, node k's
+        // from _nodeBounds[k], and the batched evaluator's networks the same way
+        std::vector<int> _nodeBodies;
+        std::vector<int> _nodeBounds;
+        std::vector<int> _nodeCursors;
+        std::vector<int> _networkBounds;
+
+        // Only used with AngularBinningEye
+        EyeResponseTables _eyeResponse;
+
+        // Only used with VectorizedSimulation: cells waiting for MoveCells, per worker
+        struct MovementQueue
+        {
+            MovementBatch Batch;
+            std::array<EntityStore*, MovementBatch::Size> States;
+            std::array<int, MovementBatch::Size> Indices;
+        };
+        std::vector<MovementQueue, cache_aligned<MovementQueue>> _movementQueues;
+
+        // a bit of slack over the exact visibility distance, the exact check is done anyway
+        float _visibilityQueryRadius{ 1.0f + std::sqrt(static_cast<float>(WorldProp::MaxDistanceSquareVisibility)) };
+
+        static_assert(WorldProp::NetworkBackend != NetworkEvaluationBackend::Batched || WorldProp::MemoizeWeightedInput,
+            "Batched network backend requires MemoizeWeightedInput");
+        static_assert(!WorldProp::BlockedSensing || (WorldProp::VectorizedSimulation && !WorldProp::AngularBinningEye),
+            "BlockedSensing requires VectorizedSimulation and the per-tripod eye");
+        static_assert(!WorldProp::BlockedSensing || !(WorldProp::FarFieldOpeningAngle > 0.0f),
+            "BlockedSensing and FarFieldOpeningAngle are two different eyes");
+        static_assert(!(WorldProp::SensorCacheTolerance > 0.0f) || (!WorldProp::BlockedSensing && !(WorldProp::FarFieldOpeningAngle > 0.0f)),
+            "SensorCacheTolerance requires the sight tables");
+        static_assert(!WorldProp::TaskGraphStep || (!WorldProp::BlockedSensing && !(WorldProp::FarFieldOpeningAngle > 0.0f)),
+            "TaskGraphStep requires the sight tables");
+        static_assert(!(WorldProp::TaskGraphStep && WorldProp::NumaAwarePlacement),
+            "NumaAwarePlacement does not go with TaskGraphStep");
+
 	public:
         World(const std::string& workingFolder,
             int nWorkerThreads,
             int numPreys, int maxFoods, int numPredators, int maxX, int maxY)
-            : _grid(nWorkerThreads)
+            : _grid(nWorkerThreads, WorldProp::PinWorkerThreads || WorldProp::NumaAwarePlacement)
             , _maxX(maxX)
             , _maxY(maxY)
             , _workingFolder(workingFolder)
             , _numWorkerThreads(nWorkerThreads)
-            , _cells(numPreys, true)
+            , _cells(numPreys)
 			, _interGenerationCloneMapCells(numPreys)
 			, _foods(maxFoods)
             , _foodsPerCycle(maxFoods)
-            , _predators(numPredators, true)
+            , _predators(numPredators)
 			, _interGenerationCloneMapPredators(numPredators)
-			, _cellDirections(nWorkerThreads)
-            , _foodDirections(nWorkerThreads)
-            , _predatorDirections(nWorkerThreads)
+            , _foodGrid(WorldProp::SpatialGridCellSize, maxX, maxY)
+            , _cellGrid(WorldProp::SpatialGridCellSize, maxX, maxY)
+            , _predatorGrid(WorldProp::SpatialGridCellSize, maxX, maxY)
+            , _sensingTiles(nWorkerThreads)
+            , _farFieldSight(nWorkerThreads)
+            , _sensorCache(nWorkerThreads, WorldProp::SensorCacheTolerance > 0.0f ? numPreys + numPredators : 0)
+            , _movementQueues(nWorkerThreads)
         {
             for (int i = 0; i < numPreys; ++i)
-                _cells[i] = std::make_shared<TCell>(_random, maxX, maxY, false);
+            {
+                _cells.Cells[i] = std::make_shared<TCell>(_random, false);
+                PlaceRandomly(_cells[i]);
+            }
 
             for (int i = 0; i < numPredators; ++i)
-                _predators[i] = std::make_shared<TCell>(_random, maxX, maxY, true);
-
-            for (int i = 0; i < _foodsPerCycle; ++i)
             {
-                _foods.Reanimate() = Food<WorldProp>(_random, maxX, maxY);
+                _predators.Cells[i] = std::make_shared<TCell>(_random, true);
+                PlaceRandomly(_predators[i]);
             }
 
-            for (int i = 0; i < _numWorkerThreads; ++i)
+            for (int i = 0; i < _foodsPerCycle; ++i)
             {
-                // Some in-efficiency here, yes
-                _cellDirections[i] = std::vector<DirectionWithDistanceSquare>(numPreys);
-                _foodDirections[i] = std::vector<DirectionWithDistanceSquare>(maxFoods);
-                _predatorDirections[i] = std::vector<DirectionWithDistanceSquare>(numPredators);
+                FoodAt(_foods.Reanimate()).Reset(_random, maxX, maxY);
             }
+
+            if constexpr (WorldProp::NumaAwarePlacement)
+                PlaceNetworks();
+
+            PrepareEyeResponse();
         }
 
 
-		Population<Food<WorldProp>>& GetFoods() noexcept
+		EntityStore& GetFoods() noexcept
 		{
 			return _foods;
 		}
 
-		Population<std::shared_ptr<TCell>> GetCells() noexcept
+		TCells& GetCells() noexcept
 		{
 			return _cells;	
 		}
 
-		Population<std::shared_ptr<TCell>> GetPredators() noexcept
+		TCells& GetPredators() noexcept
 		{
 			return _predators; 
 		}
 
+		// With NeighborListSkin: how often the lists of all the tables were rebuilt, and how 
+		// many candidate pairs they gave vs a brute force
+		NeighborLists::Stats GetNeighborListStats() const noexcept
+		{
+			NeighborLists::Stats stats;
+			for (auto* lists : { &_sightPairLists, &_sightFoodLists, &_contactFoodLists, &_contactPredatorLists })
+				stats += lists->GetStats();
+			return stats;
+		}
+
+		// With SensorCacheTolerance: how many of the eye's entries went through it again
+		typename SensorCache<WorldProp>::Stats GetSensorCacheStats() const noexcept
+		{
+			return _sensorCache.GetStats();
+		}
+
+		// Bodies that went through the network on the last step, all of them without SkipDormantCells
+		int GetNumActiveBodies() const noexcept
+		{
+			return NumScheduledBodies();
+		}
+
+		// How even the work of the ParallelFor phases was, since the start
+		const std::vector<ThreadGrid::PhaseStats>& GetPhaseStats() const noexcept
+		{
+			return _grid.GetPhaseStats();
+		}
+
+		// NumaAwarePlacement: the bytes of network weights each node has
+		std::vector<size_t> GetNodeWeightBytes()
+		{
+			std::vector<size_t> bytes(_grid.GetNumNodes(), 0);
+			for (int bodyIdx = 0; bodyIdx < static_cast<int>(_cells.size() + _predators.size()); ++bodyIdx)
+			{
+				TCellRef cell = BodyAt(bodyIdx);
+				bytes[cell->HomeNode] += cell->Network->Weights.size() * sizeof(float);
+			}
+			return bytes;
+		}
+
+		ThreadGrid& GetGrid() noexcept
+		{
+			return _grid;
+		}
+
+		// With TaskGraphStep: the step's tasks with their times, and drawn for Graphviz
+		TaskGraph& GetStepGraph() noexcept
+		{
+			return _stepGraph;
+		}
+
+		void WriteStepGraph(std::ostream& out) const
+		{
+			_stepGraph.WriteDot(out, {
+				"foods", "prey", "prey energy", "predators", "food grid", "prey grid", "predator grid",
+				"body sight", "food sight", "active bodies", "prey networks", "predator networks",
+				"food contacts", "predator contacts", "random" });
+		}
+
 		void SaveTo(std::ostream& stream)
 		{
 			stream.write(reinterpret_cast<const char*>(&_maxX), sizeof(_maxX));
@@ -195,9 +360,9 @@ namespace Neurolution
 			stream.write(reinterpret_cast<const char*>(&_foodsPerCycle), sizeof(_foodsPerCycle));
 			stream.write(reinterpret_cast<const char*>(&_nextFoodIdx), sizeof(_nextFoodIdx));
 
-			_cells.SaveTo(stream, [&](std::shared_ptr<TCell> & item, std::ostream & s) {item->SaveTo(s); });
-			_predators.SaveTo(stream, [&](std::shared_ptr<TCell> & item, std::ostream & s) {item->SaveTo(s); });
-			_foods.SaveTo(stream, [&](Food<WorldProp> & item, std::ostream & s) {item.SaveTo(s); });
+			_cells.SaveTo(stream);
+			_predators.SaveTo(stream);
+			_foods.SaveTo(stream, [&](int idx, std::ostream & s) {});
 		}
 
 		void LoadFrom(std::istream& stream)
@@ -207,17 +372,24 @@ namespace Neurolution
 			stream.read(reinterpret_cast<char*>(&_foodsPerCycle), sizeof(_foodsPerCycle));
 			stream.read(reinterpret_cast<char*>(&_nextFoodIdx), sizeof(_nextFoodIdx));
 
-			_cells.LoadFrom(stream, [&](std::shared_ptr<TCell> & item, std::istream & s) {item->LoadFrom(s); });
-			_predators.LoadFrom(stream, [&](std::shared_ptr<TCell> & item, std::istream & s) {item->LoadFrom(s); });
+			_cells.LoadFrom(stream);
+			_predators.LoadFrom(stream);
+
+			_foodGrid = SpatialGrid(WorldProp::SpatialGridCellSize, _maxX, _maxY);
+			_cellGrid = SpatialGrid(WorldProp::SpatialGridCellSize, _maxX, _maxY);
+			_predatorGrid = SpatialGrid(WorldProp::SpatialGridCellSize, _maxX, _maxY);
+
+			PrepareEyeResponse();
+			IndicesChanged(false);
             //_foods.KillAll([](auto& f) { return true; });
-			//_foods.LoadFrom(stream, [&](Food<WorldProp> & item, std::istream & s) {item.LoadFrom(s); });
+			//_foods.LoadFrom(stream, [&](int idx, std::istream & s) {});
 		}
 
 	private:
 
         int IterateBabyMaking(
 			long step, 
-			std::vector<std::shared_ptr<TCell>>& elements, 
+			TCells& elements, 
 			std::vector<std::pair<int, int>>& cloneMap,
 			float birthEnergyConsumption, 
 			float initialEnergy, 
@@ -231,10 +403,8 @@ namespace Neurolution
 
             int quant = static_cast<int>(elements.size() / 32);
 
-            std::sort(std::begin(elements), std::end(elements),
-                [](std::shared_ptr<TCell>& x, std::shared_ptr<TCell>& y) {
-                return x->EnergyValue > y->EnergyValue;
-            });
+            elements.SortByEnergy();
+            auto& energy = elements.State.EnergyValue;
 
             int srcIdx = 0;
             int dstIdx = static_cast<int>(elements.size() - 1); //quant * 4;
@@ -242,28 +412,25 @@ namespace Neurolution
 			int numChild = 0; 
 			while (srcIdx < dstIdx)
 			{
-				auto& src = elements[srcIdx];
-
-				if (src->EnergyValue < 0.01f)
+				if (energy[srcIdx] < 0.01f)
 				{
 					break;
 				}
 
-                auto& dst = elements[dstIdx];
-                if (dst->EnergyValue > birthEnergyConsumption && !isPredator)
+                if (energy[dstIdx] > birthEnergyConsumption && !isPredator)
                 {
                     // Dsts are too feed too -- finish with baby making for now, let someone starve a bit 
                     break; 
                 }
 
-				if (src->EnergyValue < birthEnergyConsumption)
+				if (energy[srcIdx] < birthEnergyConsumption)
 				{
 					++srcIdx;
 					continue;
 				}
 
 				//;
-				src->EnergyValue -= birthEnergyConsumption;
+				energy[srcIdx] -= birthEnergyConsumption;
 				auto& cm = cloneMap[nextCloneMapIdx++];
 				cm.first = srcIdx;
 				cm.second = dstIdx--;
@@ -275,9 +442,9 @@ namespace Neurolution
 			{
 				// a very special case: everyone is dead. 
 				// Re-initialize energy levels with default values, and hope for the best 
-				for (auto& el : elements)
+				for (auto& el : energy)
 				{
-					el->EnergyValue = initialEnergy;
+					el = initialEnergy;
 				}
 			}
 			else
@@ -285,10 +452,7 @@ namespace Neurolution
 				// fill dead bodies with clones of the top ones 
 				for (int idx = srcIdx + 1; idx < dstIdx; ++ idx)
 				{
-					auto& src = elements[0];
-					auto& dst = elements[idx];
-					
-					if (dst->EnergyValue > 0.01f)
+					if (energy[idx] > 0.01f)
 						continue;
 
 					auto& cm = cloneMap[nextCloneMapIdx++];
@@ -302,56 +466,23 @@ namespace Neurolution
 
 	public:
         void Iterate(long step)  noexcept
+        {
+            if constexpr (WorldProp::PersistentStepRegion)
+                _grid.Region([&]() { IterateStep(step); });
+            else
+                IterateStep(step);
+        }
+
+	private:
+        void IterateStep(long step)  noexcept
         {
             if (step == 0)
                 WorldInitialize();
 
-            for (int idx = 0; idx < _foods.AliveSize(); ++idx)
-                _foods[idx].Step(_maxX, _maxY, WorldProp::StepTimeDelta);
-
-            if ((step % (WorldProp::StepsPerGeneration / _foodsPerCycle)) == 0)
-            {
-                GiveOneFood();
-            }
-
-
-            _grid.GridRun(
-                [&](int idx, int n)
-            {
-                for (int cellIdx = idx; cellIdx < _cells.size(); cellIdx += n)
-                {
-					IterateEyeAndSensors(idx, step, _cells[cellIdx]);
-                }
-                for (int pIdx = idx; pIdx < _predators.size(); pIdx += n)
-                {
-					IterateEyeAndSensors(idx, step, _predators[pIdx]);
-                }
-            });
-
-            _grid.GridRun(
-                [&](int idx, int n)
-            {
-                for (int cellIdx = idx; cellIdx < _cells.size(); cellIdx += n)
-                {
-                    IterateCellThinkingAndMoving(idx, step, _cells[cellIdx]);
-                }
-                for (int pIdx = idx; pIdx < _predators.size(); pIdx += n)
-                {
-                    IterateCellThinkingAndMoving(idx, step, _predators[pIdx]);
-                }
-            });
-
-            _grid.GridRun(
-                [&](int idx, int n)
-            {
-                for (int cellIdx = idx; cellIdx < _cells.size(); cellIdx += n)
-                {
-                    IterateCellCollisions(idx, step, _cells[cellIdx]);
-                }
-            });
-
-            // Kill any empty foods 
-            _foods.KillAll([](Food<WorldProp>& f) { return f.EnergyValue < 0.001f; });
+            if constexpr (WorldProp::TaskGraphStep)
+                RunStepGraph(step);
+            else
+                IteratePhases(step);
 
 			if (step != 0 && step % WorldProp::StepsPerBirthCheck == 0)
 			{
@@ -367,243 +498,744 @@ namespace Neurolution
 					WorldProp::PredatorInitialValue, 
                     true);
 
-				_grid.GridRun(
-					[&](int idx, int n)
-					{
-						for (int i = idx; i < nmCells; i += n)
-						{
-							auto& p = _interGenerationCloneMapCells[i];
-							CreateChild(_cells[p.first], _cells[p.second], WorldProp::InitialCellEnergy);
-						}
-
-						for (int i = idx; i < nmPredators; i += n)
-						{
-							auto& p = _interGenerationCloneMapPredators[i];
-							CreateChild(_predators[p.first], _predators[p.second], WorldProp::PredatorInitialValue);
-						}
-					});
-
-				_grid.GridRun(
-					[&](int idx, int n)
-					{
-						for (int cellIdx = idx; cellIdx < _cells.size(); cellIdx += n)
-						{
-							auto& cell = _cells[cellIdx];
-							if (cell->Age > WorldProp::OldSince)
-								CreateChild(cell, cell, cell->EnergyValue);
-						}
-						for (int pIdx = idx; pIdx < _predators.size(); pIdx += n)
-						{
-							auto& cell = _predators[pIdx];
-							if (cell->Age > WorldProp::OldSince)
-								CreateChild(cell, cell, cell->EnergyValue);
-						}
-					});
-			}
-        }
-
-	private:
+				// Births are only queued here, the networks are all cloned by one parallel 
+				// run below, split by neuron rows
+				for (int i = 0; i < nmCells; ++i)
+				{
+					auto& p = _interGenerationCloneMapCells[i];
+					CreateChild(_cells[p.first], _cells[p.second], WorldProp::InitialCellEnergy);
+				}
 
-        void IterateEyeAndSensors(int threadIdx, long step, std::shared_ptr<TCell>& cell)  noexcept
-        {
-            if (cell->EnergyValue < 0.00001f)
-                return;
+				for (int i = 0; i < nmPredators; ++i)
+				{
+					auto& p = _interGenerationCloneMapPredators[i];
+					CreateChild(_predators[p.first], _predators[p.second], WorldProp::PredatorInitialValue);
+				}
 
-            auto& cellDirections = _cellDirections[threadIdx];
-            auto& foodDirections = _foodDirections[threadIdx];
-            auto& predatorDirections = _predatorDirections[threadIdx];
+				for (int idx = 0; idx < static_cast<int>(_cells.size()); ++idx)
+				{
+					auto cell = _cells[idx];
+					if (cell->Age > WorldProp::OldSince)
+						CreateChild(cell, cell, cell.EnergyValue());
+				}
 
-            cell->PrepareIteration();
+				for (int idx = 0; idx < static_cast<int>(_predators.size()); ++idx)
+				{
+					auto cell = _predators[idx];
+					if (cell->Age > WorldProp::OldSince)
+						CreateChild(cell, cell, cell.EnergyValue());
+				}
 
-            // Calculate light sensor values 
+				// the populations are sorted, all the indices change
+				IndicesChanged(false);
 
-			// a bit of evolution force -- don't let predators see prey's food, so they don't 
-			// cheat by waiting at the food points 
-			if (!cell->IsPredator)
-			{
-				for (int idx = 0; idx < _foods.AliveSize(); ++idx)
-				{
-					auto& item = _foods[idx];
+				_grid.ParallelFor("births", 0, _cloner.GetNumItems(), 1,
+					[&](int, int from, int to) { _cloner.RunItems(from, to); });
+				_cloner.Finish();
 
-					float dx = item.LocationX - cell->LocationX;
-					float dy = item.LocationY - cell->LocationY;
-					foodDirections[idx].Set(dx, dy);
-				}
+				for (auto newborn : _newborns)
+					newborn->Network->CleanOutputs();
+				_newborns.clear();
 			}
+        }
 
-            for (int idx = 0; idx < _predators.size(); ++idx)
+        // the scheduled bodies [from, to)
+        void IterateSensing(int threadIdx, long step, int from, int to)  noexcept
+        {
+            ForEachBody(from, to, [&](TCellRef cell, int bodyIdx)
             {
-				auto& item0 = _predators[idx + 0];
-				float dx0 = item0->LocationX - cell->LocationX;
-				float dy0 = item0->LocationY - cell->LocationY;
-				predatorDirections[idx + 0].Set(dx0, dy0);				
-            }
+                IterateEyeAndSensors(threadIdx, step, cell, bodyIdx);
+            });
+        }
 
-            for (int idx = 0; idx < _cells.size(); ++idx)
+        void IterateThinking(int threadIdx, long step, int from, int to)  noexcept
+        {
+            if constexpr (WorldProp::VectorizedSimulation)
+            {
+                auto& queue = _movementQueues[threadIdx];
+                ForEachBody(from, to, [&](TCellRef cell, int)
+                {
+                    QueueCellThinkingAndMoving(queue, step, cell);
+                });
+                MoveQueuedCells(queue);
+            }
+            else
             {
-                auto& item0 = _cells[idx + 0];
-				float dx0 = item0->LocationX - cell->LocationX;
-				float dy0 = item0->LocationY - cell->LocationY;
-                cellDirections[idx + 0].Set(dx0, dy0);
+                ForEachBody(from, to, [&](TCellRef cell, int)
+                {
+                    IterateCellThinkingAndMoving(step, cell);
+                });
             }
+        }
 
-            auto& eye = cell->GetEye();
-
-            for (unsigned int tripodIdx = 0;
-                tripodIdx < WorldProp::EyeSizeNumTripods;
-                ++tripodIdx)
+        // the step from the foods moving to the collisions, one phase after another
+        void IteratePhases(long step)  noexcept
+        {
+            if constexpr (WorldProp::PersistentStepRegion)
             {
+                // only a barrier in the region, worth splitting up
+                _grid.ParallelFor("foods", 0, static_cast<int>(_foods.AliveSize()), FoodsPerChunk,
+                    [&](int, int from, int to)
+                {
+                    for (int idx = from; idx < to; ++idx)
+                        FoodAt(idx).Step(_maxX, _maxY, WorldProp::StepTimeDelta);
+                });
+            }
+            else
+            {
+                for (int idx = 0; idx < static_cast<int>(_foods.AliveSize()); ++idx)
+                    FoodAt(idx).Step(_maxX, _maxY, WorldProp::StepTimeDelta);
+            }
 
-                auto& redCell = eye[3 * tripodIdx];
-                auto& greenCell = eye[3 * tripodIdx + 1];
-                auto& blueCell = eye[3 * tripodIdx + 2];
-                // 
-                float viewDirection = cell->Rotation + redCell.Direction;
-
-                float viewDirectionX = (float)std::cos(viewDirection);
-                float viewDirectionY = (float)std::sin(viewDirection);
+            if ((step % (WorldProp::StepsPerGeneration / _foodsPerCycle)) == 0)
+            {
+                GiveOneFood();
+            }
 
-                // RED 
-                if (!cell->IsPredator)  // same as above about predators seeing prey's foods 
-				{
-                    float value = 0.0f;
+            if constexpr (WorldProp::UseSpatialGrid)
+            {
+                RebuildFoodGrid();
+                RebuildCellGrid(_cellGrid, _cells);
+                RebuildCellGrid(_predatorGrid, _predators);
+            }
 
-                    // This cell can see foods only
-                    for (unsigned int idx = 0; idx < _foods.AliveSize(); ++idx)
-                    {
-                        auto& foodItem = _foods[idx];
-                        if (foodItem.EnergyValue < 0.01f)
-                            continue;
+            if constexpr (WorldProp::BlockedSensing)
+                PrepareSensingTiles();
+            else if constexpr (WorldProp::FarFieldOpeningAngle > 0.0f)
+                BuildFarFieldTrees();
+            else
+                BuildSightTables();
 
-                        auto& food = foodDirections[idx];
+            if constexpr (WorldProp::SkipDormantCells)
+                CollectActiveBodies();
 
-						if (food.DistanceSquare > WorldProp::MaxDistanceSquareVisibility)
-							continue;
+            if constexpr (WorldProp::NumaAwarePlacement)
+                ScheduleByNode();
 
-                        float modulo = viewDirectionX * food.DirectionX + viewDirectionY * food.DirectionY;
+            if constexpr (WorldProp::BlockedSensing)
+            {
+                _grid.GridRun(
+                    [&](int idx, int n)
+                {
+                    IterateSensingTiles(idx, n, step);
+                });
+            }
+            else
+            {
+                ParallelForBodies("sensing", [&](int threadIdx, int from, int to)
+                {
+                    IterateSensing(threadIdx, step, from, to);
+                });
+            }
 
-                        if (modulo <= 0.0)
-                            continue;
+            if constexpr (WorldProp::NetworkBackend == NetworkEvaluationBackend::Batched && WorldProp::NumaAwarePlacement)
+            {
+                EvaluateNetworksByNode();
+            }
+            else if constexpr (WorldProp::NetworkBackend == NetworkEvaluationBackend::Batched)
+            {
+                _batchEvaluator.Add(_cells.Cells);
+                _batchEvaluator.Add(_predators.Cells);
 
-                        float invSqrRoot = Q_rsqrt(food.DistanceSquare);
+                _grid.GridRun(
+                    [&](int idx, int n)
+                {
+                    _batchEvaluator.Run(idx, n);
+                });
 
-                        float cosine = modulo * invSqrRoot;
+                _batchEvaluator.Finish();
+            }
 
-                        //float distnaceSquare = (float) std::pow(food.Distance, 2.0);
+            ParallelForBodies("thinking", [&](int threadIdx, int from, int to)
+            {
+                IterateThinking(threadIdx, step, from, to);
+            });
 
-                        float signalLevel =
-                            (float)(foodItem.EnergyValue * std::pow(cosine, redCell.Width)
-                                * invSqrRoot * invSqrRoot);
+            if constexpr (WorldProp::UseSpatialGrid)
+                RebuildCellGrid(_predatorGrid, _predators);
 
-                        value += signalLevel;
-                    }
-                    cell->Network->InputVector[3 * tripodIdx] = 20000 * value;
-                }
+            BuildContactTables();
 
-                // GREEN 
+            _grid.ParallelFor("collisions", 0, static_cast<int>(_cells.size()), CellsPerCollisionChunk,
+                [&](int threadIdx, int from, int to)
+            {
+                for (int cellIdx = from; cellIdx < to; ++cellIdx)
                 {
-                    float value = 0.0f;
-
-                    // this cell can see predators only
-                    for (unsigned int idx = 0; idx < cellDirections.size(); ++idx)
-                    {
-                        auto& cellDirection = cellDirections[idx];
-                        auto& cellItem = _cells[idx];
+                    IterateCellCollisions(threadIdx, step, _cells[cellIdx]);
+                }
+            });
 
-                        if (cellItem->EnergyValue < 0.01f)
-                            continue;
+            // Kill any empty foods 
+            size_t numFoods = _foods.AliveSize();
+            _foods.KillAll([&](int idx) { return _foods.EnergyValue[idx] < 0.001f; });
+            if (_foods.AliveSize() != numFoods)
+                IndicesChanged(true); // the survivors are moved around
+        }
 
-						if (cellDirection.DistanceSquare > WorldProp::MaxDistanceSquareVisibility)
-							continue;
+        // the same step as a TaskGraph, built on the first one
+        void RunStepGraph(long step)  noexcept
+        {
+            if (_stepGraph.Empty())
+                BuildStepGraph();
 
-                        if (cellItem == cell)
-                            continue;
+            _graphStep = step;
+            _stepGraph.Run(_grid);
+        }
 
-                        float modulo = viewDirectionX * cellDirection.DirectionX + viewDirectionY * cellDirection.DirectionY;
+        void BuildStepGraph()
+        {
+            auto& graph = _stepGraph;
 
-                        if (modulo <= 0.0)
-                            continue;
+            graph.AddChunked("move foods", 0, FoodsResource, FoodsPerChunk,
+                [this]() { return static_cast<int>(_foods.AliveSize()); },
+                [this](int, int from, int to)
+            {
+                for (int idx = from; idx < to; ++idx)
+                    FoodAt(idx).Step(_maxX, _maxY, WorldProp::StepTimeDelta);
+            });
 
-                        float invSqrRoot = Q_rsqrt(cellDirection.DistanceSquare);
+            graph.AddSerial("give food", FoodsResource | RandomResource, FoodsResource | RandomResource, [this]()
+            {
+                if ((_graphStep % (WorldProp::StepsPerGeneration / _foodsPerCycle)) == 0)
+                    GiveOneFood();
+            });
 
-                        float cosine = modulo * invSqrRoot;
+            if constexpr (WorldProp::UseSpatialGrid)
+            {
+                graph.AddCollective("food grid", FoodsResource, FoodGridResource, [this]() { RebuildFoodGrid(); });
+                graph.AddCollective("prey grid", PreyResource, PreyGridResource, [this]() { RebuildCellGrid(_cellGrid, _cells); });
+                graph.AddCollective("predator grid", PredatorsResource, PredatorGridResource, [this]() { RebuildCellGrid(_predatorGrid, _predators); });
+            }
 
-                        // float distnaceSquare = (float)std::pow(predator.Distance, 2.0);
+            graph.AddCollective("body sight", 
+                PreyResource | PreyEnergyResource | PredatorsResource | PreyGridResource | PredatorGridResource, BodySightResource, 
+                [this]() { BuildBodySightTable(); });
+            graph.AddCollective("food sight", PreyResource | FoodsResource | FoodGridResource, FoodSightResource, 
+                [this]() { BuildFoodSightTable(); });
 
-                        float signalLevel =
-                            (float)(WorldProp::InitialCellEnergy * std::pow(cosine, greenCell.Width)
-                                * invSqrRoot * invSqrRoot);
+            // the age of the dormant ones goes with their networks
+            if constexpr (WorldProp::SkipDormantCells)
+            {
+                graph.AddSerial("active bodies", PreyEnergyResource | PredatorsResource, 
+                    ActiveBodiesResource | PreyNetworksResource | PredatorNetworksResource, 
+                    [this]() { CollectActiveBodies(); });
+            }
 
-                        value += signalLevel;
-                    }
+            graph.AddChunked("prey sensing", 
+                PreyResource | PreyEnergyResource | BodySightResource | FoodSightResource | ActiveBodiesResource, PreyNetworksResource, 
+                BodiesPerChunk,
+                [this]() { return NumScheduledPrey(); },
+                [this](int threadIdx, int from, int to) { IterateSensing(threadIdx, _graphStep, from, to); });
+            graph.AddChunked("predator sensing", 
+                PredatorsResource | BodySightResource | ActiveBodiesResource, PredatorNetworksResource, 
+                BodiesPerChunk,
+                [this]() { return NumScheduledBodies() - NumScheduledPrey(); },
+                [this](int threadIdx, int from, int to)
+            {
+                int first = NumScheduledPrey();
+                IterateSensing(threadIdx, _graphStep, first + from, first + to);
+            });
 
-                    cell->Network->InputVector[3 * tripodIdx + 1] = 20000 * value;
-                }
+            if constexpr (WorldProp::NetworkBackend == NetworkEvaluationBackend::Batched)
+            {
+                graph.AddCollective("prey networks", PreyNetworksResource, PreyNetworksResource, [this]() { EvaluateNetworks(_cells); });
+                graph.AddCollective("predator networks", PredatorNetworksResource, PredatorNetworksResource, [this]() { EvaluateNetworks(_predators); });
+            }
 
-                // BLUE
-                {
-                    float value = 0.0f;
+            graph.AddChunked("prey thinking", 
+                ActiveBodiesResource, PreyResource | PreyEnergyResource | PreyNetworksResource, 
+                BodiesPerChunk,
+                [this]() { return NumScheduledPrey(); },
+                [this](int threadIdx, int from, int to) { IterateThinking(threadIdx, _graphStep, from, to); });
+            graph.AddChunked("predator thinking", 
+                ActiveBodiesResource, PredatorsResource | PredatorNetworksResource, 
+                BodiesPerChunk,
+                [this]() { return NumScheduledBodies() - NumScheduledPrey(); },
+                [this](int threadIdx, int from, int to)
+            {
+                int first = NumScheduledPrey();
+                IterateThinking(threadIdx, _graphStep, first + from, first + to);
+            });
 
-                    // this cell can see predators only
-                    for (unsigned int idx = 0; idx < predatorDirections.size(); ++idx)
-                    {
-                        auto& predator = predatorDirections[idx];
-                        auto& predatorItem = _predators[idx];
+            if constexpr (WorldProp::UseSpatialGrid)
+            {
+                graph.AddCollective("predator grid (moved)", PredatorsResource, PredatorGridResource, 
+                    [this]() { RebuildCellGrid(_predatorGrid, _predators); });
+            }
 
-						if (predator.DistanceSquare > WorldProp::MaxDistanceSquareVisibility)
-							continue;
+            graph.AddCollective("food contacts", PreyResource | FoodsResource | FoodGridResource, FoodContactsResource, 
+                [this]() { BuildFoodContactTable(); });
+            graph.AddCollective("predator contacts", PreyResource | PredatorsResource | PredatorGridResource, PredatorContactsResource, 
+                [this]() { BuildPredatorContactTable(); });
 
-                        if (predatorItem->EnergyValue < 0.01f)
-                            continue;
+            graph.AddChunked("prey eating", 
+                PreyResource | FoodContactsResource, PreyEnergyResource | FoodsResource | RandomResource, 
+                CellsPerCollisionChunk,
+                [this]() { return static_cast<int>(_cells.size()); },
+                [this](int, int from, int to)
+            {
+                for (int cellIdx = from; cellIdx < to; ++cellIdx)
+                    IterateFoodCollisions(_cells[cellIdx]);
+            });
+            graph.AddChunked("prey hunted", 
+                PreyResource | PredatorContactsResource, PreyEnergyResource | PredatorsResource | RandomResource, 
+                CellsPerCollisionChunk,
+                [this]() { return static_cast<int>(_cells.size()); },
+                [this](int, int from, int to)
+            {
+                for (int cellIdx = from; cellIdx < to; ++cellIdx)
+                    IteratePredatorCollisions(_cells[cellIdx]);
+            });
 
-                        if (predatorItem == cell)
-                            continue;
+            // the sensor cache is dropped along with the foods' indices
+            graph.AddSerial("kill foods", FoodsResource, 
+                FoodsResource | FoodSightResource | FoodContactsResource | PreyNetworksResource | PredatorNetworksResource, 
+                [this]()
+            {
+                size_t numFoods = _foods.AliveSize();
+                _foods.KillAll([&](int idx) { return _foods.EnergyValue[idx] < 0.001f; });
+                if (_foods.AliveSize() != numFoods)
+                    IndicesChanged(true);
+            });
+        }
 
-                        float modulo = viewDirectionX * predator.DirectionX + viewDirectionY * predator.DirectionY;
+        // Batched: the networks of one population, all the workers on them
+        void EvaluateNetworks(TCells& cells)
+        {
+            _batchEvaluator.Add(cells.Cells);
 
-                        if (modulo <= 0.0)
-                            continue;
+            _grid.GridRun(
+                [&](int idx, int n)
+            {
+                _batchEvaluator.Run(idx, n);
+            });
 
-                        float invSqrRoot = Q_rsqrt(predator.DistanceSquare);
+            _batchEvaluator.Finish();
+        }
 
-                        float cosine = modulo * invSqrRoot;
+	private:
 
-                        // float distnaceSquare = (float)std::pow(predator.Distance, 2.0);
+        void IterateEyeAndSensors(int threadIdx, long step, TCellRef cell, int bodyIdx)  noexcept
+        {
+            if (cell.EnergyValue() < 0.00001f)
+                return;
 
-                        float signalLevel =
-                            (float)(WorldProp::PredatorInitialValue * std::pow(cosine, blueCell.Width)
-                                * invSqrRoot * invSqrRoot);
+            cell->PrepareIteration();
 
-                        value += signalLevel;
-                    }
-                    cell->Network->InputVector[3 * tripodIdx + 2] = 20000 * value;
-                }
-            }
+            if constexpr (!WorldProp::BlockedSensing)
+                IterateEye(threadIdx, step, cell, bodyIdx);
 
-			cell->Network->InputVector[WorldProp::CurrentEnergyLevelSensor] = cell->EnergyValue;
-			cell->Network->InputVector[WorldProp::OrientationXSensor] = std::cosf(cell->Rotation);
-			cell->Network->InputVector[WorldProp::OrientationYSensor] = std::sinf(cell->Rotation);
-			cell->Network->InputVector[WorldProp::AbsoluteVelocitySensor] =
-				std::sqrtf(cell->VelocityX * cell->VelocityX + cell->VelocityY * cell->VelocityY);
+			cell->Network->InputVector[WorldProp::CurrentEnergyLevelSensor] = cell.EnergyValue();
+			if constexpr (WorldProp::VectorizedSimulation)
+			{
+				VectorMath::SinCos(cell.Rotation(),
+					cell->Network->InputVector[WorldProp::OrientationYSensor],
+					cell->Network->InputVector[WorldProp::OrientationXSensor]);
+				cell->Network->InputVector[WorldProp::AbsoluteVelocitySensor] =
+					VectorMath::Sqrt(cell.VelocityX() * cell.VelocityX() + cell.VelocityY() * cell.VelocityY());
+			}
+			else
+			{
+				cell->Network->InputVector[WorldProp::OrientationXSensor] = std::cosf(cell.Rotation());
+				cell->Network->InputVector[WorldProp::OrientationYSensor] = std::sinf(cell.Rotation());
+				cell->Network->InputVector[WorldProp::AbsoluteVelocitySensor] =
+					std::sqrtf(cell.VelocityX() * cell.VelocityX() + cell.VelocityY() * cell.VelocityY());
+			}
 		}
 
-        void IterateCellThinkingAndMoving(int threadIdx, long step, std::shared_ptr<TCell>& cell) noexcept
+        void IterateEye(int threadIdx, long step, TCellRef cell, int bodyIdx)  noexcept
         {
-            float forceLeft = 0.0f;
-            float forceRight = 0.0f;
+            // Everything within visibility is in the sight tables, in index order, or in the 
+            // far field trees' output; the eye tripods below only go over these
+            std::array<PairRow, 3> rows{}; // foods, prey, predators
 
-            for (int nIter = 0; nIter < 4; ++nIter)
+            if constexpr (WorldProp::FarFieldOpeningAngle > 0.0f)
             {
-                // Iterate network finally
-                cell->IterateNetwork(step * 4 + nIter);
-
-                // Execute action - what is ordered by the neuron network
-                forceLeft += cell->MoveForceLeft / 4.0f;
-                forceRight += cell->MoveForceRight / 4.0f;
+                CollectFarField(threadIdx, cell, bodyIdx, rows[0], rows[1], rows[2]);
+            }
+            else
+            {
+                int numPrey = static_cast<int>(_cells.size());
+                PairRow bodies = _sightPairs.Row(bodyIdx);
+                rows[1] = bodies.Slice(0, numPrey);
+                rows[2] = bodies.Slice(numPrey, numPrey + static_cast<int>(_predators.size()));
+
+                // a bit of evolution force -- don't let predators see prey's food, so they don't 
+                // cheat by waiting at the food points 
+                if (!cell->IsPredator)
+                    rows[0] = _sightFoods.Row(bodyIdx);
             }
 
-            float forwardForce = ((forceLeft + forceRight) / SQRT_2);
-            float rotationForce = (forceLeft - forceRight) / SQRT_2;
+            if constexpr (WorldProp::SensorCacheTolerance > 0.0f)
+            {
+                auto& values = _sensorCache.Update(threadIdx, step, bodyIdx, cell.Rotation(), cell->GetEye().data(), rows,
+                    [&](float rotation, const std::array<PairRow, 3>& lists, TEyeValues& out)
+                {
+                    AddEyeLight(cell, rotation, lists, out);
+                });
+
+                WriteEyeInputs(cell, values);
+            }
+            else
+            {
+                alignas(64) TEyeValues values = {};
+                AddEyeLight(cell, cell.Rotation(), rows, values);
+                WriteEyeInputs(cell, values);
+            }
+        }
+
+        // Adds the light of the foods, prey and predators in rows to the eye values of the cell 
+        // turned to rotation
+        void AddEyeLight(TCellRef cell, float rotation, const std::array<PairRow, 3>& rows, TEyeValues& values)  noexcept
+        {
+            auto& eye = cell->GetEye();
+
+            if constexpr (WorldProp::AngularBinningEye)
+            {
+                using TEye = AngularEye<WorldProp>;
+
+                if (!cell->IsPredator)
+                    TEye::Scatter(_eyeResponse, eye, 0, rotation, rows[0], values[0]);
+                TEye::Scatter(_eyeResponse, eye, 1, rotation, rows[1], values[1]);
+                TEye::Scatter(_eyeResponse, eye, 2, rotation, rows[2], values[2]);
+            }
+            else if constexpr (WorldProp::VectorizedSimulation)
+            {
+                // tripods padded up to whole vectors, looking nowhere, so they never see anything
+                constexpr int numTripods = WorldProp::EyeSizeNumTripods;
+                constexpr int padded = PaddedTripods;
+
+                auto& kernels = SimulationKernels<WorldProp>::Get();
+
+                alignas(64) float angles[padded];
+                alignas(64) float viewX[padded];
+                alignas(64) float viewY[padded];
+                alignas(64) float widths[3][padded];
+
+                for (int t = 0; t < padded; ++t)
+                {
+                    angles[t] = t < numTripods ? rotation + eye[3 * t].Direction : 0.0f;
+                    for (int color = 0; color < 3; ++color)
+                        widths[color][t] = t < numTripods ? eye[3 * t + color].Width : 1.0f;
+                }
+
+                kernels.SinCos(angles, viewY, viewX, padded);
+
+                for (int t = numTripods; t < padded; ++t)
+                    viewX[t] = viewY[t] = 0.0f;
+
+                for (int color = 0; color < 3; ++color)
+                {
+                    if (color == 0 && cell->IsPredator)
+                        continue;
+                    kernels.EyeSignals(viewX, viewY, widths[color], padded, rows[color].data(), rows[color].size(), values[color]);
+                }
+            }
+            else
+            {
+                for (unsigned int tripodIdx = 0;
+                    tripodIdx < WorldProp::EyeSizeNumTripods;
+                    ++tripodIdx)
+                {
+
+                    auto& redCell = eye[3 * tripodIdx];
+                    auto& greenCell = eye[3 * tripodIdx + 1];
+                    auto& blueCell = eye[3 * tripodIdx + 2];
+                    // 
+                    float viewDirection = rotation + redCell.Direction;
+
+                    float viewDirectionX = (float)std::cos(viewDirection);
+                    float viewDirectionY = (float)std::sin(viewDirection);
+
+                    // RED: foods only
+                    if (!cell->IsPredator)  // same as above about predators seeing prey's foods 
+                        values[0][tripodIdx] += EyeSignal(rows[0], viewDirectionX, viewDirectionY, redCell.Width);
+
+                    // GREEN: prey only
+                    values[1][tripodIdx] += EyeSignal(rows[1], viewDirectionX, viewDirectionY, greenCell.Width);
+
+                    // BLUE: predators only
+                    values[2][tripodIdx] += EyeSignal(rows[2], viewDirectionX, viewDirectionY, blueCell.Width);
+                }
+            }
+        }
+
+        void WriteEyeInputs(TCellRef cell, const TEyeValues& values)  noexcept
+        {
+            for (int tripodIdx = 0; tripodIdx < WorldProp::EyeSizeNumTripods; ++tripodIdx)
+            {
+                if (!cell->IsPredator)
+                    cell->Network->InputVector[3 * tripodIdx] = 20000 * values[0][tripodIdx];
+                cell->Network->InputVector[3 * tripodIdx + 1] = 20000 * values[1][tripodIdx];
+                cell->Network->InputVector[3 * tripodIdx + 2] = 20000 * values[2][tripodIdx];
+            }
+        }
+
+        // BlockedSensing: body sensors one cell at a time as usual, the eyes by tiles of 
+        // SensingTiles::ObserverTile cells, the tiles split between the workers
+        void IterateSensingTiles(int threadIdx, int numThreads, long step) noexcept
+        {
+            using TTiles = SensingTiles<WorldProp>;
+
+            int numPrey = static_cast<int>(_cells.size());
+            int numBodies = numPrey + static_cast<int>(_predators.size());
+
+            typename TTiles::Observer observers[TTiles::ObserverTile];
+
+            for (int from = threadIdx * TTiles::ObserverTile; from < numBodies; from += numThreads * TTiles::ObserverTile)
+            {
+                int numObservers = 0;
+
+                for (int bodyIdx = from; bodyIdx < std::min(numBodies, from + TTiles::ObserverTile); ++bodyIdx)
+                {
+                    bool isPrey = bodyIdx < numPrey;
+                    TCellRef cell = isPrey ? _cells[bodyIdx] : _predators[bodyIdx - numPrey];
+
+                    IterateEyeAndSensors(threadIdx, step, cell, bodyIdx);
+                    if (cell.EnergyValue() < 0.00001f)
+                        continue;
+
+                    observers[numObservers++] = {
+                        cell.LocationX(), cell.LocationY(), cell.Rotation(),
+                        cell->GetEye().data(),
+                        isPrey ? _sensingTiles.ObjectIndex(1, bodyIdx) : _sensingTiles.ObjectIndex(2, bodyIdx - numPrey),
+                        !cell->IsPredator,
+                        cell->Network->InputVector.data() };
+                }
+
+                _sensingTiles.Sense(threadIdx, observers, numObservers);
+            }
+        }
+
+        void PrepareSensingTiles()
+        {
+            _sensingTiles.Prepare(
+                { static_cast<int>(_foods.AliveSize()), static_cast<int>(_cells.size()), static_cast<int>(_predators.size()) },
+                _maxX, _maxY,
+                [&](int color, int idx, float& x, float& y, float& brightness)
+            {
+                auto& state = color == 0 ? _foods : (color == 1 ? _cells.State : _predators.State);
+                if (state.EnergyValue[idx] < 0.01f)
+                    return false;
+
+                x = state.LocationX[idx];
+                y = state.LocationY[idx];
+                brightness = color == 0 ? state.EnergyValue[idx] :
+                    (color == 1 ? WorldProp::InitialCellEnergy : WorldProp::PredatorInitialValue);
+                return true;
+            });
+        }
+
+        // FarFieldOpeningAngle: the trees of the three colors, built in parallel, with the 
+        // objects as PrepareSensingTiles has them
+        void BuildFarFieldTrees()
+        {
+            _grid.GridRun([&](int idx, int n)
+            {
+                for (int color = idx; color < 3; color += n)
+                {
+                    auto& state = color == 0 ? _foods : (color == 1 ? _cells.State : _predators.State);
+                    int count = color == 0 ? static_cast<int>(_foods.AliveSize()) :
+                        static_cast<int>(color == 1 ? _cells.size() : _predators.size());
+
+                    _farFieldTrees[color].Build(count, [&](int i, float& x, float& y, float& energy)
+                    {
+                        if (state.EnergyValue[i] < 0.01f)
+                            return false;
+
+                        x = state.LocationX[i];
+                        y = state.LocationY[i];
+                        energy = color == 0 ? state.EnergyValue[i] :
+                            (color == 1 ? WorldProp::InitialCellEnergy : WorldProp::PredatorInitialValue);
+                        return true;
+                    });
+                }
+            });
+        }
+
+        // What the cell sees of each tree, in the worker's FarFieldSight; predators don't see 
+        // the foods, as with the sight tables
+        void CollectFarField(int threadIdx, TCellRef cell, int bodyIdx, PairRow& foods, PairRow& prey, PairRow& predators)
+        {
+            constexpr float radiusSquare = static_cast<float>(WorldProp::MaxDistanceSquareVisibility);
+            constexpr float noWrap = std::numeric_limits<float>::max();
+
+            int numPrey = static_cast<int>(_cells.size());
+            float halfWidth = WorldProp::WrapAroundDistances ? 0.5f * _maxX : noWrap;
+            float halfHeight = WorldProp::WrapAroundDistances ? 0.5f * _maxY : noWrap;
+
+            auto displacement = [&](float& dx, float& dy)
+            {
+                dx = Displacement(dx, _maxX);
+                dy = Displacement(dy, _maxY);
+            };
+
+            auto& sight = _farFieldSight[threadIdx];
+            std::array<PairRow*, 3> rows{ &foods, &prey, &predators };
+
+            for (int color = 0; color < 3; ++color)
+            {
+                auto& seen = sight.Colors[color];
+                seen.clear();
+
+                if (color == 0 && cell->IsPredator)
+                    continue;
+
+                int self = -1;
+                if (color == 1 && bodyIdx < numPrey)
+                    self = bodyIdx;
+                else if (color == 2 && bodyIdx >= numPrey)
+                    self = bodyIdx - numPrey;
+
+                _farFieldTrees[color].Collect(cell.LocationX(), cell.LocationY(), self, WorldProp::FarFieldOpeningAngle,
+                    radiusSquare, halfWidth, halfHeight, displacement, seen);
+
+                *rows[color] = { seen.data(), nullptr, static_cast<int>(seen.size()) };
+            }
+        }
+
+        // Raw displacement, or the shortest one across the borders with WrapAroundDistances
+        float Displacement(float d, int size) const noexcept
+        {
+            if constexpr (WorldProp::WrapAroundDistances)
+            {
+                if (d > 0.5f * size)
+                    return d - size;
+                if (d < -0.5f * size)
+                    return d + size;
+            }
+            return d;
+        }
+
+        static float EyeSignal(
+            PairRow directions, 
+            float viewDirectionX, 
+            float viewDirectionY, 
+            float width) noexcept
+        {
+            float value = 0.0f;
+
+            for (auto& item : directions)
+            {
+                float modulo = viewDirectionX * item.DirectionX + viewDirectionY * item.DirectionY;
+
+                if (modulo <= 0.0)
+                    continue;
+
+                float invSqrRoot = Q_rsqrt(item.DistanceSquare);
+
+                float cosine = modulo * invSqrRoot;
+
+                float signalLevel =
+                    (float)(item.Energy * std::pow(cosine, width)
+                        * invSqrRoot * invSqrRoot);
+
+                value += signalLevel;
+            }
+
+            return value;
+        }
+
+        void PrepareEyeResponse()
+        {
+            if constexpr (WorldProp::AngularBinningEye)
+            {
+                for (auto& cell : _cells.Cells)
+                    _eyeResponse.Prepare(cell->GetEye());
+                for (auto& cell : _predators.Cells)
+                    _eyeResponse.Prepare(cell->GetEye());
+            }
+        }
+
+        void RebuildFoodGrid()
+        {
+            _foodGrid.Rebuild(_grid, _foods.AliveSize(), [&](int idx, float& x, float& y)
+            {
+                x = _foods.LocationX[idx];
+                y = _foods.LocationY[idx];
+            });
+        }
+
+        void RebuildCellGrid(SpatialGrid& grid, TCells& cells)
+        {
+            grid.Rebuild(_grid, static_cast<int>(cells.size()), [&](int idx, float& x, float& y)
+            {
+                x = cells.State.LocationX[idx];
+                y = cells.State.LocationY[idx];
+            });
+        }
+
+        void IterateCellThinking(long step, TCellRef cell, float& forceLeft, float& forceRight) noexcept
+        {
+            forceLeft = 0.0f;
+            forceRight = 0.0f;
+
+            for (int nIter = 0; nIter < NetworkIterationsPerStep; ++nIter)
+            {
+                // Iterate network finally
+                cell->IterateNetwork(step * NetworkIterationsPerStep + nIter);
+
+                // Execute action - what is ordered by the neuron network
+                forceLeft += cell->MoveForceLeft / static_cast<float>(NetworkIterationsPerStep);
+                forceRight += cell->MoveForceRight / static_cast<float>(NetworkIterationsPerStep);
+            }
+        }
+
+        // VectorizedSimulation: the same as IterateCellThinkingAndMoving, the movement part done 
+        // by SimulationKernels::MoveCells for MovementBatch::Size cells at once
+        void QueueCellThinkingAndMoving(MovementQueue& queue, long step, TCellRef cell) noexcept
+        {
+            auto& batch = queue.Batch;
+            int lane = batch.Count++;
+
+            IterateCellThinking(step, cell, batch.ForceLeft[lane], batch.ForceRight[lane]);
+
+            batch.Energy[lane] = cell.EnergyValue();
+            batch.Rotation[lane] = cell.Rotation();
+            batch.VelocityX[lane] = cell.VelocityX();
+            batch.VelocityY[lane] = cell.VelocityY();
+            batch.LocationX[lane] = cell.LocationX();
+            batch.LocationY[lane] = cell.LocationY();
+            batch.Mass[lane] = cell.Mass();
+            batch.Predator[lane] = cell->IsPredator ? -1 : 0;
+            queue.States[lane] = &cell.Store();
+            queue.Indices[lane] = cell.Index();
+
+            if (batch.Count == MovementBatch::Size)
+                MoveQueuedCells(queue);
+        }
+
+        void MoveQueuedCells(MovementQueue& queue) noexcept
+        {
+            auto& batch = queue.Batch;
+            if (batch.Count == 0)
+                return;
+
+            SimulationKernels<WorldProp>::Get().MoveCells(batch, static_cast<float>(_maxX), static_cast<float>(_maxY));
+
+            for (int lane = 0; lane < batch.Count; ++lane)
+            {
+                EntityRef cell(*queue.States[lane], queue.Indices[lane]);
+                cell.EnergyValue() = batch.Energy[lane];
+                cell.Rotation() = batch.Rotation[lane];
+                cell.VelocityX() = batch.VelocityX[lane];
+                cell.VelocityY() = batch.VelocityY[lane];
+                cell.LocationX() = batch.LocationX[lane];
+                cell.LocationY() = batch.LocationY[lane];
+            }
+
+            batch.Count = 0;
+        }
+
+        void IterateCellThinkingAndMoving(long step, TCellRef cell) noexcept
+        {
+            float forceLeft;
+            float forceRight;
+
+            IterateCellThinking(step, cell, forceLeft, forceRight);
+
+            float forwardForce = ((forceLeft + forceRight) / SQRT_2);
+            float rotationForce = (forceLeft - forceRight) / SQRT_2;
 
             float moveEnergyRequired = (std::abs(forceLeft) + std::abs(forceRight)) * 
                 (cell->IsPredator ? WorldProp::PredatorMoveEnergyFactor : WorldProp::MoveEnergyFactor);
@@ -612,14 +1244,14 @@ namespace Neurolution
             {
                 forwardForce *= 0.94f; // a bit slow and heavy
 
-				if (cell->EnergyValue > WorldProp::PredatorsOvereatEnergy)
+				if (cell.EnergyValue() > WorldProp::PredatorsOvereatEnergy)
 				{
 					forwardForce *= WorldProp::PredatorsOveratSlowdownFactor;
 				}
             }
-            else if (!cell->IsPredator && cell->EnergyValue < WorldProp::SedatedAtEnergyLevel)
+            else if (!cell->IsPredator && cell.EnergyValue() < WorldProp::SedatedAtEnergyLevel)
             {
-                float slowdownFactor = cell->EnergyValue / WorldProp::SedatedAtEnergyLevel;
+                float slowdownFactor = cell.EnergyValue() / WorldProp::SedatedAtEnergyLevel;
                 forwardForce *= slowdownFactor;
                 rotationForce *= slowdownFactor;
                 moveEnergyRequired *= slowdownFactor;
@@ -632,11 +1264,11 @@ namespace Neurolution
 			//	rotationForce = 0.0f;
 			//}
 
-            if (moveEnergyRequired <= cell->EnergyValue)
+            if (moveEnergyRequired <= cell.EnergyValue())
             {
-                cell->EnergyValue -= moveEnergyRequired;
+                cell.EnergyValue() -= moveEnergyRequired;
 
-                cell->Rotation = LoopValue(cell->Rotation + rotationForce, 0.0f, (float)(M_PI * 2.0f));
+                cell.Rotation() = LoopValue(cell.Rotation() + rotationForce, 0.0f, (float)(M_PI * 2.0f));
 
 				if constexpr (WorldProp::RealPhysics)
 				{
@@ -649,7 +1281,7 @@ namespace Neurolution
 					// 2. Apply forward force
 
 					// AIR DRAG
-					float velocitySquare = cell->VelocityX * cell->VelocityX + cell->VelocityY * cell->VelocityY;
+					float velocitySquare = cell.VelocityX() * cell.VelocityX() + cell.VelocityY() * cell.VelocityY();
 					if (velocitySquare > 0.0000001f)
 					{
 						float velocity = std::sqrtf(velocitySquare);
@@ -661,7 +1293,7 @@ namespace Neurolution
 							WorldProp::AirDragFactorLinear * velocity;
 
 
-						float airDragDeltaV = airDrag / cell->Mass * timeDelta;
+						float airDragDeltaV = airDrag / cell.Mass() * timeDelta;
 
 						// Air resistance can't decelerate us more than we have 
 						airDragDeltaV = (airDragDeltaV > velocity) ? velocity : airDragDeltaV;
@@ -671,112 +1303,558 @@ namespace Neurolution
 						//                                      the velocity direction vector
 						//                                               |             
 						//                                  /------------^-----------\ 
-						cell->VelocityX -= airDragDeltaV * (cell->VelocityX / velocity) * timeDelta;
-						cell->VelocityY -= airDragDeltaV * (cell->VelocityY / velocity) * timeDelta;
+						cell.VelocityX() -= airDragDeltaV * (cell.VelocityX() / velocity) * timeDelta;
+						cell.VelocityY() -= airDragDeltaV * (cell.VelocityY() / velocity) * timeDelta;
 					}
 
 					// THRUST 
 
-					float forwardForceDeltaV = forwardForce / cell->Mass * timeDelta;
+					float forwardForceDeltaV = forwardForce / cell.Mass() * timeDelta;
 
-					cell->VelocityX += forwardForceDeltaV * static_cast<float>(std::cos(cell->Rotation)) * timeDelta;
-					cell->VelocityY += forwardForceDeltaV * static_cast<float>(std::sin(cell->Rotation)) * timeDelta;
+					cell.VelocityX() += forwardForceDeltaV * static_cast<float>(std::cos(cell.Rotation())) * timeDelta;
+					cell.VelocityY() += forwardForceDeltaV * static_cast<float>(std::sin(cell.Rotation())) * timeDelta;
 
 
 					// Finally - location update 
-					cell->LocationX += cell->VelocityX * timeDelta; 
-					cell->LocationY += cell->VelocityY * timeDelta; 
+					cell.LocationX() += cell.VelocityX() * timeDelta; 
+					cell.LocationY() += cell.VelocityY() * timeDelta; 
 
-					cell->LocationX = LoopValue(cell->LocationX, 0.0f, (float)_maxX);
-					cell->LocationY = LoopValue(cell->LocationY, 0.0f, (float)_maxY);
+					cell.LocationX() = LoopValue(cell.LocationX(), 0.0f, (float)_maxX);
+					cell.LocationY() = LoopValue(cell.LocationY(), 0.0f, (float)_maxY);
 				}
 				else
 				{
-					float dX = (float)(forwardForce * std::cos(cell->Rotation));
-					float dY = (float)(forwardForce * std::sin(cell->Rotation));
+					float dX = (float)(forwardForce * std::cos(cell.Rotation()));
+					float dY = (float)(forwardForce * std::sin(cell.Rotation()));
 
-					cell->LocationX = LoopValue(cell->LocationX + dX, 0.0f, (float)_maxX);
-					cell->LocationY = LoopValue(cell->LocationY + dY, 0.0f, (float)_maxY);
+					cell.LocationX() = LoopValue(cell.LocationX() + dX, 0.0f, (float)_maxX);
+					cell.LocationY() = LoopValue(cell.LocationY() + dY, 0.0f, (float)_maxY);
 				}
             }
             else if (!cell->IsPredator)
             {
-                cell->EnergyValue = 0.0f; // so it has tried and failed
+                cell.EnergyValue() = 0.0f; // so it has tried and failed
             }
 
         }
 
-        void IterateCellCollisions(int threadIdx, long step, std::shared_ptr<TCell>& cell)  noexcept
+        void IterateCellCollisions(int threadIdx, long step, TCellRef cell)  noexcept
+        {
+            IterateFoodCollisions(cell);
+            IteratePredatorCollisions(cell);
+        }
+
+        void IterateFoodCollisions(TCellRef cell)  noexcept
         {
             if (!cell->IsPredator)
             {
-                if (cell->EnergyValue < WorldProp::MaxEnergyCapacity)
+                if (cell.EnergyValue() < WorldProp::MaxEnergyCapacity)
                 {
                     // Analyze the outcome - did it get any food? 
-                    for (int foodIdx = 0; foodIdx < _foods.AliveSize(); ++foodIdx)
+                    // only the foods within capture distance are in the row
+                    PairRow foods = _contactFoods.Row(cell.Index());
+                    for (int i = 0; i < foods.Count; ++i)
                     {
-                        auto& food = _foods[foodIdx];
+                        auto food = FoodAt(foods.Objects[i]);
                         if (food.IsEmpty())
                             continue;
 
-                        float pdx = std::powf(cell->LocationX - food.LocationX, 2.0f);
-                        float pdy = std::powf(cell->LocationY - food.LocationY, 2.0f);
-
-						constexpr float foodCaptureDistanceSquare = WorldProp::CellFoodCaptureDistance * WorldProp::CellFoodCaptureDistance;
-                        if (pdx + pdy <= foodCaptureDistanceSquare)
-                        {
-							if (_random.NextDouble() <
-								WorldProp::FoodConsumptionProbability(cell->VelocityX - food.VelocityX, cell->VelocityY - food.VelocityY))
-							{
-								cell->EnergyValue += food.Consume();
-							}
-                        }
+						if (_random.NextDouble() <
+							WorldProp::FoodConsumptionProbability(cell.VelocityX() - food.VelocityX(), cell.VelocityY() - food.VelocityY()))
+						{
+							cell.EnergyValue() += food.Consume();
+						}
                     }
                 }
+            }
+        }
 
-                if (cell->EnergyValue > WorldProp::SporeEnergyLevel)
+        void IteratePredatorCollisions(TCellRef cell)  noexcept
+        {
+            if (!cell->IsPredator)
+            {
+                if (cell.EnergyValue() > WorldProp::SporeEnergyLevel)
                 {
                     // Analyze the outcome - did it hit any predators? 
-                    for (auto& predator : _predators)
+                    PairRow predators = _contactPredators.Row(cell.Index());
+                    for (int i = 0; i < predators.Count; ++i)
                     {
-                        if (predator->EnergyValue < 0.0001f)
+                        int pIdx = predators.Objects[i];
+                        EntityRef predator(_predators.State, pIdx);
+                        if (predator.EnergyValue() < 0.0001f)
                             continue; // skip deads 
 
-                        float pdx = std::powf(cell->LocationX - predator->LocationX, 2.0f);
-                        float pdy = std::powf(cell->LocationY - predator->LocationY, 2.0f);
-
-						constexpr float captureDistanceSquare = WorldProp::PredatorCaptureDistance * WorldProp::PredatorCaptureDistance;
+						if (_random.NextDouble() <
+							WorldProp::PreyCatchingProbability(predator.VelocityX() - cell.VelocityX(), predator.VelocityY() - cell.VelocityY()))
+						{
+							float energy = InterlockedCompareExchange(&(cell.EnergyValue()), 0.0f, cell.EnergyValue());
 
-                        if (pdx + pdy <= captureDistanceSquare)
-                        {
-							if (_random.NextDouble() <
-								WorldProp::PreyCatchingProbability(predator->VelocityX - cell->VelocityX, predator->VelocityY - cell->VelocityY))
+							if (!_predators[pIdx].PredatoryEat(energy))
 							{
-								float energy = InterlockedCompareExchange(&(cell->EnergyValue), 0.0f, cell->EnergyValue);
-
-								if (!predator->PredatoryEat(energy))
-								{
-									// predator has failed 
-									InterlockedCompareExchange(&(cell->EnergyValue), energy, 0.0f);
-								}
+								// predator has failed 
+								InterlockedCompareExchange(&(cell.EnergyValue()), energy, 0.0f);
 							}
-                        }
+						}
                     }
                 }
             }
         }
 
+        // Candidates argument of the PairTable builds: the grid query around position(idx), 
+        // or all the pairs without UseSpatialGrid
+        template <typename TPositionFn>
+        auto NearbyCandidates(const SpatialGrid& grid, float radius, TPositionFn position) const noexcept
+        {
+            if constexpr (WorldProp::UseSpatialGrid)
+            {
+                return [&grid, radius, position](int idx, std::vector<int>& out)
+                {
+                    float x, y;
+                    position(idx, x, y);
+                    grid.Query(x, y, radius, WorldProp::WrapAroundDistances, out);
+                };
+            }
+            else
+            {
+                return AllPairs{};
+            }
+        }
+
+        // Prey and predators as one index space, for the sight table
+        template <typename TFn>
+        auto WithBody(int idx, TFn&& fn) noexcept
+        {
+            int numPrey = static_cast<int>(_cells.size());
+            return idx < numPrey ? fn(_cells.State, idx, false) : fn(_predators.State, idx - numPrey, true);
+        }
+
+        TCellRef BodyAt(int idx) noexcept
+        {
+            int numPrey = static_cast<int>(_cells.size());
+            return idx < numPrey ? _cells[idx] : _predators[idx - numPrey];
+        }
+
+        // The bodies the sensing and thinking go through: all of them (prey, then predators), 
+        // or with SkipDormantCells the active ones. NumaAwarePlacement has them by node
+        int NumScheduledBodies() const noexcept
+        {
+            if constexpr (WorldProp::NumaAwarePlacement)
+                return static_cast<int>(_nodeBodies.size());
+            else if constexpr (WorldProp::SkipDormantCells)
+                return static_cast<int>(_activeBodies.size());
+            else
+                return static_cast<int>(_cells.size() + _predators.size());
+        }
+
+        // the scheduled bodies before it are prey, the ones from it on predators
+        int NumScheduledPrey() const noexcept
+        {
+            if constexpr (WorldProp::SkipDormantCells)
+                return static_cast<int>(std::lower_bound(_activeBodies.begin(), _activeBodies.end(), static_cast<int>(_cells.size())) - _activeBodies.begin());
+            else
+                return static_cast<int>(_cells.size());
+        }
+
+        // fn(cell, bodyIdx) for the scheduled bodies [from, to)
+        template <typename TFn>
+        void ForEachBody(int from, int to, TFn&& fn) noexcept
+        {
+            for (int k = from; k < to; ++k)
+            {
+                int bodyIdx = WorldProp::NumaAwarePlacement ? _nodeBodies[k] : 
+                    WorldProp::SkipDormantCells ? _activeBodies[k] : k;
+                fn(BodyAt(bodyIdx), bodyIdx);
+            }
+        }
+
+        // fn(threadIdx, from, to) over the scheduled bodies, with NumaAwarePlacement each 
+        // node's by its own workers
+        template <typename TFn>
+        void ParallelForBodies(const char* phase, TFn&& fn) noexcept
+        {
+            if constexpr (WorldProp::NumaAwarePlacement)
+                _grid.ParallelForNodes(phase, _nodeBounds, BodiesPerChunk, fn);
+            else
+                _grid.ParallelFor(phase, 0, NumScheduledBodies(), BodiesPerChunk, fn);
+        }
+
+        // NumaAwarePlacement: the bodies get their home nodes in blocks, and each network is 
+        // copied by a worker of its node, so that its pages are first touched (and end up) there
+        void PlaceNetworks()
+        {
+            int numBodies = static_cast<int>(_cells.size() + _predators.size());
+            int numNodes = _grid.GetNumNodes();
+
+            for (int bodyIdx = 0; bodyIdx < numBodies; ++bodyIdx)
+                BodyAt(bodyIdx)->HomeNode = static_cast<int>(static_cast<long long>(bodyIdx) * numNodes / numBodies);
+
+            _grid.GridRun([&](int threadIdx, int)
+            {
+                int node = _grid.GetWorkerNode(threadIdx);
+                int nodeWorker = threadIdx - _grid.GetNodeFirstWorker(node);
+                int nodeWorkers = _grid.GetNodeNumWorkers(node);
+
+                int numNodeBodies = 0;
+                for (int bodyIdx = 0; bodyIdx < numBodies; ++bodyIdx)
+                {
+                    TCellRef cell = BodyAt(bodyIdx);
+                    if (cell->HomeNode != node)
+                        continue;
+
+                    if (numNodeBodies++ % nodeWorkers == nodeWorker)
+                        cell->Network = std::make_shared<typename TCell::TNetwork>(*cell->Network);
+                }
+            });
+        }
+
+        // NumaAwarePlacement: the scheduled bodies into _nodeBodies by home node, keeping 
+        // their order within each node
+        void ScheduleByNode()
+        {
+            int numNodes = _grid.GetNumNodes();
+            int numScheduled = WorldProp::SkipDormantCells ? 
+                static_cast<int>(_activeBodies.size()) : static_cast<int>(_cells.size() + _predators.size());
+
+            auto scheduled = [&](int k) { return WorldProp::SkipDormantCells ? _activeBodies[k] : k; };
+
+            _nodeBounds.assign(numNodes + 1, 0);
+            for (int k = 0; k < numScheduled; ++k)
+                ++_nodeBounds[BodyAt(scheduled(k))->HomeNode + 1];
+
+            for (int node = 0; node < numNodes; ++node)
+                _nodeBounds[node + 1] += _nodeBounds[node];
+
+            _nodeCursors.assign(_nodeBounds.begin(), _nodeBounds.end() - 1);
+            _nodeBodies.resize(numScheduled);
+            for (int k = 0; k < numScheduled; ++k)
+            {
+                int bodyIdx = scheduled(k);
+                _nodeBodies[_nodeCursors[BodyAt(bodyIdx)->HomeNode]++] = bodyIdx;
+            }
+        }
+
+        // Batched with NumaAwarePlacement: the networks added node by node, each evaluated 
+        // whole by a worker of its node
+        void EvaluateNetworksByNode()
+        {
+            int numNodes = _grid.GetNumNodes();
+
+            _networkBounds.assign(numNodes + 1, 0);
+            for (int node = 0; node < numNodes; ++node)
+            {
+                for (int k = _nodeBounds[node]; k < _nodeBounds[node + 1]; ++k)
+                    _batchEvaluator.Add(*BodyAt(_nodeBodies[k])->Network);
+
+                _networkBounds[node + 1] = static_cast<int>(_batchEvaluator.GetNumNetworks());
+            }
+
+            _grid.ParallelForNodes("networks", _networkBounds, NetworksPerChunk,
+                [&](int, int from, int to)
+            {
+                _batchEvaluator.RunNetworks(from, to);
+            });
+
+            _batchEvaluator.Finish();
+        }
+
+        // SkipDormantCells: the bodies with energy into _activeBodies, the others only age as 
+        // if they had thought this step. Their weighted inputs stay valid, so the batched 
+        // evaluator passes over them too
+        void CollectActiveBodies()
+        {
+            int numBodies = static_cast<int>(_cells.size() + _predators.size());
+            _activeBodies.clear();
+
+            for (int bodyIdx = 0; bodyIdx < numBodies; ++bodyIdx)
+            {
+                TCellRef cell = BodyAt(bodyIdx);
+                if (cell.EnergyValue() < 0.00001f)
+                    cell->Age += NetworkIterationsPerStep;
+                else
+                    _activeBodies.push_back(bodyIdx);
+            }
+        }
+
+        // Builds table by build(table, radiusSquare, seen, candidates), the candidates from
+        // nearby(queryRadius). With NeighborListSkin the candidates are the lists instead, 
+        // themselves built the same way with the radius + skin and everything seen, again once 
+        // one of the numPoints point(idx, x, y) has moved half the skin
+        template <typename TBuildFn, typename TNearbyFn, typename TSeenFn, typename TPointFn>
+        void BuildTable(
+            PairTable& table, 
+            NeighborLists& lists, 
+            float radiusSquare, 
+            float queryRadius, 
+            TBuildFn&& build, 
+            TNearbyFn&& nearby, 
+            TSeenFn&& seen, 
+            int numPoints, 
+            double allPairs, 
+            TPointFn&& point)
+        {
+            if constexpr (WorldProp::NeighborListSkin > 0.0f)
+            {
+                constexpr float skin = WorldProp::NeighborListSkin;
+                float listRadius = queryRadius + skin;
+
+                lists.Update(_grid, numPoints, allPairs, skin, point, [&](PairTable& listed)
+                {
+                    build(listed, listRadius * listRadius, [](int, float& energy) { energy = 0.0f; return true; }, nearby(listRadius));
+                });
+
+                build(table, radiusSquare, seen, lists.Candidates());
+            }
+            else
+            {
+                build(table, radiusSquare, seen, nearby(queryRadius));
+            }
+        }
+
+        void BuildSightTables()
+        {
+            BuildBodySightTable();
+            BuildFoodSightTable();
+        }
+
+        void BuildBodySightTable()
+        {
+            int numPrey = static_cast<int>(_cells.size());
+            int numBodies = numPrey + static_cast<int>(_predators.size());
+            constexpr float radiusSquare = static_cast<float>(WorldProp::MaxDistanceSquareVisibility);
+
+            auto displacement = [&](float& dx, float& dy)
+            {
+                dx = Displacement(dx, _maxX);
+                dy = Displacement(dy, _maxY);
+            };
+
+            auto bodyPosition = [&](int idx, float& x, float& y)
+            {
+                WithBody(idx, [&](EntityStore& state, int i, bool)
+                {
+                    x = state.LocationX[i];
+                    y = state.LocationY[i];
+                });
+            };
+
+            auto bodySeen = [&](int idx, float& energy)
+            {
+                return WithBody(idx, [&](EntityStore& state, int i, bool isPredator)
+                {
+                    energy = isPredator ? WorldProp::PredatorInitialValue : WorldProp::InitialCellEnergy;
+                    return !(state.EnergyValue[i] < 0.01f);
+                });
+            };
+
+            BuildTable(_sightPairs, _sightPairLists, radiusSquare, _visibilityQueryRadius,
+                [&](PairTable& table, float r2, auto&& seen, auto&& candidates)
+                {
+                    table.BuildSymmetric(_grid, numBodies, r2, bodyPosition, displacement, seen, candidates);
+                },
+                [&](float radius)
+                {
+                    if constexpr (WorldProp::UseSpatialGrid)
+                    {
+                        return [&, radius](int idx, std::vector<int>& out)
+                        {
+                            float x, y;
+                            bodyPosition(idx, x, y);
+                            _cellGrid.Query(x, y, radius, WorldProp::WrapAroundDistances, out);
+                            _predatorGrid.QueryAppend(x, y, radius, WorldProp::WrapAroundDistances, numPrey, out);
+                        };
+                    }
+                    else
+                    {
+                        return AllPairs{};
+                    }
+                },
+                bodySeen, numBodies, static_cast<double>(numBodies) * (numBodies - 1), bodyPosition);
+        }
+
+        void BuildFoodSightTable()
+        {
+            int numPrey = static_cast<int>(_cells.size());
+            int numFoods = static_cast<int>(_foods.AliveSize());
+            constexpr float radiusSquare = static_cast<float>(WorldProp::MaxDistanceSquareVisibility);
+
+            auto displacement = [&](float& dx, float& dy)
+            {
+                dx = Displacement(dx, _maxX);
+                dy = Displacement(dy, _maxY);
+            };
+
+            auto bodyPosition = [&](int idx, float& x, float& y)
+            {
+                WithBody(idx, [&](EntityStore& state, int i, bool)
+                {
+                    x = state.LocationX[i];
+                    y = state.LocationY[i];
+                });
+            };
+
+            auto foodPosition = [&](int idx, float& x, float& y)
+            {
+                x = _foods.LocationX[idx];
+                y = _foods.LocationY[idx];
+            };
+
+            auto foodSeen = [&](int idx, float& energy)
+            {
+                energy = _foods.EnergyValue[idx];
+                return !(energy < 0.01f);
+            };
+
+            BuildTable(_sightFoods, _sightFoodLists, radiusSquare, _visibilityQueryRadius,
+                [&](PairTable& table, float r2, auto&& seen, auto&& candidates)
+                {
+                    table.BuildCross(_grid, numPrey, numFoods, r2, bodyPosition, foodPosition, displacement, seen, candidates);
+                },
+                [&](float radius) { return NearbyCandidates(_foodGrid, radius, bodyPosition); },
+                foodSeen, numPrey + numFoods, static_cast<double>(numPrey) * numFoods,
+                [&](int idx, float& x, float& y)
+                {
+                    if (idx < numPrey)
+                        bodyPosition(idx, x, y);
+                    else
+                        foodPosition(idx - numPrey, x, y);
+                });
+        }
+
+        void BuildContactTables()
+        {
+            BuildFoodContactTable();
+            BuildPredatorContactTable();
+        }
+
+        void BuildFoodContactTable()
+        {
+            int numPrey = static_cast<int>(_cells.size());
+            int numFoods = static_cast<int>(_foods.AliveSize());
+
+            auto displacement = [&](float& dx, float& dy)
+            {
+                dx = Displacement(dx, _maxX);
+                dy = Displacement(dy, _maxY);
+            };
+
+            auto preyPosition = [&](int idx, float& x, float& y)
+            {
+                x = _cells.State.LocationX[idx];
+                y = _cells.State.LocationY[idx];
+            };
+
+            auto foodPosition = [&](int idx, float& x, float& y)
+            {
+                x = _foods.LocationX[idx];
+                y = _foods.LocationY[idx];
+            };
+
+            auto all = [](int, float& energy) { energy = 0.0f; return true; };
+
+            constexpr float foodCaptureDistanceSquare = WorldProp::CellFoodCaptureDistance * WorldProp::CellFoodCaptureDistance;
+            BuildTable(_contactFoods, _contactFoodLists, foodCaptureDistanceSquare, WorldProp::CellFoodCaptureDistance,
+                [&](PairTable& table, float r2, auto&& seen, auto&& candidates)
+                {
+                    table.BuildCross(_grid, numPrey, numFoods, r2, preyPosition, foodPosition, displacement, seen, candidates);
+                },
+                [&](float radius) { return NearbyCandidates(_foodGrid, radius, preyPosition); },
+                all, numPrey + numFoods, static_cast<double>(numPrey) * numFoods,
+                [&](int idx, float& x, float& y)
+                {
+                    if (idx < numPrey)
+                        preyPosition(idx, x, y);
+                    else
+                        foodPosition(idx - numPrey, x, y);
+                });
+        }
+
+        void BuildPredatorContactTable()
+        {
+            int numPrey = static_cast<int>(_cells.size());
+            int numPredators = static_cast<int>(_predators.size());
+
+            auto displacement = [&](float& dx, float& dy)
+            {
+                dx = Displacement(dx, _maxX);
+                dy = Displacement(dy, _maxY);
+            };
+
+            auto preyPosition = [&](int idx, float& x, float& y)
+            {
+                x = _cells.State.LocationX[idx];
+                y = _cells.State.LocationY[idx];
+            };
+
+            auto predatorPosition = [&](int idx, float& x, float& y)
+            {
+                x = _predators.State.LocationX[idx];
+                y = _predators.State.LocationY[idx];
+            };
+
+            auto all = [](int, float& energy) { energy = 0.0f; return true; };
+
+            constexpr float captureDistanceSquare = WorldProp::PredatorCaptureDistance * WorldProp::PredatorCaptureDistance;
+            BuildTable(_contactPredators, _contactPredatorLists, captureDistanceSquare, WorldProp::PredatorCaptureDistance,
+                [&](PairTable& table, float r2, auto&& seen, auto&& candidates)
+                {
+                    table.BuildCross(_grid, numPrey, numPredators, r2, preyPosition, predatorPosition, displacement, seen, candidates);
+                },
+                [&](float radius) { return NearbyCandidates(_predatorGrid, radius, preyPosition); },
+                all, numPrey + numPredators, static_cast<double>(numPrey) * numPredators,
+                [&](int idx, float& x, float& y)
+                {
+                    if (idx < numPrey)
+                        preyPosition(idx, x, y);
+                    else
+                        predatorPosition(idx - numPrey, x, y);
+                });
+        }
+
+        // Drops what is matched by object index from step to step: the neighbour lists and the 
+        // sensor cache
+        void IndicesChanged(bool foodsOnly)
+        {
+            _sightFoodLists.Invalidate();
+            _contactFoodLists.Invalidate();
+            if (!foodsOnly)
+            {
+                _sightPairLists.Invalidate();
+                _contactPredatorLists.Invalidate();
+            }
+
+            if constexpr (WorldProp::SensorCacheTolerance > 0.0f)
+            {
+                if (foodsOnly)
+                    _sensorCache.InvalidateColor(0);
+                else
+                    _sensorCache.Invalidate(static_cast<int>(_cells.size() + _predators.size()));
+            }
+        }
+
+        Food<WorldProp> FoodAt(int idx) noexcept
+        {
+            return Food<WorldProp>(_foods, idx);
+        }
+
+        // initial spot of a cell, same draws as the cells used to do themselves
+        void PlaceRandomly(TCellRef cell) noexcept
+        {
+			cell.LocationX() = static_cast<float>(_random.NextDouble() * _maxX);
+			cell.LocationY() = static_cast<float>(_random.NextDouble() * _maxY);
+			cell.Rotation() = static_cast<float>(_random.NextDouble() * 2.0 * M_PI);
+        }
+
         void GiveOneFood()  noexcept
         {
             if (_foods.DeadSize() > 0)
             {
-                _foods.Reanimate().Reset(_random, _maxX, _maxY);
+                FoodAt(_foods.Reanimate()).Reset(_random, _maxX, _maxY);
             }
             else
             {
-                if (_foods[_nextFoodIdx].EnergyValue < WorldProp::FoodInitialValue / 2.0f)
+                if (_foods.EnergyValue[_nextFoodIdx] < WorldProp::FoodInitialValue / 2.0f)
                 {
-                    _foods[_nextFoodIdx].Reset(_random, _maxX, _maxY);
+                    FoodAt(_nextFoodIdx).Reset(_random, _maxX, _maxY);
                     _nextFoodIdx = (_nextFoodIdx + 1) % _foods.size();
                 }
             }
@@ -785,23 +1863,25 @@ namespace Neurolution
         void WorldInitialize()  noexcept
         {
             // cleanput outputs & foods 
-            for (auto& cell : _cells)
+            for (int idx = 0; idx < static_cast<int>(_cells.size()); ++idx)
             {
-                cell->EnergyValue = WorldProp::InitialCellEnergy;
+                auto cell = _cells[idx];
+                cell.EnergyValue() = WorldProp::InitialCellEnergy;
                 cell->Network->CleanOutputs();
                 //cell.RandomizeLocation(_random, _maxX, _maxY);
             }
 
-            for (auto& predator : _predators)
+            for (int idx = 0; idx < static_cast<int>(_predators.size()); ++idx)
             {
-                predator->EnergyValue = WorldProp::PredatorInitialValue;
+                auto predator = _predators[idx];
+                predator.EnergyValue() = WorldProp::PredatorInitialValue;
                 predator->Network->CleanOutputs();
             }
 
             GiveOneFood();
         }
 
-        void CreateChild(std::shared_ptr<TCell>& source, std::shared_ptr<TCell>& destination, float initialEnergy)  noexcept
+        void CreateChild(TCellRef source, TCellRef destination, float initialEnergy)  noexcept
         {
             double rv = _random.NextDouble();
             bool severeMutations = (rv < WorldProp::SevereMutationFactor);
@@ -809,13 +1889,16 @@ namespace Neurolution
             float severity = (float)(1.0 - std::pow(rv / WorldProp::SevereMutationFactor,
                 WorldProp::SevereMutationSlope)); // % of neurons to mutate
 
-            destination->CloneFrom(*source, _random, _maxX, _maxY, severeMutations, severity);
+            // Network is cloned later by _cloner, outputs are cleaned after that
+            _cloner.Add(*source->Network, *destination->Network, _random, severeMutations, severity);
+            _newborns.push_back(&destination.Cold());
+
+            destination->Age = 0;
             destination->ClonedFrom = -1;
 
-            destination->EnergyValue = initialEnergy;
-            destination->Network->CleanOutputs();
+            destination.EnergyValue() = initialEnergy;
 
-            destination->RandomizeLocation(_random, source->LocationX, source->LocationY, _maxX, _maxY);
+            destination.RandomizeLocation(_random, source.LocationX(), source.LocationY(), _maxX, _maxY);
 
             source->Age = 0; // kind of hack
         }
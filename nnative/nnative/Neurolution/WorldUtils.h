@@ -76,6 +76,27 @@ namespace Neurolution
 		}
 	};
 
+    struct DirectionWithDistanceSquare //: public Orientation
+    {
+		float DirectionX;
+		float DirectionY;
+        float DistanceSquare;
+		float Energy;
+
+        void Set(float dx, float dy)  noexcept
+        {
+            DirectionX = dx;
+            DirectionY = dy;
+            DistanceSquare = dx * dx + dy * dy;
+        }
+
+		void Set(float dx, float dy, float energy)  noexcept
+		{
+			Set(dx, dy);
+			Energy = energy;
+		}
+    };
+
 	struct MaterialPoint : public Orientation, public Location, public Velocity
 	{
 		float Mass{ 1.0f };
@@ -73,14 +73,14 @@ namespace Neurolution
 
             for (int i = 0; i < _world->GetCells().size(); ++i)
             {
-                _cellViews[i] = std::make_shared<TCellView>(_world->GetCells()[i], rnd);
+                _cellViews[i] = std::make_shared<TCellView>(_world->GetCells(), i, rnd);
             }
 
 			int ofs = static_cast<int>(_world->GetCells().size());
 		
 			for (int i = 0; i < _world->GetPredators().size(); ++i)
 			{
-				_cellViews[ofs + i] = std::make_shared<TCellView>(_world->GetPredators()[i], rnd);
+				_cellViews[ofs + i] = std::make_shared<TCellView>(_world->GetPredators(), i, rnd);
 			}
 		}
 
@@ -109,7 +109,7 @@ namespace Neurolution
 			ostr << "ITER: " << details.currentIteration << ", IPS: " << details.iterationsPerSecond;
 
 			std::ostringstream rcfg;
-			rcfg << "#THR: " << details.numActiveThreads;
+			rcfg << "#THR: " << details.numActiveThreads << ", KERNEL: " << KernelIsaName(KernelDispatch::Selected());
 
 			_iterAndCfgLabel.Update(
 				LABELS_BACKGROUND,
@@ -161,20 +161,22 @@ namespace Neurolution
                 cellView->Draw();
             }
 
-            for (auto& food : _world->GetFoods())
+            auto& foods = _world->GetFoods();
+            for (int foodIdx = 0; foodIdx < foods.size(); ++foodIdx)
             {
-                if (food.EnergyValue < 0.01)
+                EntityRef food(foods, foodIdx);
+                if (food.EnergyValue() < 0.01)
                     continue;
 
                 glPushMatrix();
-                glTranslatef(food.LocationX, food.LocationY, 0.0);
+                glTranslatef(food.LocationX(), food.LocationY(), 0.0);
                 //glRotatef(cell->Rotation, 0.0f, 0.0f, 1.0f);
 
                 glBegin(GL_TRIANGLES);
 
                 _foodColor.GlApply();
 
-                float halfdiameter = static_cast<float>(std::sqrt(food.EnergyValue) * 5.0 / 1.5);
+                float halfdiameter = static_cast<float>(std::sqrt(food.EnergyValue()) * 5.0 / 1.5);
 
                 int idx = 0;
                 glIndexi(++idx); glVertex3f(0.0f, halfdiameter, 0.0f);
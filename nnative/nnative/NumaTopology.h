@@ -0,0 +1,149 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+// The NUMA nodes with the logical processors of each that this process may run on, as the
+// OS tells them. Where it can't, or when there is only one, it is a single node with all the
+// processors. Nodes without processors (memory only) are left out
+struct NumaTopology
+{
+    std::vector<std::vector<int>> NodeProcessors;
+
+    int GetNumNodes() const noexcept
+    {
+        return static_cast<int>(NodeProcessors.size());
+    }
+
+    // the numbers of a sysfs list, "0-3,8-11"
+    static std::vector<int> ParseList(const std::string& line)
+    {
+        std::vector<int> numbers;
+        std::stringstream ranges(line);
+        std::string range;
+        while (std::getline(ranges, range, ','))
+        {
+            if (range.empty())
+                continue;
+
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+            for (int number = first; number <= last; ++number)
+                numbers.push_back(number);
+        }
+        return numbers;
+    }
+
+    static NumaTopology Detect()
+    {
+        NumaTopology topology;
+
+#ifdef _WIN32
+        // the process affinity mask only covers the processor group the process started in
+        DWORD_PTR processMask = 0;
+        DWORD_PTR systemMask = 0;
+        GROUP_AFFINITY processGroup{};
+        bool haveAllowed = GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) &&
+            GetThreadGroupAffinity(GetCurrentThread(), &processGroup);
+
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber(&highestNode))
+        {
+            for (USHORT node = 0; node <= highestNode; ++node)
+            {
+                GROUP_AFFINITY affinity{};
+                if (!GetNumaNodeProcessorMaskEx(node, &affinity))
+                    continue;
+
+                KAFFINITY mask = affinity.Mask;
+                if (haveAllowed && affinity.Group == processGroup.Group)
+                    mask &= processMask;
+
+                std::vector<int> processors;
+                for (int bit = 0; bit < 64; ++bit)
+                {
+                    if (mask & (KAFFINITY(1) << bit))
+                        processors.push_back(affinity.Group * 64 + bit);
+                }
+
+                if (!processors.empty())
+                    topology.NodeProcessors.push_back(std::move(processors));
+            }
+        }
+#elif defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool haveAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+        // the node numbers can have gaps
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string nodes;
+        if (online)
+            std::getline(online, nodes);
+
+        for (int node : ParseList(nodes))
+        {
+            std::ifstream cpuList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!cpuList)
+                continue;
+
+            std::string line;
+            std::getline(cpuList, line);
+
+            std::vector<int> processors;
+            for (int cpu : ParseList(line))
+            {
+                if (!haveAllowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+                    processors.push_back(cpu);
+            }
+
+            if (!processors.empty())
+                topology.NodeProcessors.push_back(std::move(processors));
+        }
+#endif
+
+        if (topology.NodeProcessors.empty())
+        {
+            std::vector<int> processors;
+            for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); ++cpu)
+                processors.push_back(cpu);
+
+            topology.NodeProcessors.push_back(std::move(processors));
+        }
+
+        return topology;
+    }
+
+    // false if the OS would not have it
+    static bool PinCurrentThread(int processor) noexcept
+    {
+#ifdef _WIN32
+        GROUP_AFFINITY affinity{};
+        affinity.Group = static_cast<WORD>(processor / 64);
+        affinity.Mask = KAFFINITY(1) << (processor % 64);
+        return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+        if (processor >= CPU_SETSIZE)
+            return false;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(processor, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)processor;
+        return false;
+#endif
+    }
+};
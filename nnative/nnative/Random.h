@@ -19,6 +19,12 @@ public:
         generator.seed(seed);
     }
 
+    // Repeatable sequence, e.g. for the benchmarks with a checked bound
+    explicit Random(unsigned int seed)
+    {
+        generator.seed(seed);
+    }
+
 	template <typename T>
 	T Next(const T& from, const T& to)
 	{
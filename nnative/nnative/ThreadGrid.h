@@ -1,38 +1,242 @@
 #pragma once
 #include <thread>
 #include <vector>
-#include <list>
-#include <mutex>
-#include <condition_variable>
 #include <memory>
 #include <atomic>
-#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
 #include <iostream>
 
+#include <emmintrin.h>
+
+#ifdef _WIN32
+#include <windows.h> // WaitOnAddress, Synchronization.lib
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "Allocators.h"
+#include "NumaTopology.h"
+#include "Utils.h"
+
+// A word threads wait on to change: spinning for a while first, as the other side is
+// usually about to change it, then parked in the kernel (futex / WaitOnAddress). Who
+// changes it only makes the wake-up call when someone is actually parked
+class WaitWord
+{
+    std::atomic<uint32_t> value{ 0 };
+    std::atomic<int> numParked{ 0 };
+
+    void Park(uint32_t expected) noexcept
+    {
+#ifdef _WIN32
+        WaitOnAddress(&value, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+        (void)expected;
+        std::this_thread::yield();
+#endif
+    }
+
+    void WakeAll() noexcept
+    {
+#ifdef _WIN32
+        WakeByAddressAll(&value);
+#elif defined(__linux__)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+    }
+
+public:
+    uint32_t Load() const noexcept
+    {
+        return value.load(std::memory_order_acquire);
+    }
+
+    // no wake-up, for when nobody can be waiting for this value
+    void Reset(uint32_t v) noexcept
+    {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    // returns the new value
+    uint32_t Add(uint32_t delta) noexcept
+    {
+        return value.fetch_add(delta) + delta;
+    }
+
+    // after an Add the waiting threads should see
+    void WakeParked() noexcept
+    {
+        if (numParked.load() > 0)
+            WakeAll();
+    }
+
+    // until done(value), spinning at most spins times
+    template <typename TDoneFn>
+    uint32_t Wait(int spins, TDoneFn&& done) noexcept
+    {
+        uint32_t v = Load();
+        for (int i = 0; i < spins && !done(v); ++i)
+        {
+            _mm_pause();
+            v = Load();
+        }
+
+        while (!done(v))
+        {
+            // parked is counted before the value is checked again, so Add either sees
+            // the count or this sees the new value
+            numParked.fetch_add(1);
+            v = value.load();
+            if (!done(v))
+                Park(v);
+            numParked.fetch_sub(1);
+            v = Load();
+        }
+
+        return v;
+    }
+};
+
+// Runs a task on all the threads at once and waits for them. The workers wait on the task
+// generation (so the barrier reverses its sense on every run), the caller on the number of
+// workers still running it; both spin briefly and then park. The task is only referenced,
+// never copied, so GridRun does not allocate.
+// ParallelFor splits an index range into chunks and balances them between the workers by
+// work stealing, timing each worker to tell how uneven the phase was.
+// Region keeps the workers in one run for a whole sequence of GridRuns: worker 0 leads,
+// running the body with the serial parts, and each GridRun it makes is a phase the other
+// workers (already waiting, usually spinning) join, with a barrier at its end.
+// A GridRun or ParallelFor made from inside a task running on the workers (other than the
+// region's phases) has nobody free to help, so the calling worker does all of it in turn.
+// Pinned, each worker stays on one processor, the workers split into consecutive blocks over
+// the NUMA nodes; ParallelForNodes then gives each node's range to its own workers, and the
+// ones out of work steal within their node before going to the others. Not pinned, it is
+// all one node
 class ThreadGrid
 {
+public:
+    struct PhaseStats
+    {
+        const char* Name{ nullptr };
+        long Runs{ 0 };
+        double MeanBusySeconds{ 0.0 };		// summed over the runs
+        double SlowestBusySeconds{ 0.0 };	// the worker that took longest, summed over the runs
+        long Steals{ 0 };
+        std::vector<double> NodeBusySeconds;	// the mean of each node's workers, summed over the runs
+
+        // the phase took this many times longer than with the work evenly spread, 1 is perfect
+        double Imbalance() const noexcept
+        {
+            return MeanBusySeconds > 0.0 ? SlowestBusySeconds / MeanBusySeconds : 1.0;
+        }
+    };
+
+private:
+    // ~ a few microseconds, the time a GridRun following another one usually takes to come
+    static constexpr int SpinIterations = 4000;
+
+    // Each worker's chunks [lo, hi) of the current ParallelFor, in one word so the owner 
+    // (taking from lo) and the thieves (taking the upper half) can both just CAS it
+    struct alignas(64) Worker
+    {
+        std::atomic<uint64_t> Chunks{ 0 };
+        double BusySeconds{ 0.0 };
+        long Steals{ 0 };
+    };
+
     int numThreads;
+    int spins;
+
+    // the node of each worker, the workers of node k being [nodeFirstWorker[k], nodeFirstWorker[k + 1])
+    bool pinned;
+    int numNodes{ 1 };
+    std::vector<int> workerNodes;
+    std::vector<int> workerProcessors;
+    std::vector<int> nodeFirstWorker;
+    std::vector<int> nodeChunks;	// ParallelForNodes: where each node's chunks start
 
     std::vector<std::thread> threads;
-    std::vector<std::mutex> threadIsActive;
+    std::vector<Worker, cache_aligned<Worker>> workers;
+    std::vector<PhaseStats> phases;
 
     std::atomic_bool terminate{ false };
 
-    std::function<void(int, int)> task;
-    std::mutex taskLock;
-    std::vector<bool> hasTask;
-    int numActiveThreads;
-    std::condition_variable taskAwailableCond;
-    std::condition_variable taskDoneCond;
+    void* taskData{ nullptr };
+    void (*taskCall)(void*, int, int) { nullptr };
+
+    WaitWord generation;
+    WaitWord numActiveThreads;
+
+    // Region: the current phase, only looked at by the leading worker
+    bool inPhase{ false };
+    void* phaseData{ nullptr };
+    void (*phaseCall)(void*, int, int) { nullptr };
+
+    WaitWord phaseGeneration;
+    WaitWord numActiveFollowers;
+
+    // the grid this thread is a worker of, which one, and the grid whose region it leads
+    static inline thread_local const ThreadGrid* currentGrid{ nullptr };
+    static inline thread_local int currentWorker{ -1 };
+    static inline thread_local const ThreadGrid* leadingRegion{ nullptr };
+
+    // the workers are all busy with the task that called
+    bool Nested() const noexcept
+    {
+        return currentGrid == this && !(leadingRegion == this && !inPhase);
+    }
+
+    template <typename TTask>
+    static void Call(void* data, int threadIdx, int n)
+    {
+        (*static_cast<TTask*>(data))(threadIdx, n);
+    }
+
+    template <typename TFn>
+    static void* TaskData(TFn& item) noexcept
+    {
+        return const_cast<void*>(static_cast<const void*>(std::addressof(item)));
+    }
 
 public:
-    ThreadGrid(int n)
+    ThreadGrid(int n, bool pin = false)
         : numThreads(n)
+        // spinning only helps with a core for each thread, the caller included
+        , spins(static_cast<unsigned>(n) < std::thread::hardware_concurrency() ? SpinIterations : 0)
+        , pinned(pin)
+        , workerNodes(n, 0)
+        , workerProcessors(n, -1)
         , threads(n)
-        , threadIsActive(n)
-        , hasTask(n)
-		, numActiveThreads{0}
+        , workers(n)
     {
+        if (pin)
+        {
+            NumaTopology topology = NumaTopology::Detect();
+            numNodes = std::min(topology.GetNumNodes(), n);
+
+            for (int t = 0; t < n; ++t)
+            {
+                int node = static_cast<int>(static_cast<int64_t>(t) * numNodes / n);
+                int first = static_cast<int>((static_cast<int64_t>(node) * n + numNodes - 1) / numNodes);
+                auto& processors = topology.NodeProcessors[node];
+
+                workerNodes[t] = node;
+                workerProcessors[t] = processors[(t - first) % processors.size()];
+            }
+        }
+
+        nodeFirstWorker.assign(numNodes + 1, n);
+        for (int t = n - 1; t >= 0; --t)
+            nodeFirstWorker[workerNodes[t]] = t;
+        nodeChunks.resize(numNodes + 1);
+
         for (int i = 0; i < n; ++i)
         {
             threads[i] = std::thread(&ThreadGrid::Thread, this, i);
@@ -42,10 +246,8 @@ public:
     ~ThreadGrid()
     {
         terminate = true;
-        {
-            std::lock_guard<std::mutex> m(taskLock);
-            taskAwailableCond.notify_all();
-        }
+        generation.Add(1);
+        generation.WakeParked();
 
         for (auto& thread : threads)
         {
@@ -54,57 +256,368 @@ public:
         }
     }
 
-    void GridRun(std::function<void(int, int)>&& item) noexcept
+    int GetNumThreads() const noexcept
+    {
+        return numThreads;
+    }
+
+    bool IsPinned() const noexcept
+    {
+        return pinned;
+    }
+
+    int GetNumNodes() const noexcept
+    {
+        return numNodes;
+    }
+
+    int GetWorkerNode(int threadIdx) const noexcept
     {
-		try 
-		{
-			std::unique_lock<std::mutex> m(taskLock);
+        return workerNodes[threadIdx];
+    }
 
-			std::fill(std::begin(hasTask), std::end(hasTask), true);
-			numActiveThreads = numThreads;
+    // -1 when not pinned
+    int GetWorkerProcessor(int threadIdx) const noexcept
+    {
+        return workerProcessors[threadIdx];
+    }
 
-			task = std::move(item);
+    // the workers of a node are consecutive
+    int GetNodeFirstWorker(int node) const noexcept
+    {
+        return nodeFirstWorker[node];
+    }
 
-			// this will wake waiting threads, but only when we unlcok the taskLock -
-			// i.e. when we do wait ourselves below
-			taskAwailableCond.notify_all();
+    int GetNodeNumWorkers(int node) const noexcept
+    {
+        return nodeFirstWorker[node + 1] - nodeFirstWorker[node];
+    }
 
-			// Wait for the theads to finish
-			taskDoneCond.wait(m, [&] {return numActiveThreads == 0; });
+    template <typename TFn>
+    void GridRun(TFn&& item) noexcept
+    {
+        if (Nested())
+        {
+            for (int threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+                item(threadIdx, numThreads);
+            return;
+        }
 
-			// Finally - ensure we clean up the task closure
-			task = std::function<void(int, int)>();
-		}
-		catch (...)
-		{
-			std::cerr << "unhandled exception in GridRun" << std::endl;
-			std::terminate();
-		}
+        if (leadingRegion == this)
+        {
+            RunPhase(item);
+            return;
+        }
+
+        taskData = TaskData(item);
+        taskCall = &Call<std::remove_reference_t<TFn>>;
+
+        numActiveThreads.Reset(numThreads);
+        generation.Add(1);
+        generation.WakeParked();
+
+        numActiveThreads.Wait(spins, [](uint32_t active) { return active == 0; });
+
+        taskData = nullptr;
+        taskCall = nullptr;
+    }
+
+    // body() on worker 0, with GridRun (and ParallelFor) inside it run as phases of this 
+    // region. Nothing else may run on the grid meanwhile
+    template <typename TFn>
+    void Region(TFn&& body) noexcept
+    {
+        uint32_t start = phaseGeneration.Load();
+
+        GridRun([&](int threadIdx, int n)
+        {
+            if (threadIdx == 0)
+            {
+                leadingRegion = this;
+                body();
+                leadingRegion = nullptr;
+
+                // no phase: the end of the region
+                phaseCall = nullptr;
+                phaseGeneration.Add(1);
+                phaseGeneration.WakeParked();
+                return;
+            }
+
+            uint32_t seen = start;
+            for (;;)
+            {
+                seen = phaseGeneration.Wait(spins, [seen](uint32_t current) { return current != seen; });
+                if (phaseCall == nullptr)
+                    break;
+
+                phaseCall(phaseData, threadIdx, n);
+
+                if (numActiveFollowers.Add(static_cast<uint32_t>(-1)) == 0)
+                    numActiveFollowers.WakeParked();
+            }
+        });
+    }
+
+    // fn(threadIdx, from, to) for [begin, end) in chunks of chunkSize. Each worker starts on
+    // its own consecutive share of the chunks, and once through it steals the upper half of
+    // what another one has left. With one thread everything is done in order. Timed under
+    // phase (a string literal, told apart by its address)
+    template <typename TFn>
+    void ParallelFor(const char* phase, int begin, int end, int chunkSize, TFn&& fn) noexcept
+    {
+        if (Nested())
+        {
+            for (int from = begin; from < end; from += chunkSize)
+                fn(currentWorker, from, std::min(from + chunkSize, end));
+            return;
+        }
+
+        int numChunks = end > begin ? (end - begin + chunkSize - 1) / chunkSize : 0;
+
+        for (int t = 0; t < numThreads; ++t)
+        {
+            workers[t].Chunks.store(Pack(
+                static_cast<uint32_t>(static_cast<int64_t>(numChunks) * t / numThreads),
+                static_cast<uint32_t>(static_cast<int64_t>(numChunks) * (t + 1) / numThreads)),
+                std::memory_order_relaxed);
+        }
+
+        RunChunks(phase, [&](int threadIdx, int chunk)
+        {
+            int from = begin + chunk * chunkSize;
+            fn(threadIdx, from, std::min(from + chunkSize, end));
+        });
+    }
+
+    // ParallelFor with node k's range [bounds[k], bounds[k + 1]) shared out to the workers of
+    // node k, bounds having GetNumNodes() + 1 entries
+    template <typename TFn>
+    void ParallelForNodes(const char* phase, const std::vector<int>& bounds, int chunkSize, TFn&& fn) noexcept
+    {
+        if (Nested())
+        {
+            for (int node = 0; node < numNodes; ++node)
+            {
+                for (int from = bounds[node]; from < bounds[node + 1]; from += chunkSize)
+                    fn(currentWorker, from, std::min(from + chunkSize, bounds[node + 1]));
+            }
+            return;
+        }
+
+        nodeChunks[0] = 0;
+        for (int node = 0; node < numNodes; ++node)
+        {
+            int size = bounds[node + 1] - bounds[node];
+            int numChunks = size > 0 ? (size + chunkSize - 1) / chunkSize : 0;
+            nodeChunks[node + 1] = nodeChunks[node] + numChunks;
+
+            int first = nodeFirstWorker[node];
+            int count = nodeFirstWorker[node + 1] - first;
+            for (int t = 0; t < count; ++t)
+            {
+                workers[first + t].Chunks.store(Pack(
+                    static_cast<uint32_t>(nodeChunks[node] + static_cast<int64_t>(numChunks) * t / count),
+                    static_cast<uint32_t>(nodeChunks[node] + static_cast<int64_t>(numChunks) * (t + 1) / count)),
+                    std::memory_order_relaxed);
+            }
+        }
+
+        RunChunks(phase, [&](int threadIdx, int chunk)
+        {
+            int node = 0;
+            while (chunk >= nodeChunks[node + 1])
+                ++node;
+
+            int from = bounds[node] + (chunk - nodeChunks[node]) * chunkSize;
+            fn(threadIdx, from, std::min(from + chunkSize, bounds[node + 1]));
+        });
+    }
+
+    // ParallelFor where fn(threadIdx, from, to) returns a T for its chunk. The chunks' are 
+    // combined in chunk order, result = combine(result, chunk's) from init, so the result 
+    // does not depend on which worker ran what
+    template <typename T, typename TFn, typename TCombineFn>
+    T ParallelReduce(const char* phase, int begin, int end, int chunkSize, T init, TFn&& fn, TCombineFn&& combine)
+    {
+        int numChunks = end > begin ? (end - begin + chunkSize - 1) / chunkSize : 0;
+        std::vector<T> partials(numChunks, init);
+
+        ParallelFor(phase, 0, numChunks, 1, [&](int threadIdx, int chunk, int)
+        {
+            int from = begin + chunk * chunkSize;
+            partials[chunk] = fn(threadIdx, from, std::min(from + chunkSize, end));
+        });
+
+        T result = init;
+        for (auto& partial : partials)
+            result = combine(result, partial);
+        return result;
+    }
+
+    const std::vector<PhaseStats>& GetPhaseStats() const noexcept
+    {
+        return phases;
+    }
+
+    void ResetPhaseStats() noexcept
+    {
+        phases.clear();
     }
 
 private:
-    void Thread(int threadIdx)
+    // the chunks dealt out to the workers, run(threadIdx, chunk) for each
+    template <typename TRunFn>
+    void RunChunks(const char* phase, TRunFn&& run) noexcept
     {
-        while (!terminate)
+        GridRun([&](int threadIdx, int)
         {
-            std::function<void(int, int)> item;
+            auto& worker = workers[threadIdx];
+            auto start = std::chrono::high_resolution_clock::now();
+
+            worker.Steals = 0;
+
+            int chunk;
+            while (TakeChunk(threadIdx, chunk))
+                run(threadIdx, chunk);
+
+            worker.BusySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        });
+
+        Record(phase);
+    }
 
+    // GridRun of the region's leader
+    template <typename TFn>
+    void RunPhase(TFn& item) noexcept
+    {
+        phaseData = TaskData(item);
+        phaseCall = &Call<std::remove_reference_t<TFn>>;
+
+        numActiveFollowers.Reset(numThreads - 1);
+        phaseGeneration.Add(1);
+        phaseGeneration.WakeParked();
+
+        inPhase = true;
+        item(0, numThreads);
+        inPhase = false;
+
+        numActiveFollowers.Wait(spins, [](uint32_t active) { return active == 0; });
+    }
+
+    static uint64_t Pack(uint32_t lo, uint32_t hi) noexcept
+    {
+        return (static_cast<uint64_t>(hi) << 32) | lo;
+    }
+
+    static uint32_t Lo(uint64_t chunks) noexcept
+    {
+        return static_cast<uint32_t>(chunks);
+    }
+
+    static uint32_t Hi(uint64_t chunks) noexcept
+    {
+        return static_cast<uint32_t>(chunks >> 32);
+    }
+
+    bool TakeChunk(int threadIdx, int& chunk) noexcept
+    {
+        auto& own = workers[threadIdx];
+
+        uint64_t chunks = own.Chunks.load();
+        while (Lo(chunks) < Hi(chunks))
+        {
+            if (own.Chunks.compare_exchange_weak(chunks, Pack(Lo(chunks) + 1, Hi(chunks))))
+            {
+                chunk = static_cast<int>(Lo(chunks));
+                return true;
+            }
+        }
+
+        // nothing left of our own, only the thieves look at it now. The same node's workers
+        // first, then the others
+        for (int k = 1; k < 2 * numThreads; ++k)
+        {
+            int victimIdx = (threadIdx + k) % numThreads;
+            if (victimIdx == threadIdx || (workerNodes[victimIdx] == workerNodes[threadIdx]) != (k < numThreads))
+                continue;
+
+            auto& victim = workers[victimIdx];
+
+            chunks = victim.Chunks.load();
+            while (Lo(chunks) < Hi(chunks))
             {
-                std::unique_lock<std::mutex> m(taskLock);
-                taskAwailableCond.wait(m, [&] {return hasTask[threadIdx] || terminate; });
-                if (!hasTask[threadIdx])
-                    continue;
-                item = task;
+                uint32_t mid = Hi(chunks) - (Hi(chunks) - Lo(chunks) + 1) / 2;
+                if (victim.Chunks.compare_exchange_weak(chunks, Pack(Lo(chunks), mid)))
+                {
+                    own.Chunks.store(Pack(mid + 1, Hi(chunks)));
+                    ++own.Steals;
+                    chunk = static_cast<int>(mid);
+                    return true;
+                }
             }
+        }
+
+        return false;
+    }
+
+    void Record(const char* phase)
+    {
+        auto stats = std::find_if(phases.begin(), phases.end(), [phase](const PhaseStats& s) { return s.Name == phase; });
+        if (stats == phases.end())
+        {
+            phases.emplace_back();
+            phases.back().Name = phase;
+            stats = phases.end() - 1;
+        }
+
+        double total = 0.0;
+        double slowest = 0.0;
+        for (auto& worker : workers)
+        {
+            total += worker.BusySeconds;
+            slowest = std::max(slowest, worker.BusySeconds);
+            stats->Steals += worker.Steals;
+        }
+
+        stats->NodeBusySeconds.resize(numNodes);
+        for (int node = 0; node < numNodes; ++node)
+        {
+            double nodeTotal = 0.0;
+            for (int t = nodeFirstWorker[node]; t < nodeFirstWorker[node + 1]; ++t)
+                nodeTotal += workers[t].BusySeconds;
+
+            stats->NodeBusySeconds[node] += nodeTotal / (nodeFirstWorker[node + 1] - nodeFirstWorker[node]);
+        }
+
+        ++stats->Runs;
+        stats->MeanBusySeconds += total / numThreads;
+        stats->SlowestBusySeconds += slowest;
+    }
+
+    void Thread(int threadIdx)
+    {
+        SetFlushDenormalsToZero();
+
+        currentGrid = this;
+        currentWorker = threadIdx;
+
+        if (pinned)
+            NumaTopology::PinCurrentThread(workerProcessors[threadIdx]);
+
+        uint32_t seen = 0;
+
+        for (;;)
+        {
+            seen = generation.Wait(spins, [seen](uint32_t current) { return current != seen; });
+            if (terminate)
+                break;
 
-            // we have the task - run it
-            item(threadIdx, numThreads);
+            taskCall(taskData, threadIdx, numThreads);
 
-            // Mark ourselves as done, and if we are the last thread - notify the waitinig "GridRun"
-            std::unique_lock<std::mutex> m(taskLock);
-            hasTask[threadIdx] = false;
-            if (--numActiveThreads == 0)
-                taskDoneCond.notify_all();
+            // the last one wakes up the waiting GridRun
+            if (numActiveThreads.Add(static_cast<uint32_t>(-1)) == 0)
+                numActiveThreads.WakeParked();
         }
     }
-};
\ No newline at end of file
+};
@@ -1,5 +1,19 @@
 #pragma once
 
+#include <xmmintrin.h>
+
+// MSVC allows any intrinsics in any function, other compilers need the target ISA
+// to be explicitly enabled on the functions using them
+#ifdef _MSC_VER
+#define NN_TARGET_SSE4
+#define NN_TARGET_AVX2
+#define NN_TARGET_AVX512
+#else
+#define NN_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define NN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define NN_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
 // Quick reverse square root from Quake 3 source code 
 inline float Q_rsqrt(float number)  noexcept
 {
@@ -43,6 +57,13 @@ const T& ValueCap(const T& val, const  T& min, const T& max)  noexcept
 }
 
 
+// Flush denormal results to zero (FTZ) and treat denormal inputs as zeros (DAZ) on the calling thread. 
+// Neuron charges decay geometrically, without this they would spend a long time in the slow denormal range
+inline void SetFlushDenormalsToZero() noexcept
+{
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+}
+
 float InterlockedCompareExchange(float volatile * _Destination, float _Exchange, float _Comparand)  noexcept
 {
     static_assert(sizeof(float) == sizeof(long),
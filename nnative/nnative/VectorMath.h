@@ -0,0 +1,347 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "Utils.h"
+
+// Float approximations of the transcendental functions used by the simulation, as scalar,
+// 8-wide (AVX2 + FMA, __m256) and 16-wide (AVX-512F, __m512) overloads. All three evaluate
+// the same polynomials with fused multiply-adds (std::fma in the scalar ones), so they give
+// bit-identical results per lane -- except RSqrt, which starts from the hardware estimate.
+// Error bounds, against libm in double precision (the "-bench" run re-checks them):
+//   Exp2(x)      relative 3e-7, x clamped to [-126, 126]
+//   Log2(x)      absolute 3e-7 * max(1, |log2(x)|), x > 0 and normal
+//   Pow(x, y)    relative 3e-7 * (1 + |y * log2(x)|), x > 0 and normal, 0 for x == 0
+//   SinCos(x)    absolute 2e-7 for |x| <= 1000 (pi / 2 split in 3 parts for the reduction)
+//   Sqrt(x)      hardware square root, correctly rounded
+//   RSqrt(x)     relative 5e-7 (one Newton step over the 12-bit, 14-bit on AVX-512, estimate)
+namespace VectorMath
+{
+    namespace Constants
+    {
+        // 2^f = sum Exp2Coefficients[k] * f^k, f in [-0.5, 0.5], Taylor series of exp(f ln2)
+        constexpr float Exp2C1 = 0.693147182f;
+        constexpr float Exp2C2 = 0.240226507f;
+        constexpr float Exp2C3 = 0.0555041087f;
+        constexpr float Exp2C4 = 0.00961812911f;
+        constexpr float Exp2C5 = 0.00133335581f;
+        constexpr float Exp2C6 = 0.000154035304f;
+
+        // log2(m) = 2 / ln2 * atanh(t), t = (m - 1) / (m + 1), m in [sqrt(1/2), sqrt(2)]
+        constexpr float Log2Scale = 2.88539008f;
+        constexpr float Log2C3 = 1.0f / 3.0f;
+        constexpr float Log2C5 = 1.0f / 5.0f;
+        constexpr float Log2C7 = 1.0f / 7.0f;
+        constexpr float Log2C9 = 1.0f / 9.0f;
+        constexpr float Sqrt2 = 1.41421356f;
+
+        // Cody-Waite split of pi / 2, the first two parts have few enough bits that j * part is exact
+        constexpr float TwoOverPi = 0.636619772f;
+        constexpr float PiOver2A = 1.5703125f;
+        constexpr float PiOver2B = 4.837512969970703125e-4f;
+        constexpr float PiOver2C = 7.54978995489188216e-8f;
+
+        // minimax polynomials on [-pi/4, pi/4] (Cephes sinf / cosf)
+        constexpr float SinC3 = -1.6666654611e-1f;
+        constexpr float SinC5 = 8.3321608736e-3f;
+        constexpr float SinC7 = -1.9515295891e-4f;
+        constexpr float CosC4 = 4.166664568298827e-2f;
+        constexpr float CosC6 = -1.388731625493765e-3f;
+        constexpr float CosC8 = 2.443315711809948e-5f;
+
+        constexpr float Exp2Min = -126.0f;
+        constexpr float Exp2Max = 126.0f;
+    }
+
+    // Scalar
+
+    inline float Exp2(float x) noexcept
+    {
+        using namespace Constants;
+
+        x = x < Exp2Min ? Exp2Min : (x > Exp2Max ? Exp2Max : x);
+        float n = std::nearbyint(x);
+        float f = x - n;
+
+        float p = std::fma(Exp2C6, f, Exp2C5);
+        p = std::fma(p, f, Exp2C4);
+        p = std::fma(p, f, Exp2C3);
+        p = std::fma(p, f, Exp2C2);
+        p = std::fma(p, f, Exp2C1);
+        p = std::fma(p, f, 1.0f);
+
+        int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+        return p * scale;
+    }
+
+    inline float Log2(float x) noexcept
+    {
+        using namespace Constants;
+
+        int32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+
+        float e = static_cast<float>((bits >> 23) - 127);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+        float m;
+        std::memcpy(&m, &bits, sizeof(m));
+
+        if (m > Sqrt2)
+        {
+            m = m * 0.5f;
+            e = e + 1.0f;
+        }
+
+        float t = (m - 1.0f) / (m + 1.0f);
+        float t2 = t * t;
+
+        float p = std::fma(Log2C9, t2, Log2C7);
+        p = std::fma(p, t2, Log2C5);
+        p = std::fma(p, t2, Log2C3);
+        p = std::fma(p, t2, 1.0f);
+
+        return std::fma(p * t, Log2Scale, e);
+    }
+
+    inline float Pow(float x, float y) noexcept
+    {
+        return x > 0.0f ? Exp2(y * Log2(x)) : 0.0f;
+    }
+
+    inline void SinCos(float x, float& sine, float& cosine) noexcept
+    {
+        using namespace Constants;
+
+        float j = std::nearbyint(x * TwoOverPi);
+        float r = std::fma(-j, PiOver2A, x);
+        r = std::fma(-j, PiOver2B, r);
+        r = std::fma(-j, PiOver2C, r);
+
+        float r2 = r * r;
+
+        float s = std::fma(SinC7, r2, SinC5);
+        s = std::fma(s, r2, SinC3);
+        s = std::fma(s * r2, r, r);
+
+        float c = std::fma(CosC8, r2, CosC6);
+        c = std::fma(c, r2, CosC4);
+        c = std::fma(c * r2, r2, std::fma(-0.5f, r2, 1.0f));
+
+        int quadrant = static_cast<int>(j) & 3;
+        float sr = (quadrant & 1) ? c : s;
+        float cr = (quadrant & 1) ? s : c;
+        sine = (quadrant & 2) ? -sr : sr;
+        cosine = ((quadrant + 1) & 2) ? -cr : cr;
+    }
+
+    inline float Sqrt(float x) noexcept
+    {
+        return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x)));
+    }
+
+    inline float RSqrt(float x) noexcept
+    {
+        float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+        float xyy = x * y * y;
+        return y * std::fma(-0.5f, xyy, 1.5f);
+    }
+
+    // 8-wide, AVX2 + FMA
+
+    NN_TARGET_AVX2 inline __m256 Exp2(__m256 x) noexcept
+    {
+        using namespace Constants;
+
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(Exp2Min)), _mm256_set1_ps(Exp2Max));
+        __m256 n = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 f = _mm256_sub_ps(x, n);
+
+        __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(Exp2C6), f, _mm256_set1_ps(Exp2C5));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(Exp2C4));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(Exp2C3));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(Exp2C2));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(Exp2C1));
+        p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+
+        __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+    }
+
+    NN_TARGET_AVX2 inline __m256 Log2(__m256 x) noexcept
+    {
+        using namespace Constants;
+
+        __m256i bits = _mm256_castps_si256(x);
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+            _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f800000)));
+
+        __m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(Sqrt2), _CMP_GT_OQ);
+        m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+        e = _mm256_blendv_ps(e, _mm256_add_ps(e, _mm256_set1_ps(1.0f)), big);
+
+        __m256 one = _mm256_set1_ps(1.0f);
+        __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+        __m256 t2 = _mm256_mul_ps(t, t);
+
+        __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(Log2C9), t2, _mm256_set1_ps(Log2C7));
+        p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(Log2C5));
+        p = _mm256_fmadd_ps(p, t2, _mm256_set1_ps(Log2C3));
+        p = _mm256_fmadd_ps(p, t2, one);
+
+        return _mm256_fmadd_ps(_mm256_mul_ps(p, t), _mm256_set1_ps(Log2Scale), e);
+    }
+
+    NN_TARGET_AVX2 inline __m256 Pow(__m256 x, __m256 y) noexcept
+    {
+        __m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+        return _mm256_and_ps(Exp2(_mm256_mul_ps(y, Log2(x))), positive);
+    }
+
+    NN_TARGET_AVX2 inline void SinCos(__m256 x, __m256& sine, __m256& cosine) noexcept
+    {
+        using namespace Constants;
+
+        __m256 j = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(TwoOverPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PiOver2A), x);
+        r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PiOver2B), r);
+        r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PiOver2C), r);
+
+        __m256 r2 = _mm256_mul_ps(r, r);
+
+        __m256 s = _mm256_fmadd_ps(_mm256_set1_ps(SinC7), r2, _mm256_set1_ps(SinC5));
+        s = _mm256_fmadd_ps(s, r2, _mm256_set1_ps(SinC3));
+        s = _mm256_fmadd_ps(_mm256_mul_ps(s, r2), r, r);
+
+        __m256 c = _mm256_fmadd_ps(_mm256_set1_ps(CosC8), r2, _mm256_set1_ps(CosC6));
+        c = _mm256_fmadd_ps(c, r2, _mm256_set1_ps(CosC4));
+        c = _mm256_fmadd_ps(_mm256_mul_ps(c, r2), r2, _mm256_fmadd_ps(_mm256_set1_ps(-0.5f), r2, _mm256_set1_ps(1.0f)));
+
+        __m256i quadrant = _mm256_cvtps_epi32(j);
+        __m256 swap = _mm256_castsi256_ps(_mm256_slli_epi32(quadrant, 31));
+        __m256 sr = _mm256_blendv_ps(s, c, swap);
+        __m256 cr = _mm256_blendv_ps(c, s, swap);
+
+        // sign bits: sine negative in quadrants 2, 3, cosine in 1, 2
+        __m256 sineSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(quadrant, 1), 31));
+        __m256 cosineSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_srli_epi32(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), 1), 31));
+
+        sine = _mm256_xor_ps(sr, sineSign);
+        cosine = _mm256_xor_ps(cr, cosineSign);
+    }
+
+    NN_TARGET_AVX2 inline __m256 Sqrt(__m256 x) noexcept
+    {
+        return _mm256_sqrt_ps(x);
+    }
+
+    NN_TARGET_AVX2 inline __m256 RSqrt(__m256 x) noexcept
+    {
+        __m256 y = _mm256_rsqrt_ps(x);
+        __m256 xyy = _mm256_mul_ps(_mm256_mul_ps(x, y), y);
+        return _mm256_mul_ps(y, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), xyy, _mm256_set1_ps(1.5f)));
+    }
+
+    // 16-wide, AVX-512F
+
+    NN_TARGET_AVX512 inline __m512 Exp2(__m512 x) noexcept
+    {
+        using namespace Constants;
+
+        x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(Exp2Min)), _mm512_set1_ps(Exp2Max));
+        __m512 n = _mm512_roundscale_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 f = _mm512_sub_ps(x, n);
+
+        __m512 p = _mm512_fmadd_ps(_mm512_set1_ps(Exp2C6), f, _mm512_set1_ps(Exp2C5));
+        p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(Exp2C4));
+        p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(Exp2C3));
+        p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(Exp2C2));
+        p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(Exp2C1));
+        p = _mm512_fmadd_ps(p, f, _mm512_set1_ps(1.0f));
+
+        __m512i bits = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23);
+        return _mm512_mul_ps(p, _mm512_castsi512_ps(bits));
+    }
+
+    NN_TARGET_AVX512 inline __m512 Log2(__m512 x) noexcept
+    {
+        using namespace Constants;
+
+        __m512i bits = _mm512_castps_si512(x);
+        __m512 e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(127)));
+        __m512 m = _mm512_castsi512_ps(_mm512_or_si512(
+            _mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)), _mm512_set1_epi32(0x3f800000)));
+
+        __mmask16 big = _mm512_cmp_ps_mask(m, _mm512_set1_ps(Sqrt2), _CMP_GT_OQ);
+        m = _mm512_mask_mul_ps(m, big, m, _mm512_set1_ps(0.5f));
+        e = _mm512_mask_add_ps(e, big, e, _mm512_set1_ps(1.0f));
+
+        __m512 one = _mm512_set1_ps(1.0f);
+        __m512 t = _mm512_div_ps(_mm512_sub_ps(m, one), _mm512_add_ps(m, one));
+        __m512 t2 = _mm512_mul_ps(t, t);
+
+        __m512 p = _mm512_fmadd_ps(_mm512_set1_ps(Log2C9), t2, _mm512_set1_ps(Log2C7));
+        p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(Log2C5));
+        p = _mm512_fmadd_ps(p, t2, _mm512_set1_ps(Log2C3));
+        p = _mm512_fmadd_ps(p, t2, one);
+
+        return _mm512_fmadd_ps(_mm512_mul_ps(p, t), _mm512_set1_ps(Log2Scale), e);
+    }
+
+    NN_TARGET_AVX512 inline __m512 Pow(__m512 x, __m512 y) noexcept
+    {
+        __mmask16 positive = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ);
+        return _mm512_maskz_mov_ps(positive, Exp2(_mm512_mul_ps(y, Log2(x))));
+    }
+
+    NN_TARGET_AVX512 inline void SinCos(__m512 x, __m512& sine, __m512& cosine) noexcept
+    {
+        using namespace Constants;
+
+        __m512 j = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(TwoOverPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 r = _mm512_fnmadd_ps(j, _mm512_set1_ps(PiOver2A), x);
+        r = _mm512_fnmadd_ps(j, _mm512_set1_ps(PiOver2B), r);
+        r = _mm512_fnmadd_ps(j, _mm512_set1_ps(PiOver2C), r);
+
+        __m512 r2 = _mm512_mul_ps(r, r);
+
+        __m512 s = _mm512_fmadd_ps(_mm512_set1_ps(SinC7), r2, _mm512_set1_ps(SinC5));
+        s = _mm512_fmadd_ps(s, r2, _mm512_set1_ps(SinC3));
+        s = _mm512_fmadd_ps(_mm512_mul_ps(s, r2), r, r);
+
+        __m512 c = _mm512_fmadd_ps(_mm512_set1_ps(CosC8), r2, _mm512_set1_ps(CosC6));
+        c = _mm512_fmadd_ps(c, r2, _mm512_set1_ps(CosC4));
+        c = _mm512_fmadd_ps(_mm512_mul_ps(c, r2), r2, _mm512_fmadd_ps(_mm512_set1_ps(-0.5f), r2, _mm512_set1_ps(1.0f)));
+
+        __m512i quadrant = _mm512_cvtps_epi32(j);
+        __mmask16 swap = _mm512_test_epi32_mask(quadrant, _mm512_set1_epi32(1));
+        __m512 sr = _mm512_mask_blend_ps(swap, s, c);
+        __m512 cr = _mm512_mask_blend_ps(swap, c, s);
+
+        // sign bits: sine negative in quadrants 2, 3, cosine in 1, 2
+        __m512i sineSign = _mm512_slli_epi32(_mm512_srli_epi32(quadrant, 1), 31);
+        __m512i cosineSign = _mm512_slli_epi32(_mm512_srli_epi32(_mm512_add_epi32(quadrant, _mm512_set1_epi32(1)), 1), 31);
+
+        sine = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(sr), sineSign));
+        cosine = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(cr), cosineSign));
+    }
+
+    NN_TARGET_AVX512 inline __m512 Sqrt(__m512 x) noexcept
+    {
+        return _mm512_sqrt_ps(x);
+    }
+
+    NN_TARGET_AVX512 inline __m512 RSqrt(__m512 x) noexcept
+    {
+        __m512 y = _mm512_rsqrt14_ps(x);
+        __m512 xyy = _mm512_mul_ps(_mm512_mul_ps(x, y), y);
+        return _mm512_mul_ps(y, _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), xyy, _mm512_set1_ps(1.5f)));
+    }
+}
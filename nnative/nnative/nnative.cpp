@@ -17,6 +17,7 @@
 #include "Neurolution/CellView.h"
 #include "Neurolution/WorldView.h"
 #include "Neurolution/MainController.h"
+#include "Neurolution/Benchmarks.h"
 
 #include "FixedPoint.h"
 
@@ -321,8 +322,32 @@ int APIENTRY wWinMain(_In_ HINSTANCE hCurrentInst, _In_opt_ HINSTANCE hPreviousI
         ::SetPriorityClass(::GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
     }
 
+    // "-kernel=<scalar|sse4|avx2|avx512>" forces the neuron kernel ISA (as does NNATIVE_KERNEL env var)
+    const wchar_t* kernelArg = wcsstr(lpszCmdLine, L"-kernel=");
+    if (kernelArg != nullptr)
+    {
+        char kernelName[16] = { 0 };
+        for (int i = 0; i < 15 && kernelArg[8 + i] != L'\0' && kernelArg[8 + i] != L' '; ++i)
+            kernelName[i] = static_cast<char>(kernelArg[8 + i]);
+
+        if (!Neurolution::KernelDispatch::Override(kernelName))
+        {
+            MessageBox(NULL, _T("Unknown or unsupported -kernel= value, using the default one"), _T("Warning"), MB_OK);
+        }
+    }
+
+    std::string kernelLog = std::string("nnative: neuron kernel: ") +
+        Neurolution::KernelIsaName(Neurolution::KernelDispatch::Selected()) + "\n";
+    ::OutputDebugStringA(kernelLog.c_str());
+
     Neurolution::RuntimeConfig config;
 
+    if (wcsstr(lpszCmdLine, L"-bench") != nullptr)
+    {
+        std::ofstream benchOut("nnative-bench.txt");
+        return Neurolution::Benchmarks::RunAll<TMainController::TProp>(benchOut, config.GetNumWorkerThreads()) ? 0 : 1;
+    }
+
     controller = std::make_unique<TMainController>(config);
 
     controller->SetHWND(